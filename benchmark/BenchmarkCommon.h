@@ -0,0 +1,160 @@
+/**
+ * @file BenchmarkCommon.h
+ *
+ * @brief Common helpers of the benchmarks against a local broker
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+#ifndef _BENCHMARK_COMMON_H_
+#define _BENCHMARK_COMMON_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "MQTT.h"
+#include "Simple.h"
+
+#define BENCH_HOST                          "tcp://127.0.0.1"
+#define BENCH_PORT                          1883
+#define BENCH_KEEP_ALIVE                    60
+#define BENCH_SERVICE_NAME                  "bench"
+#define BENCH_TOPIC_CONTROL_DOWN            "v1/dev/%s/%s/down"
+#define BENCH_CONNECT_TIMEOUT_MS            5000
+
+/** benchmark session **/
+typedef struct
+{
+    tpClient* client;
+    char deviceName[32];
+    char topicControlDown[SIZE_TOPIC];
+    volatile int subscribed;
+    volatile int failed;
+} BenchSession;
+
+/**
+ * @brief monotonic time
+ * @return time in nanoseconds
+ */
+static inline long long benchNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline void benchSubscribed(tpClient* client, int result) {
+    BenchSession* session = (BenchSession *)tpClientGetContext(client);
+    if(result) session->failed = 1;
+    else session->subscribed = 1;
+}
+
+static inline void benchConnected(tpClient* client, int result) {
+    BenchSession* session = (BenchSession *)tpClientGetContext(client);
+    if(result) session->failed = 1;
+}
+
+static inline void benchArrived(tpClient* client, char* topic, char* payload, int payloadLen) {
+}
+
+/**
+ * @brief connect a benchmark session with a publish submission queue and a pending queue and wait for SUBACK
+ * @param[in] session : session to connect
+ * @param[in] host : broker host
+ * @param[in] port : broker port
+ * @param[in] deviceName : device name of the session
+ * @param[in] submitQueue : queued publishes(0 : publish in the calling thread)
+ * @param[in] maxInflight : maximum in-flight messages(0 : paho default)
+ * @param[in] maxPending : publishes queued while the window is full(0 : no queue)
+ * @return int : 0 if connected and subscribed
+ */
+static inline int benchConnectFlow(BenchSession* session, char* host, int port, char* deviceName, int submitQueue,
+        int maxInflight, int maxPending) {
+    int waited = 0;
+    memset(session, 0, sizeof(BenchSession));
+    snprintf(session->deviceName, sizeof(session->deviceName), "%s", deviceName);
+    snprintf(session->topicControlDown, sizeof(session->topicControlDown), BENCH_TOPIC_CONTROL_DOWN,
+        BENCH_SERVICE_NAME, session->deviceName);
+    char* subscribeTopics[] = { session->topicControlDown };
+
+    session->client = tpClientNew();
+    if(!session->client) return -1;
+    tpClientSetContext(session->client, session);
+    tpMQTTSetCallbacksEx(session->client, benchConnected, benchSubscribed, NULL, NULL, NULL, benchArrived);
+    tpSimpleInitializeEx(session->client, BENCH_SERVICE_NAME, session->deviceName);
+    if(tpSDKSetSubmitQueueEx(session->client, submitQueue) != TP_SDK_SUCCESS) return -1;
+    if(maxPending > 0 && tpSDKSetFlowControlEx(session->client, maxInflight, maxPending, 0, 0, NULL) != TP_SDK_SUCCESS) {
+        return -1;
+    }
+    if(tpSDKCreateEx(session->client, host, port, BENCH_KEEP_ALIVE, NULL, NULL, 0,
+            subscribeTopics, 1, NULL, session->deviceName, 1) != TP_SDK_SUCCESS) {
+        return -1;
+    }
+    while(!session->subscribed && !session->failed && waited < BENCH_CONNECT_TIMEOUT_MS) {
+        usleep(1000);
+        waited++;
+    }
+    return session->subscribed ? 0 : -1;
+}
+
+/**
+ * @brief connect a benchmark session with a publish submission queue and wait for SUBACK
+ * @param[in] session : session to connect
+ * @param[in] host : broker host
+ * @param[in] port : broker port
+ * @param[in] deviceName : device name of the session
+ * @param[in] submitQueue : queued publishes(0 : publish in the calling thread)
+ * @return int : 0 if connected and subscribed
+ */
+static inline int benchConnectEx(BenchSession* session, char* host, int port, char* deviceName, int submitQueue) {
+    return benchConnectFlow(session, host, port, deviceName, submitQueue, 0, 0);
+}
+
+/**
+ * @brief connect a benchmark session and wait for SUBACK
+ * @param[in] session : session to connect
+ * @param[in] host : broker host
+ * @param[in] port : broker port
+ * @param[in] deviceName : device name of the session
+ * @return int : 0 if connected and subscribed
+ */
+static inline int benchConnect(BenchSession* session, char* host, int port, char* deviceName) {
+    return benchConnectEx(session, host, port, deviceName, 0);
+}
+
+/**
+ * @brief wait until every publish of the session has completed
+ * @param[in] session : benchmark session
+ */
+static inline void benchDrain(BenchSession* session) {
+    MQTTAsync_token* tokens = NULL;
+    // submitted publishes reach paho first
+    MQTTSubmitFlush(&session->client->submit);
+    while(1) {
+        if(MQTTAsync_getPendingTokens(session->client->handle, &tokens) != MQTTASYNC_SUCCESS) break;
+        if(tokens == NULL) break;
+        if(tokens[0] == -1) {
+            MQTTAsync_free(tokens);
+            break;
+        }
+        MQTTAsync_free(tokens);
+        tokens = NULL;
+        usleep(100);
+    }
+}
+
+/**
+ * @brief disconnect and free a benchmark session
+ * @param[in] session : benchmark session
+ */
+static inline void benchClose(BenchSession* session) {
+    if(session->client) {
+        tpSDKDestroyEx(session->client);
+        tpClientFree(session->client);
+        session->client = NULL;
+    }
+}
+
+#endif // _BENCHMARK_COMMON_H_
@@ -0,0 +1,97 @@
+/**
+ * @file DeflateBenchmark.c
+ *
+ * @brief JSON payload compression against a local broker
+ *
+ * publishes cJSON_Print attribute and telemetry payloads with compression off and
+ * at several zlib levels, and reports the payload bytes saved and the compression
+ * CPU time per message.
+ *
+ * usage : DeflateBenchmark [host] [port] [count]
+ *         (default tcp://127.0.0.1 1883 1000, e.g. mosquitto -p 1883)
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+#include "BenchmarkCommon.h"
+
+#define BENCH_DEFAULT_COUNT                 1000
+
+/** pretty-printed payloads as tpSimpleAttribute and tpSimpleTelemetry send them **/
+static char* mSamples[] = {
+    "{\n\t\"temp1\":\t26.5,\n\t\"humi1\":\t48.2,\n\t\"light1\":\t312\n}",
+    "{\n\t\"sysAvailableMemory\":\t123456,\n\t\"sysFirmwareVersion\":\t\"2.0.0\",\n\t\"sysHardwareVersion\":\t\"1.0\",\n"
+        "\t\"sysSerialNumber\":\t\"710DJC5I10000290\",\n\t\"sysErrorCode\":\t0,\n\t\"sysNetworkType\":\t\"ethernet\",\n"
+        "\t\"sysDeviceIpAddress\":\t\"192.168.0.10\",\n\t\"sysThingPlugIpAddress\":\t\"211.234.246.112\",\n"
+        "\t\"sysLocationLatitude\":\t37.381021,\n\t\"sysLocationLongitude\":\t127.116732,\n\t\"act7colorLed\":\t0\n}",
+    "[{\n\t\"temp1\":\t26.5,\n\t\"humi1\":\t48.2,\n\t\"light1\":\t312\n},{\n\t\"temp1\":\t26.6,\n\t\"humi1\":\t48.1,\n\t\"light1\":\t310\n},"
+        "{\n\t\"temp1\":\t26.6,\n\t\"humi1\":\t48.0,\n\t\"light1\":\t309\n},{\n\t\"temp1\":\t26.7,\n\t\"humi1\":\t47.9,\n\t\"light1\":\t311\n},"
+        "{\n\t\"temp1\":\t26.7,\n\t\"humi1\":\t47.9,\n\t\"light1\":\t315\n},{\n\t\"temp1\":\t26.8,\n\t\"humi1\":\t47.7,\n\t\"light1\":\t318\n},"
+        "{\n\t\"temp1\":\t26.8,\n\t\"humi1\":\t47.6,\n\t\"light1\":\t320\n},{\n\t\"temp1\":\t26.9,\n\t\"humi1\":\t47.5,\n\t\"light1\":\t322\n}]"
+};
+
+/** zlib levels compared with no compression(0) **/
+static int mLevels[] = { 0, 1, 6, 9 };
+
+/**
+ * @brief publish count payloads with QoS 1 and wait for completion
+ * @param[in] session : connected session
+ * @param[in] sample : JSON payload
+ * @param[in] count : message count
+ * @return int : 0 if all are published
+ */
+static int runSample(BenchSession* session, char* sample, int count) {
+    int i, rc;
+    tpSDKResetPublishStatsEx(session->client);
+    for(i = 0; i < count; i++) {
+        while((rc = tpSimpleRawAttributeQosEx(session->client, sample, FORMAT_JSON, 1))
+                == TP_SDK_MQTT_MAX_MESSAGES_INFLIGHT) {
+            usleep(50);
+        }
+        if(rc != TP_SDK_SUCCESS) {
+            fprintf(stderr, "publish failed : %d\n", rc);
+            return -1;
+        }
+    }
+    benchDrain(session);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    char* host = argc > 1 ? argv[1] : BENCH_HOST;
+    int port = argc > 2 ? atoi(argv[2]) : BENCH_PORT;
+    int count = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_COUNT;
+    int i, j;
+    BenchSession session;
+
+    if(benchConnect(&session, host, port, "deflatebench") != 0) {
+        fprintf(stderr, "cannot connect to %s:%d\n", host, port);
+        benchClose(&session);
+        return 1;
+    }
+
+    printf("%8s %6s %12s %8s %12s\n", "payload", "level", "payload/msg", "saved%", "cpu us/msg");
+    for(i = 0; i < (int)(sizeof(mSamples) / sizeof(mSamples[0])); i++) {
+        for(j = 0; j < (int)(sizeof(mLevels) / sizeof(mLevels[0])); j++) {
+            tpWireStats wire;
+            tpCompressionStats before, after;
+            unsigned long messages;
+            // every payload is compressed when enabled, to see the gain of the small ones as well
+            tpSimpleSetCompressionEx(session.client, mLevels[j] ? 1 : 0, mLevels[j] ? mLevels[j] : -1);
+            tpSimpleGetCompressionStatsEx(session.client, &before);
+            if(runSample(&session, mSamples[i], count) != 0) break;
+            tpSimpleGetCompressionStatsEx(session.client, &after);
+            tpSDKGetWireStatsEx(session.client, TOPIC_CLASS_ATTRIBUTE, &wire);
+            if(wire.messages == 0) continue;
+            messages = after.compressed + after.skipped - before.compressed - before.skipped;
+            printf("%8lu %6d %12llu %7.1f%% %12.2f\n",
+                (unsigned long)strlen(mSamples[i]), mLevels[j],
+                wire.payloadBytes / wire.messages,
+                100.0 - 100.0 * wire.payloadBytes / ((double)strlen(mSamples[i]) * wire.messages),
+                messages ? (double)(after.cpuUsec - before.cpuUsec) / messages : 0.0);
+        }
+    }
+
+    benchClose(&session);
+    return 0;
+}
@@ -0,0 +1,357 @@
+/**
+ * @file LoopbackBenchmark.c
+ *
+ * @brief end-to-end Simple API throughput and latency against a local broker
+ *
+ * drives tpSimpleTelemetry, tpSimpleAttribute, tpSimpleResult and downlink RPCs(a controller
+ * session publishes to the down topic and the device answers with tpSimpleResult) for each QoS,
+ * payload size and paced rate, and reports messages/s, p50/p99 latency(publish completion,
+ * RPC round trip), CPU usage and RSS of the process. then destroys a session while publish
+ * futures wait in its pending queue and fails unless every future completes. run with
+ * 'make loopback' to start mosquitto on 127.0.0.1 for the run.
+ *
+ * usage : LoopbackBenchmark [host] [port] [count]
+ *         (default tcp://127.0.0.1 1883 1000, e.g. mosquitto -p 1883)
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+#include <errno.h>
+#include <sys/resource.h>
+
+#include "BenchmarkCommon.h"
+
+#define BENCH_DEFAULT_COUNT                 1000
+#define BENCH_MAX_ELEMENTS                  32
+#define BENCH_TOPIC_UP                      "v1/dev/%s/%s/up"
+#define BENCH_RPC_TIMEOUT_MS                10000
+#define BENCH_DESTROY_INFLIGHT              1
+#define BENCH_DESTROY_FUTURE_TIMEOUT_MS     5000
+
+typedef enum bench_api {
+    BENCH_TELEMETRY = 0,
+    BENCH_ATTRIBUTE,
+    BENCH_RESULT,
+    BENCH_RPC,
+    BENCH_API_MAX
+} BENCH_API;
+
+static const char* mApiNames[BENCH_API_MAX] = { "telemetry", "attribute", "result", "rpc" };
+
+/** topic class of the publish latency of each API **/
+static const TOPIC_CLASS mApiClasses[BENCH_API_MAX] = { TOPIC_CLASS_TELEMETRY, TOPIC_CLASS_ATTRIBUTE, TOPIC_CLASS_UP, TOPIC_CLASS_UP };
+
+/** values per payload **/
+static int mSizes[] = { 3, BENCH_MAX_ELEMENTS };
+
+/** paced rates in messages/s(0 : as fast as accepted) **/
+static int mRates[] = { 500, 2000, 0 };
+
+static char mNames[BENCH_MAX_ELEMENTS][16];
+static double mValues[BENCH_MAX_ELEMENTS];
+static Element mElements[BENCH_MAX_ELEMENTS];
+
+/** RPC round trips measured by the controller **/
+typedef struct
+{
+    /** send time per request id(nsec) **/
+    long long* sent;
+    /** round trip per answered request(usec) **/
+    long* rtt;
+    /** requests sent **/
+    int count;
+    /** answers received **/
+    volatile int answered;
+    /** QoS of the answers **/
+    int qos;
+} BenchRpc;
+
+static BenchRpc mRpc;
+
+/**
+ * @brief process CPU time
+ * @return usec
+ */
+static long long benchCpu() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000LL + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/**
+ * @brief resident set size of the process
+ * @return KB, 0 if unknown
+ */
+static long benchRss() {
+    long pages = 0, resident = 0;
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if(fp == NULL) return 0;
+    if(fscanf(fp, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    fclose(fp);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/**
+ * @brief wait for the send time of a message
+ * @param[in] start : run start(nsec)
+ * @param[in] index : message index
+ * @param[in] rate : messages/s(0 : no wait)
+ */
+static void benchPace(long long start, int index, int rate) {
+    struct timespec at;
+    long long due;
+    if(rate <= 0) return;
+    due = start + (long long)index * 1000000000LL / rate;
+    at.tv_sec = due / 1000000000LL;
+    at.tv_nsec = due % 1000000000LL;
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL) == EINTR);
+}
+
+/**
+ * @brief JSON number of a key in a payload
+ * @param[in] payload : JSON payload
+ * @param[in] len : payload length
+ * @param[in] key : object key
+ * @param[in] parent : parent object key(NULL : root)
+ * @return int : value, -1 if not found
+ */
+static int benchJsonInt(char* payload, int len, const char* key, const char* parent) {
+    cJSON* root = cJSON_Parse(payload);
+    cJSON* object = root;
+    cJSON* item;
+    int value = -1;
+    (void)len;
+    if(root == NULL) return -1;
+    if(parent) object = cJSON_GetObjectItem(root, parent);
+    item = object ? cJSON_GetObjectItem(object, key) : NULL;
+    if(item && item->type == cJSON_Number) value = item->valueint;
+    cJSON_Delete(root);
+    return value;
+}
+
+/**
+ * @brief device side of the RPC : answer a control request with tpSimpleResult
+ */
+static void benchDeviceControl(tpClient* client, char* topic, char* payload, int payloadLen, void* context) {
+    ArrayElement* values = (ArrayElement *)context;
+    RPCResponse response;
+    memset(&response, 0, sizeof(RPCResponse));
+    response.cmd = "jsonRpc";
+    response.jsonrpc = "2.0";
+    response.id = benchJsonInt(payload, payloadLen, ID, NULL);
+    response.result = 1;
+    response.resultArray = values;
+    tpSimpleResultQosEx(client, &response, mRpc.qos);
+}
+
+/**
+ * @brief controller side of the RPC : the answer of a request
+ */
+static void benchControllerUp(tpClient* client, char* topic, char* payload, int payloadLen, void* context) {
+    long long now = benchNow();
+    int id = benchJsonInt(payload, payloadLen, ID, RPC_RSP);
+    if(id < 0 || id >= mRpc.count || mRpc.sent[id] == 0) return;
+    mRpc.rtt[mRpc.answered] = (long)((now - mRpc.sent[id]) / 1000);
+    mRpc.sent[id] = 0;
+    __atomic_add_fetch(&mRpc.answered, 1, __ATOMIC_RELEASE);
+}
+
+static int benchCompareLong(const void* a, const void* b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief publish count messages of an API at a rate and wait for completion
+ * @param[in] device : device session
+ * @param[in] controller : controller session(RPC)
+ * @param[in] api : API
+ * @param[in] qos : QoS
+ * @param[in] values : payload values
+ * @param[in] count : message count
+ * @param[in] rate : messages/s(0 : as fast as accepted)
+ * @param[out] p50 : median latency(usec)
+ * @param[out] p99 : 99th percentile latency(usec)
+ * @return double : messages per second, 0 if a publish failed
+ */
+static double runApi(BenchSession* device, BenchSession* controller, BENCH_API api, int qos, ArrayElement* values,
+        int count, int rate, unsigned long* p50, unsigned long* p99) {
+    char request[2048], topic[SIZE_TOPIC];
+    RPCResponse response;
+    tpPublishStats stats;
+    long long start, elapsed;
+    int i, j, len, rc = TP_SDK_SUCCESS, waited = 0;
+
+    tpSDKResetPublishStatsEx(device->client);
+    if(api == BENCH_RPC) {
+        snprintf(topic, sizeof(topic), BENCH_TOPIC_CONTROL_DOWN, BENCH_SERVICE_NAME, device->deviceName);
+        mRpc.count = count;
+        mRpc.answered = 0;
+        mRpc.qos = qos;
+        memset(mRpc.sent, 0, sizeof(long long) * count);
+    }
+    memset(&response, 0, sizeof(RPCResponse));
+    response.cmd = "jsonRpc";
+    response.jsonrpc = "2.0";
+    response.result = 1;
+    response.resultArray = values;
+
+    start = benchNow();
+    for(i = 0; i < count; i++) {
+        benchPace(start, i, rate);
+        do {
+            switch(api) {
+                case BENCH_TELEMETRY:
+                    rc = tpSimpleTelemetryQosEx(device->client, values, 0, qos);
+                    break;
+                case BENCH_ATTRIBUTE:
+                    rc = tpSimpleAttributeQosEx(device->client, values, qos);
+                    break;
+                case BENCH_RESULT:
+                    response.id = i;
+                    rc = tpSimpleResultQosEx(device->client, &response, qos);
+                    break;
+                default:
+                    len = snprintf(request, sizeof(request), "{\"jsonrpc\":\"2.0\",\"id\":%d,\"method\":\"tp_user\",\"params\":[", i);
+                    for(j = 0; j < values->total; j++) {
+                        len += snprintf(request + len, sizeof(request) - len, "%s{\"%s\":%.2f}", j ? "," : "",
+                            values->element[j].name, *(double *)values->element[j].value);
+                    }
+                    snprintf(request + len, sizeof(request) - len, "]}");
+                    mRpc.sent[i] = benchNow();
+                    rc = tpMQTTPublishEx(controller->client, topic, request, strlen(request), qos, NULL, NULL);
+                    break;
+            }
+            if(rc == TP_SDK_MQTT_MAX_MESSAGES_INFLIGHT) usleep(50);
+        } while(rc == TP_SDK_MQTT_MAX_MESSAGES_INFLIGHT);
+        if(rc != TP_SDK_SUCCESS) {
+            fprintf(stderr, "%s publish failed : %d\n", mApiNames[api], rc);
+            return 0;
+        }
+    }
+    if(api == BENCH_RPC) {
+        // QoS 0 requests or answers may be dropped by the broker under load
+        while(__atomic_load_n(&mRpc.answered, __ATOMIC_ACQUIRE) < count && waited < BENCH_RPC_TIMEOUT_MS) {
+            usleep(1000);
+            waited++;
+        }
+        benchDrain(controller);
+    }
+    benchDrain(device);
+    elapsed = benchNow() - start;
+
+    if(api == BENCH_RPC) {
+        if(mRpc.answered == 0) return 0;
+        qsort(mRpc.rtt, mRpc.answered, sizeof(long), benchCompareLong);
+        *p50 = mRpc.rtt[(mRpc.answered - 1) * 50 / 100];
+        *p99 = mRpc.rtt[(mRpc.answered - 1) * 99 / 100];
+        return mRpc.answered / (elapsed / 1e9);
+    }
+    tpSDKGetPublishStatsEx(device->client, mApiClasses[api], &stats);
+    *p50 = stats.p50;
+    *p99 = stats.p99;
+    return count / (elapsed / 1e9);
+}
+
+/**
+ * @brief destroy a session while QoS 1 publish futures wait in its pending queue
+ * @param[in] host : broker host
+ * @param[in] port : broker port
+ * @param[in] count : publish count
+ * @return int : 0 if every future completed
+ */
+static int checkDestroyPending(char* host, int port, int count) {
+    BenchSession session;
+    tpFuture** futures = (tpFuture **)calloc(count, sizeof(tpFuture *));
+    char payload[] = "{\"value\":1}";
+    int i, rc, completed = 0, incomplete = 0;
+
+    if(futures == NULL) return -1;
+    // one in-flight slot, the rest of the publishes stay in the pending queue
+    if(benchConnectFlow(&session, host, port, "loopdestroy", 0, BENCH_DESTROY_INFLIGHT, count) != 0) {
+        fprintf(stderr, "cannot connect to %s:%d\n", host, port);
+        benchClose(&session);
+        free(futures);
+        return -1;
+    }
+    for(i = 0; i < count; i++) {
+        futures[i] = tpMQTTPublishFutureEx(session.client, session.topicControlDown, payload, strlen(payload), 1);
+    }
+    benchClose(&session);
+
+    rc = tpFutureWaitAll(futures, count, BENCH_DESTROY_FUTURE_TIMEOUT_MS);
+    for(i = 0; i < count; i++) {
+        if(futures[i] == NULL) continue;
+        if(tpFuturePoll(futures[i])) completed++;
+        if(tpFutureResult(futures[i]) == TP_SDK_MQTT_OPERATION_INCOMPLETE) incomplete++;
+        tpFutureRelease(futures[i]);
+    }
+    free(futures);
+    printf("destroy with pending futures : %d/%d completed, %d incomplete\n", completed, count, incomplete);
+    return rc == TP_SDK_SUCCESS ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+    char* host = argc > 1 ? argv[1] : BENCH_HOST;
+    int port = argc > 2 ? atoi(argv[2]) : BENCH_PORT;
+    int count = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_COUNT;
+    char upTopic[SIZE_TOPIC];
+    int api, qos, size, rate, i;
+    BenchSession device, controller;
+    ArrayElement values;
+    tpFuture* future;
+
+    for(i = 0; i < BENCH_MAX_ELEMENTS; i++) {
+        snprintf(mNames[i], sizeof(mNames[i]), "value%d", i);
+        mValues[i] = 20.0 + i;
+        mElements[i].type = JSON_TYPE_DOUBLE;
+        mElements[i].name = mNames[i];
+        mElements[i].value = &mValues[i];
+    }
+    mRpc.sent = (long long *)calloc(count, sizeof(long long));
+    mRpc.rtt = (long *)calloc(count, sizeof(long));
+    if(count <= 0 || mRpc.sent == NULL || mRpc.rtt == NULL) return 1;
+
+    if(benchConnect(&device, host, port, "loopdevice") != 0 || benchConnect(&controller, host, port, "loopcontrol") != 0) {
+        fprintf(stderr, "cannot connect to %s:%d\n", host, port);
+        benchClose(&device);
+        benchClose(&controller);
+        return 1;
+    }
+
+    printf("%-10s %4s %8s %8s %12s %10s %10s %8s %10s\n",
+        "api", "qos", "values", "rate", "messages/s", "p50(us)", "p99(us)", "cpu%", "rss(KB)");
+    for(qos = 0; qos <= 2; qos++) {
+        // the handlers take the QoS of the run
+        snprintf(upTopic, sizeof(upTopic), BENCH_TOPIC_UP, BENCH_SERVICE_NAME, device.deviceName);
+        future = tpMQTTSubscribeFutureEx(controller.client, upTopic, qos, benchControllerUp, NULL);
+        if(future) tpFutureWait(future, BENCH_CONNECT_TIMEOUT_MS);
+        tpFutureRelease(future);
+        for(size = 0; size < (int)(sizeof(mSizes) / sizeof(mSizes[0])); size++) {
+            values.total = mSizes[size];
+            values.capacity = mSizes[size];
+            values.element = mElements;
+            future = tpMQTTSubscribeFutureEx(device.client, device.topicControlDown, qos, benchDeviceControl, &values);
+            if(future) tpFutureWait(future, BENCH_CONNECT_TIMEOUT_MS);
+            tpFutureRelease(future);
+            for(api = 0; api < BENCH_API_MAX; api++) {
+                for(rate = 0; rate < (int)(sizeof(mRates) / sizeof(mRates[0])); rate++) {
+                    unsigned long p50 = 0, p99 = 0;
+                    long long cpu = benchCpu(), start = benchNow();
+                    double throughput = runApi(&device, &controller, api, qos, &values, count, mRates[rate], &p50, &p99);
+                    double elapsed = (benchNow() - start) / 1e3;
+                    if(throughput == 0) continue;
+                    printf("%-10s %4d %8d %8d %12.0f %10lu %10lu %7.1f%% %10ld\n",
+                        mApiNames[api], qos, values.total, mRates[rate], throughput, p50, p99,
+                        100.0 * (benchCpu() - cpu) / elapsed, benchRss());
+                }
+            }
+        }
+    }
+
+    benchClose(&device);
+    benchClose(&controller);
+    free(mRpc.sent);
+    free(mRpc.rtt);
+    return checkDestroyPending(host, port, count) == 0 ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file QosBenchmark.c
+ *
+ * @brief telemetry throughput per QoS against a local broker
+ *
+ * usage : QosBenchmark [host] [port] [count]
+ *         (default tcp://127.0.0.1 1883 10000, e.g. mosquitto -p 1883)
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+#include "BenchmarkCommon.h"
+
+#define BENCH_DEFAULT_COUNT                 10000
+#define BENCH_TELEMETRY                     "{\"temp1\":26.5,\"humi1\":48.2,\"light1\":312,\"ts\":1500000000}"
+
+/**
+ * @brief publish count telemetry samples with the QoS and wait for completion
+ * @param[in] session : connected session
+ * @param[in] qos : QoS of the telemetry
+ * @param[in] count : message count
+ * @return double : messages per second
+ */
+static double runQos(BenchSession* session, int qos, int count) {
+    int i, rc;
+    tpSDKResetPublishStatsEx(session->client);
+    long long start = benchNow();
+    for(i = 0; i < count; i++) {
+        while((rc = tpSimpleRawTelemetryQosEx(session->client, BENCH_TELEMETRY, FORMAT_JSON, qos))
+                == TP_SDK_MQTT_MAX_MESSAGES_INFLIGHT) {
+            usleep(50);
+        }
+        if(rc != TP_SDK_SUCCESS) {
+            fprintf(stderr, "publish failed : %d\n", rc);
+            return 0;
+        }
+    }
+    benchDrain(session);
+    long long elapsed = benchNow() - start;
+    return count / (elapsed / 1e9);
+}
+
+int main(int argc, char **argv) {
+    char* host = argc > 1 ? argv[1] : BENCH_HOST;
+    int port = argc > 2 ? atoi(argv[2]) : BENCH_PORT;
+    int count = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_COUNT;
+    int qos;
+    BenchSession session;
+
+    if(benchConnect(&session, host, port, "qosbench") != 0) {
+        fprintf(stderr, "cannot connect to %s:%d\n", host, port);
+        benchClose(&session);
+        return 1;
+    }
+
+    printf("%-6s %10s %12s %10s %10s %10s\n", "qos", "messages", "messages/s", "p50(us)", "p99(us)", "max(us)");
+    for(qos = 0; qos <= 2; qos++) {
+        tpPublishStats stats;
+        double rate = runQos(&session, qos, count);
+        tpSDKGetPublishStatsEx(session.client, TOPIC_CLASS_TELEMETRY, &stats);
+        printf("%-6d %10d %12.0f %10lu %10lu %10lu\n", qos, count, rate, stats.p50, stats.p99, stats.max);
+    }
+
+    benchClose(&session);
+    return 0;
+}
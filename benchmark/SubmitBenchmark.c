@@ -0,0 +1,125 @@
+/**
+ * @file SubmitBenchmark.c
+ *
+ * @brief concurrent telemetry publishers against a local broker
+ *
+ * 1 to 32 producer threads publish telemetry of one session, in the calling threads and
+ * through the submission queue(tpSDKSetSubmitQueue), and the throughput and the time a
+ * producer spends in tpSimpleRawTelemetry are compared.
+ *
+ * usage : SubmitBenchmark [host] [port] [count]
+ *         (default tcp://127.0.0.1 1883 64000, e.g. mosquitto -p 1883)
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+#include <pthread.h>
+
+#include "BenchmarkCommon.h"
+
+#define BENCH_DEFAULT_COUNT                 64000
+#define BENCH_MAX_PRODUCERS                 32
+#define BENCH_SUBMIT_QUEUE_SIZE             4096
+#define BENCH_TELEMETRY                     "{\"temp1\":26.5,\"humi1\":48.2,\"light1\":312,\"ts\":1500000000}"
+
+/** producer thread **/
+typedef struct
+{
+    BenchSession* session;
+    /** messages to publish **/
+    int count;
+    /** time spent in the publish calls(nsec) **/
+    long long busy;
+    /** publishes refused by a full queue or in-flight window **/
+    long retries;
+    int failed;
+} BenchProducer;
+
+/**
+ * @brief publish the telemetry of a producer with QoS 0
+ * @param[in] arg : producer
+ */
+static void* runProducer(void* arg) {
+    BenchProducer* producer = (BenchProducer *)arg;
+    int i, rc;
+    long long start;
+
+    for(i = 0; i < producer->count; i++) {
+        start = benchNow();
+        rc = tpSimpleRawTelemetryQosEx(producer->session->client, BENCH_TELEMETRY, FORMAT_JSON, 0);
+        producer->busy += benchNow() - start;
+        if(rc == TP_SDK_MQTT_MAX_MESSAGES_INFLIGHT) {
+            producer->retries++;
+            i--;
+            usleep(50);
+        } else if(rc != TP_SDK_SUCCESS) {
+            fprintf(stderr, "publish failed : %d\n", rc);
+            producer->failed = 1;
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief publish count messages split over the producer threads and wait for completion
+ * @param[in] session : connected session
+ * @param[in] producers : producer thread count
+ * @param[in] count : message count
+ * @param[out] busy : mean time per publish call(nsec)
+ * @param[out] retries : refused publishes
+ * @return double : messages per second, 0 if a publish failed
+ */
+static double runProducers(BenchSession* session, int producers, int count, double* busy, long* retries) {
+    pthread_t threads[BENCH_MAX_PRODUCERS];
+    BenchProducer states[BENCH_MAX_PRODUCERS];
+    long long start, elapsed, totalBusy = 0;
+    int i, failed = 0, sent = 0;
+
+    *retries = 0;
+    start = benchNow();
+    for(i = 0; i < producers; i++) {
+        memset(&states[i], 0, sizeof(BenchProducer));
+        states[i].session = session;
+        states[i].count = count / producers;
+        pthread_create(&threads[i], NULL, runProducer, &states[i]);
+    }
+    for(i = 0; i < producers; i++) {
+        pthread_join(threads[i], NULL);
+        totalBusy += states[i].busy;
+        *retries += states[i].retries;
+        sent += states[i].count;
+        failed |= states[i].failed;
+    }
+    benchDrain(session);
+    elapsed = benchNow() - start;
+    *busy = sent ? (double)totalBusy / (sent + *retries) : 0;
+    return failed ? 0 : sent / (elapsed / 1e9);
+}
+
+int main(int argc, char **argv) {
+    char* host = argc > 1 ? argv[1] : BENCH_HOST;
+    int port = argc > 2 ? atoi(argv[2]) : BENCH_PORT;
+    int count = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_COUNT;
+    int producers, mode;
+    BenchSession session;
+
+    printf("%-8s %10s %12s %12s %10s\n", "mode", "producers", "messages/s", "call(ns)", "retries");
+    for(mode = 0; mode < 2; mode++) {
+        if(benchConnectEx(&session, host, port, mode ? "submitbench" : "directbench",
+                mode ? BENCH_SUBMIT_QUEUE_SIZE : 0) != 0) {
+            fprintf(stderr, "cannot connect to %s:%d\n", host, port);
+            benchClose(&session);
+            return 1;
+        }
+        for(producers = 1; producers <= BENCH_MAX_PRODUCERS; producers <<= 1) {
+            double busy;
+            long retries;
+            double rate = runProducers(&session, producers, count, &busy, &retries);
+            if(rate == 0) break;
+            printf("%-8s %10d %12.0f %12.0f %10ld\n", mode ? "queue" : "direct", producers, rate, busy, retries);
+        }
+        benchClose(&session);
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file WireBenchmark.c
+ *
+ * @brief PUBLISH bytes on the wire of telemetry against a local broker
+ *
+ * reports the share of the topic in each telemetry PUBLISH and the bytes
+ * MQTT 5 topic aliases would save for the sample size.
+ *
+ * usage : WireBenchmark [host] [port] [count]
+ *         (default tcp://127.0.0.1 1883 1000, e.g. mosquitto -p 1883)
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+#include "BenchmarkCommon.h"
+
+#define BENCH_DEFAULT_COUNT                 1000
+
+/** telemetry samples from one value to a batch **/
+static char* mSamples[] = {
+    "{\"temp1\":26.5}",
+    "{\"temp1\":26.5,\"humi1\":48.2,\"light1\":312}",
+    "{\"temp1\":26.5,\"humi1\":48.2,\"light1\":312,\"ts\":1500000000}",
+    "[{\"temp1\":26.5,\"humi1\":48.2,\"ts\":1500000000},{\"temp1\":26.6,\"humi1\":48.1,\"ts\":1500000001},"
+        "{\"temp1\":26.6,\"humi1\":48.0,\"ts\":1500000002},{\"temp1\":26.7,\"humi1\":47.9,\"ts\":1500000003}]"
+};
+
+/**
+ * @brief publish count samples with QoS 1 and wait for completion
+ * @param[in] session : connected session
+ * @param[in] sample : telemetry sample
+ * @param[in] count : message count
+ * @return int : 0 if all are published
+ */
+static int runSample(BenchSession* session, char* sample, int count) {
+    int i, rc;
+    tpSDKResetPublishStatsEx(session->client);
+    for(i = 0; i < count; i++) {
+        while((rc = tpSimpleRawTelemetryQosEx(session->client, sample, FORMAT_JSON, 1))
+                == TP_SDK_MQTT_MAX_MESSAGES_INFLIGHT) {
+            usleep(50);
+        }
+        if(rc != TP_SDK_SUCCESS) {
+            fprintf(stderr, "publish failed : %d\n", rc);
+            return -1;
+        }
+    }
+    benchDrain(session);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    char* host = argc > 1 ? argv[1] : BENCH_HOST;
+    int port = argc > 2 ? atoi(argv[2]) : BENCH_PORT;
+    int count = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_COUNT;
+    int i;
+    BenchSession session;
+
+    if(benchConnect(&session, host, port, "wirebench") != 0) {
+        fprintf(stderr, "cannot connect to %s:%d\n", host, port);
+        benchClose(&session);
+        return 1;
+    }
+
+    printf("%8s %10s %10s %10s %8s %14s\n", "payload", "wire/msg", "topic/msg", "overhead", "topic%", "alias saving%");
+    for(i = 0; i < (int)(sizeof(mSamples) / sizeof(mSamples[0])); i++) {
+        tpWireStats stats;
+        if(runSample(&session, mSamples[i], count) != 0) break;
+        tpSDKGetWireStatsEx(session.client, TOPIC_CLASS_TELEMETRY, &stats);
+        if(stats.messages == 0) continue;
+        printf("%8lu %10llu %10llu %10llu %7.1f%% %13.1f%%\n",
+            (unsigned long)strlen(mSamples[i]),
+            stats.wireBytes / stats.messages,
+            stats.topicBytes / stats.messages,
+            (stats.wireBytes - stats.payloadBytes) / stats.messages,
+            100.0 * stats.topicBytes / stats.wireBytes,
+            100.0 * stats.aliasSavings / stats.wireBytes);
+    }
+
+    benchClose(&session);
+    return 0;
+}
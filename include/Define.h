@@ -106,6 +106,9 @@
 
 #define TOPIC_UP                    "v1/dev/%s/%s/up"
 
+/** suffix of the topics carrying zlib streams with the preset dictionary of MQTTDeflate.c **/
+#define TOPIC_DEFLATE_SUFFIX        "/deflate"
+
 /* CONNACK : 0 Connection Accepted */
 #define CONNECTION_ACCEPTED 0
 /* CONNACK : 1 Connection Refused, unacceptable protocol version */
@@ -153,8 +156,16 @@
 #define TP_SDK_NOT_SUPPORTED -13
 /* Return code: Parameter is invalid */
 #define TP_SDK_INVALID_PARAMETER -14
+/* Return code: the operation is not completed within the wait time */
+#define TP_SDK_TIMEOUT -15
+/* Return code: the request is stored while disconnected and sent at the next connect without completion report */
+#define TP_SDK_OFFLINE_QUEUED -16
  
 /* topic size */
 #define SIZE_TOPIC              128
+/* JSON payload size written on the stack, a larger payload is moved to the heap */
+#define SIZE_JSON               1024
+/* initial size of the added content data, doubled when it is outgrown */
+#define SIZE_CONTENT            256
 
 #endif
@@ -10,6 +10,18 @@
 #ifndef _MQTT_H_
 #define _MQTT_H_
 
+#include <pthread.h>
+
+#include "MQTTAsync.h"
+#include "MQTTQueue.h"
+#include "MQTTOffline.h"
+#include "MQTTPersistence.h"
+#include "MQTTHistogram.h"
+#include "MQTTTopic.h"
+#include "MQTTDispatch.h"
+#include "MQTTSubmit.h"
+#include "MQTTCoalesce.h"
+#include "MQTTDeflate.h"
 #include "ThingPlug.h"
 
 /*
@@ -24,15 +36,154 @@
  * Structure Definition
  ****************************************
  */
+/** content builder of tpSimpleAddData. the buffer is kept after a publish and reused. **/
 typedef struct
 {
-	/** data **/
+	/** data(null terminated) **/
 	char* data;
 	/** length **/
 	size_t len;
+	/** allocated size of data **/
+	size_t capacity;
 } Content;
 
-extern Content* gContent;
+/** MQTT topic length **/
+#define SIZE_MQTT_TOPIC             128
+
+/** one device session(MQTT connection and Simple API state) **/
+struct tpClient
+{
+	/** paho client handle **/
+	MQTTAsync handle;
+	/** authentication user name **/
+	char userName[32];
+	/** authentication password **/
+	char userPass[90];
+	/** MQTT protocol version(MQTTVERSION_DEFAULT, 3.1 or 3.1.1) **/
+	int mqttVersion;
+	/** default publish topic **/
+	char publishTopic[SIZE_MQTT_TOPIC];
+	/** subscriptions(create topics and tpMQTTSubscribe) **/
+	MQTTTopicTree subscriptions;
+	/** subscription lock **/
+	pthread_mutex_t subscribeLock;
+	/** reconnected flag **/
+	int reconnected;
+	/** minimum reconnect interval in seconds(tpSDKSetReconnect, 0 : no reconnect) **/
+	int reconnectMin;
+	/** maximum reconnect interval in seconds **/
+	int reconnectMax;
+	/** reconnect attempts since the last connection **/
+	int reconnectAttempt;
+	/** a reconnect is scheduled at reconnectAt **/
+	int reconnectDue;
+	/** scheduled reconnect time(CLOCK_REALTIME) **/
+	struct timespec reconnectAt;
+	/** jitter random seed **/
+	unsigned int reconnectSeed;
+	/** reconnect thread is running **/
+	int reconnectRunning;
+	/** reconnect thread stop request **/
+	int reconnectStop;
+	/** reconnect thread **/
+	pthread_t reconnectThread;
+	/** reconnect lock **/
+	pthread_mutex_t reconnectLock;
+	/** reconnect schedule condition **/
+	pthread_cond_t reconnectCond;
+	/** QoS policy per topic class **/
+	int qos[TOPIC_CLASS_MAX];
+	/** maximum in-flight messages(0 : paho default) **/
+	int maxInflight;
+	/** maximum pending publishes while the in-flight window is full(0 : no pending queue) **/
+	int maxPending;
+	/** pending count which pauses producers **/
+	int highWatermark;
+	/** pending count which resumes producers **/
+	int lowWatermark;
+	/** producers are paused **/
+	int paused;
+	/** pending queue is being drained **/
+	int draining;
+	/** publishes waiting for an in-flight slot **/
+	MQTTQueue pending;
+	/** pending queue lock **/
+	pthread_mutex_t pendingLock;
+	/** in-flight state persistence(tpSDKSetPersistence) **/
+	MQTTPersistenceConfig persistenceConfig;
+	/** paho persistence interface **/
+	MQTTClient_persistence persistence;
+	/** publishes made while disconnected(tpSDKSetOfflineQueue) **/
+	MQTTOffline offline;
+	/** publish latency per topic class **/
+	MQTTHistogram latency[TOPIC_CLASS_MAX];
+	/** failed publishes per topic class **/
+	unsigned long publishFailed[TOPIC_CLASS_MAX];
+	/** PUBLISH bytes per topic class **/
+	tpWireStats wire[TOPIC_CLASS_MAX];
+	/** latency and connect timing lock **/
+	pthread_mutex_t statsLock;
+	/** connection phases of the last connect **/
+	tpConnectTiming timing;
+	/** server host name of the timing record **/
+	char timingHost[128];
+	/** server port of the timing record(0 : any) **/
+	int timingPort;
+	/** create or reconnect start(monotonic usec) **/
+	unsigned long long timingStart;
+	/** connect request time **/
+	unsigned long long connectAt;
+	/** CONNACK time **/
+	unsigned long long connackAt;
+	/** waiting for the SUBACK of the connect **/
+	int timingSuback;
+	/** timingHost is watched by the connect hooks(MQTTTimingWatch) **/
+	int timingWatch;
+	/** callback workers(tpSDKSetCallbackWorkers, stopped : callbacks in the paho threads) **/
+	MQTTDispatcher dispatcher;
+	/** publish submission queue(tpSDKSetSubmitQueue, stopped : publishes in the calling thread) **/
+	MQTTSubmitQueue submit;
+	/** last delivered token **/
+	volatile MQTTAsync_token deliveredToken;
+
+	/** callbacks without handle(tpMQTTSetCallbacks) **/
+	tpMQTTConnectedCallback* connectedCallback;
+	tpMQTTSubscribedCallback* subscribedCallback;
+	tpMQTTDisconnectedCallback* disconnectedCallback;
+	tpMQTTConnectionLostCallback* connectionLostCallback;
+	tpMQTTMessageDeliveredCallback* messageDeliveredCallback;
+	tpMQTTMessageArrivedCallback* messageArrivedCallback;
+
+	/** callbacks with handle(tpMQTTSetCallbacksEx) **/
+	tpClientConnectedCallback* connectedCallbackEx;
+	tpClientSubscribedCallback* subscribedCallbackEx;
+	tpClientDisconnectedCallback* disconnectedCallbackEx;
+	tpClientConnectionLostCallback* connectionLostCallbackEx;
+	tpClientMessageDeliveredCallback* messageDeliveredCallbackEx;
+	tpClientMessageArrivedCallback* messageArrivedCallbackEx;
+
+	/** ownership transfer arrival callbacks(tpMQTTSetMessageReceivedCallback) **/
+	tpMQTTMessageReceivedCallback* messageReceivedCallback;
+	tpClientMessageReceivedCallback* messageReceivedCallbackEx;
+
+	/** flow control callbacks(tpSDKSetFlowControl) **/
+	tpMQTTFlowControlCallback* flowControlCallback;
+	tpClientFlowControlCallback* flowControlCallbackEx;
+
+	/** application context **/
+	void* context;
+
+	/** service ID(Simple API) **/
+	char* serviceID;
+	/** device ID(Simple API) **/
+	char* deviceID;
+	/** added content data(Simple API, single writer) **/
+	Content content;
+	/** telemetry coalescing(Simple API, tpSimpleSetCoalescing) **/
+	MQTTCoalesce coalesce;
+	/** JSON payload compression(Simple API, tpSimpleSetCompression) **/
+	MQTTDeflate deflate;
+};
 
 /*
  ****************************************
@@ -46,23 +197,100 @@ extern Content* gContent;
  * Major Function
  ****************************************
  */
+tpClient* MQTTClientNew();
+
+void MQTTClientFree(tpClient* client);
+
+tpClient* MQTTDefaultClient();
+
 int MQTTSetCallbacks(tpMQTTConnectedCallback* cc, tpMQTTSubscribedCallback* sc, tpMQTTDisconnectedCallback* dc,
         tpMQTTConnectionLostCallback* clc, tpMQTTMessageDeliveredCallback* mdc, tpMQTTMessageArrivedCallback* mac);
 
-int MQTTAsyncCreate(char* host, int port, int keepalive, char* userName, char* password, int enableServerCertAuth, 
+int MQTTSetCallbacksEx(tpClient* client, tpClientConnectedCallback* cc, tpClientSubscribedCallback* sc, tpClientDisconnectedCallback* dc,
+        tpClientConnectionLostCallback* clc, tpClientMessageDeliveredCallback* mdc, tpClientMessageArrivedCallback* mac);
+
+int MQTTSetMessageReceivedCallbackEx(tpClient* client, tpMQTTMessageReceivedCallback* mrc, tpClientMessageReceivedCallback* mrcEx);
+
+void MQTTMessageRelease(tpMessage* message);
+
+int MQTTSetFlowControlEx(tpClient* client, int maxInflight, int maxPending, int highWatermark, int lowWatermark,
+        tpMQTTFlowControlCallback* fcc, tpClientFlowControlCallback* fccEx);
+
+int MQTTGetPendingCountEx(tpClient* client);
+
+int MQTTSetOfflineQueueEx(tpClient* client, size_t memorySize, char* directory, size_t segmentSize, size_t maxDiskSize, int drainRate);
+
+int MQTTGetOfflineCountEx(tpClient* client);
+
+int MQTTSetPersistenceEx(tpClient* client, char* directory, size_t size);
+
+int MQTTSetReconnectEx(tpClient* client, int minInterval, int maxInterval);
+
+int MQTTGetConnectTimingEx(tpClient* client, tpConnectTiming* timing);
+
+int MQTTSetCallbackWorkersEx(tpClient* client, int workers, int queueSize);
+
+int MQTTSetSubmitQueueEx(tpClient* client, int queueSize);
+
+int MQTTSetVersionEx(tpClient* client, int version);
+
+int MQTTGetWireStatsEx(tpClient* client, TOPIC_CLASS topicClass, tpWireStats* stats);
+
+int MQTTAsyncCreate(char* host, int port, int keepalive, char* userName, char* password, int enableServerCertAuth,
+         char* subscribeTopic[], int subscribeTopicSize, char* publishTopic, char* enabledCipherSuites, int cleanSession, char* clientID);
+
+int MQTTAsyncCreateEx(tpClient* client, char* host, int port, int keepalive, char* userName, char* password, int enableServerCertAuth,
          char* subscribeTopic[], int subscribeTopicSize, char* publishTopic, char* enabledCipherSuites, int cleanSession, char* clientID);
-         
+
 int MQTTAsyncSubscribe(char* topic, int qos);
 
+int MQTTAsyncSubscribeEx(tpClient* client, char* topic, int qos);
+
+int MQTTSubscribeHandlerEx(tpClient* client, char* filter, int qos,
+        tpMQTTTopicHandler* handler, tpClientTopicHandler* handlerEx, void* context, tpFuture* future);
+
+tpFuture* MQTTSubscribeFutureEx(tpClient* client, char* filter, int qos,
+        tpMQTTTopicHandler* handler, tpClientTopicHandler* handlerEx, void* context);
+
+int MQTTUnsubscribeEx(tpClient* client, char* filter);
+
 int MQTTAsyncPublishMessage(char* payload);
 
+int MQTTAsyncPublishMessageEx(tpClient* client, char* payload);
+
 int MQTTAsyncPublishMessageWithTopic(char* topic, char* payload);
 
+int MQTTAsyncPublishMessageWithTopicEx(tpClient* client, char* topic, char* payload);
+
+int MQTTAsyncPublishMessageQosEx(tpClient* client, char* topic, char* payload, int qos);
+
+int MQTTAsyncPublishBuffer(char* topic, const void* payload, size_t len, int qos);
+
+int MQTTAsyncPublishBufferEx(tpClient* client, char* topic, const void* payload, size_t len, int qos);
+
+int MQTTAsyncPublishCallbackEx(tpClient* client, char* topic, const void* payload, size_t len, int qos,
+        tpMQTTPublishCallback* pc, void* context);
+
+tpFuture* MQTTAsyncPublishFutureEx(tpClient* client, char* topic, const void* payload, size_t len, int qos);
+
+int MQTTGetPublishStatsEx(tpClient* client, TOPIC_CLASS topicClass, tpPublishStats* stats);
+
+void MQTTResetPublishStatsEx(tpClient* client);
+
+int MQTTSetQosEx(tpClient* client, TOPIC_CLASS topicClass, int qos);
+
+int MQTTGetQosEx(tpClient* client, TOPIC_CLASS topicClass);
+
 int MQTTAsyncDisconnect();
 
+int MQTTAsyncDisconnectEx(tpClient* client);
+
 void MQTTAsyncDestroy();
 
+void MQTTAsyncDestroyEx(tpClient* client);
+
 int MQTTAsyncIsConnected();
 
-#endif //_MQTT_H_
+int MQTTAsyncIsConnectedEx(tpClient* client);
 
+#endif //_MQTT_H_
@@ -0,0 +1,72 @@
+/**
+ * @file MQTTCoalesce.h
+ *
+ * @brief telemetry coalescing header
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#ifndef _MQTT_COALESCE_H_
+#define _MQTT_COALESCE_H_
+
+#include <pthread.h>
+#include <time.h>
+
+#include "ThingPlug.h"
+
+/** batch size limit when no size is set **/
+#define MQTT_COALESCE_MAX_BYTES     4096
+
+/*
+ ****************************************
+ * Structure Definition
+ ****************************************
+ */
+/** JSON telemetry samples collected into one array payload **/
+typedef struct
+{
+	/** collect window in msec(0 : disabled) **/
+	int window;
+	/** batch size limit in bytes **/
+	size_t maxBytes;
+	/** raw FORMAT_JSON telemetry is collected too(tpSimpleSetCoalescingRaw) **/
+	int raw;
+	/** topic of the batch **/
+	char topic[128];
+	/** QoS of the batch **/
+	int qos;
+	/** '[' and the samples separated by ',' **/
+	char* buffer;
+	/** buffer length **/
+	size_t len;
+	/** buffer capacity **/
+	size_t capacity;
+	/** samples in the batch **/
+	int count;
+	/** flush time of the batch(CLOCK_REALTIME) **/
+	struct timespec deadline;
+	/** flush thread is running **/
+	int running;
+	/** flush thread stop request **/
+	int stop;
+	/** flush thread **/
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} MQTTCoalesce;
+
+/*
+ ****************************************
+ * Major Function
+ ****************************************
+ */
+int MQTTCoalesceSet(tpClient* client, int window, size_t maxBytes);
+
+int MQTTCoalesceAdd(tpClient* client, char* topic, const char* sample, size_t len, int qos);
+
+int MQTTCoalesceFlush(tpClient* client);
+
+void MQTTCoalesceStop(tpClient* client);
+
+#endif //_MQTT_COALESCE_H_
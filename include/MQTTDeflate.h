@@ -0,0 +1,63 @@
+/**
+ * @file MQTTDeflate.h
+ *
+ * @brief JSON payload compression header
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#ifndef _MQTT_DEFLATE_H_
+#define _MQTT_DEFLATE_H_
+
+#include <pthread.h>
+#include <zlib.h>
+
+#include "ThingPlug.h"
+
+/** deflate window bits(4KB window, payloads are small) **/
+#define MQTT_DEFLATE_WINDOW_BITS    12
+/** deflate memory level **/
+#define MQTT_DEFLATE_MEM_LEVEL      5
+
+/*
+ ****************************************
+ * Structure Definition
+ ****************************************
+ */
+/** compression of JSON payloads published to the deflate topics **/
+typedef struct
+{
+	/** smallest payload compressed in bytes(0 : disabled) **/
+	size_t threshold;
+	/** zlib compression level **/
+	int level;
+	/** deflate stream reused for every payload **/
+	z_stream stream;
+	/** stream is initialized **/
+	int ready;
+	/** compressed payload buffer **/
+	unsigned char* buffer;
+	/** buffer capacity **/
+	size_t capacity;
+	/** compression statistics **/
+	tpCompressionStats stats;
+	pthread_mutex_t lock;
+} MQTTDeflate;
+
+/*
+ ****************************************
+ * Major Function
+ ****************************************
+ */
+const unsigned char* MQTTDeflateDictionary(size_t* len);
+
+int MQTTDeflateSet(tpClient* client, size_t threshold, int level);
+
+int MQTTDeflatePublish(tpClient* client, char* topic, const void* payload, size_t len, int qos);
+
+int MQTTDeflateGetStats(tpClient* client, tpCompressionStats* stats);
+
+void MQTTDeflateStop(tpClient* client);
+
+#endif //_MQTT_DEFLATE_H_
@@ -0,0 +1,95 @@
+/**
+ * @file MQTTDispatch.h
+ *
+ * @brief callback worker pool header
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#ifndef _MQTT_DISPATCH_H_
+#define _MQTT_DISPATCH_H_
+
+#include <pthread.h>
+
+#include "ThingPlug.h"
+#include "MQTTRing.h"
+
+/** events queued per worker when no size is set **/
+#define MQTT_DISPATCH_QUEUE_SIZE    256
+
+/*
+ ****************************************
+ * Enumerations
+ ****************************************
+ */
+/** callback event type **/
+typedef enum mqtt_dispatch_type {
+    MQTT_DISPATCH_ARRIVED = 0,      // message arrived
+    MQTT_DISPATCH_DELIVERED,        // message delivered
+    MQTT_DISPATCH_CONNECTED,        // connect result
+    MQTT_DISPATCH_SUBSCRIBED,       // subscribe result
+    MQTT_DISPATCH_DISCONNECTED,     // disconnect result
+    MQTT_DISPATCH_CONNECTION_LOST   // connection lost
+} MQTT_DISPATCH_TYPE;
+
+/*
+ ****************************************
+ * Structure Definition
+ ****************************************
+ */
+/** callback event handed from a paho thread to a worker **/
+typedef struct
+{
+	/** event type **/
+	MQTT_DISPATCH_TYPE type;
+	/** session handle **/
+	tpClient* client;
+	/** topic(arrived, owned by the event) **/
+	char* topic;
+	/** topic length(arrived) **/
+	int topicLen;
+	/** message(arrived, owned by the event) **/
+	MQTTAsync_message* message;
+	/** result code or token **/
+	int result;
+	/** cause(connection lost, owned by the event) **/
+	char* cause;
+} MQTTDispatchEvent;
+
+typedef void MQTTDispatchHandler(MQTTDispatchEvent* event);
+
+/** worker with its own bounded multi-producer ring **/
+typedef struct
+{
+	/** events, the ring consumer is the worker thread **/
+	MQTTRing ring;
+	MQTTDispatchHandler* handler;
+} MQTTDispatchWorker;
+
+/** worker pool. an event key selects the worker, so events of a key are handled in order **/
+typedef struct
+{
+	MQTTDispatchWorker* workers;
+	/** worker count(0 : stopped) **/
+	int count;
+	/** events refused because the ring was full **/
+	unsigned long overflow;
+} MQTTDispatcher;
+
+/*
+ ****************************************
+ * Major Function
+ ****************************************
+ */
+int MQTTDispatchStart(MQTTDispatcher* dispatcher, int workers, int queueSize, MQTTDispatchHandler* handler);
+
+int MQTTDispatchStop(MQTTDispatcher* dispatcher);
+
+int MQTTDispatchPush(MQTTDispatcher* dispatcher, unsigned int key, const MQTTDispatchEvent* event);
+
+int MQTTDispatchPushWait(MQTTDispatcher* dispatcher, unsigned int key, const MQTTDispatchEvent* event);
+
+unsigned int MQTTDispatchKey(const char* topic, int topicLen);
+
+#endif //_MQTT_DISPATCH_H_
@@ -0,0 +1,68 @@
+/**
+ * @file MQTTFuture.h
+ *
+ * @brief completion handle of publish and subscribe header
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#ifndef _MQTT_FUTURE_H_
+#define _MQTT_FUTURE_H_
+
+#include <pthread.h>
+
+#include "ThingPlug.h"
+
+/*
+ ****************************************
+ * Structure Definition
+ ****************************************
+ */
+/** completion of a publish or subscribe, shared by the SDK and the application **/
+struct tpFuture
+{
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	/** references(SDK completion, application) **/
+	int refs;
+	/** completed **/
+	int done;
+	/** result code **/
+	int result;
+	/** message token(publish) **/
+	int token;
+	/** latency(usec, publish) **/
+	unsigned long latency;
+	/** completion callback **/
+	tpFutureCallback* callback;
+	/** completion callback context **/
+	void* context;
+};
+
+/*
+ ****************************************
+ * Major Function
+ ****************************************
+ */
+tpFuture* MQTTFutureNew();
+
+void MQTTFutureComplete(tpFuture* future, int token, int result, unsigned long latency);
+
+void MQTTFuturePublished(void* context, int token, int result, unsigned long latency);
+
+int MQTTFutureWait(tpFuture* future, int timeout);
+
+int MQTTFutureWaitAll(tpFuture* futures[], int count, int timeout);
+
+int MQTTFuturePoll(tpFuture* future);
+
+int MQTTFutureResult(tpFuture* future);
+
+int MQTTFutureToken(tpFuture* future);
+
+int MQTTFutureThen(tpFuture* future, tpFutureCallback* callback, void* context);
+
+void MQTTFutureRelease(tpFuture* future);
+
+#endif //_MQTT_FUTURE_H_
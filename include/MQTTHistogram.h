@@ -0,0 +1,49 @@
+/**
+ * @file MQTTHistogram.h
+ *
+ * @brief MQTT latency histogram header
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#ifndef _MQTT_HISTOGRAM_H_
+#define _MQTT_HISTOGRAM_H_
+
+/** sub buckets per power of two(relative error 1/16) **/
+#define MQTT_HISTOGRAM_SUB_BUCKETS  16
+/** bucket count. values up to 2^37 usec(about 38 hours) are kept **/
+#define MQTT_HISTOGRAM_BUCKETS      (MQTT_HISTOGRAM_SUB_BUCKETS * 34)
+
+/*
+ ****************************************
+ * Structure Definition
+ ****************************************
+ */
+/** log-linear(HDR style) histogram of latencies in usec. not thread safe, the owner locks it **/
+typedef struct
+{
+	/** count per bucket **/
+	unsigned int counts[MQTT_HISTOGRAM_BUCKETS];
+	/** recorded values **/
+	unsigned long total;
+	/** sum of recorded values **/
+	unsigned long long sum;
+	/** minimum value **/
+	unsigned long min;
+	/** maximum value **/
+	unsigned long max;
+} MQTTHistogram;
+
+/*
+ ****************************************
+ * Major Function
+ ****************************************
+ */
+void MQTTHistogramRecord(MQTTHistogram* histogram, unsigned long value);
+
+unsigned long MQTTHistogramPercentile(MQTTHistogram* histogram, double percentile);
+
+void MQTTHistogramReset(MQTTHistogram* histogram);
+
+#endif //_MQTT_HISTOGRAM_H_
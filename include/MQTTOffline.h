@@ -0,0 +1,119 @@
+/**
+ * @file MQTTOffline.h
+ *
+ * @brief MQTT offline queue header
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#ifndef _MQTT_OFFLINE_H_
+#define _MQTT_OFFLINE_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "MQTTQueue.h"
+
+/*
+ ****************************************
+ * Type Definition
+ ****************************************
+ */
+/**
+ * send a drained message.
+ * return MQTTASYNC_SUCCESS when sent, MQTTASYNC_MAX_MESSAGES_INFLIGHT or MQTTASYNC_DISCONNECTED
+ * to retry the message later, any other code drops it.
+ */
+typedef int MQTTOfflineSend(void* context, MQTTQueueMessage* message);
+
+/*
+ ****************************************
+ * Structure Definition
+ ****************************************
+ */
+/**
+ * publishes made while disconnected.
+ * the oldest records are kept in a fixed-size memory ring, newer ones spill to
+ * append-only segment files once the ring is full(or while segments exist).
+ */
+typedef struct
+{
+	/** queue is open **/
+	int enabled;
+	/** lock **/
+	pthread_mutex_t lock;
+	/** signalled on put, connect and close **/
+	pthread_cond_t cond;
+
+	/** memory ring **/
+	unsigned char* ring;
+	/** ring capacity in bytes **/
+	size_t ringSize;
+	/** offset of the oldest record **/
+	size_t ringHead;
+	/** used bytes **/
+	size_t ringUsed;
+	/** records in the ring **/
+	int ringCount;
+
+	/** segment directory(empty : memory only) **/
+	char directory[256];
+	/** maximum bytes of a segment file **/
+	size_t segmentSize;
+	/** maximum bytes of all segment files **/
+	size_t maxDiskSize;
+	/** bytes of all segment files **/
+	size_t diskBytes;
+	/** records in segment files **/
+	int diskCount;
+	/** oldest segment id **/
+	unsigned int firstSegment;
+	/** segment id being written **/
+	unsigned int lastSegment;
+	/** writer of the last segment **/
+	FILE* writer;
+	/** bytes of the last segment **/
+	size_t writerBytes;
+	/** reader of the first segment **/
+	FILE* reader;
+
+	/** message taken by the drain but not sent yet **/
+	MQTTQueueMessage* held;
+
+	/** session is connected **/
+	int connected;
+	/** drained messages per second(0 : unlimited) **/
+	int drainRate;
+	/** drain thread **/
+	pthread_t drainThread;
+	/** drain thread is running **/
+	int drainRunning;
+	/** drain thread is calling send **/
+	int sending;
+	/** drain send function **/
+	MQTTOfflineSend* send;
+	/** drain send context **/
+	void* sendContext;
+} MQTTOffline;
+
+/*
+ ****************************************
+ * Major Function
+ ****************************************
+ */
+int MQTTOfflineOpen(MQTTOffline* offline, size_t memorySize, const char* directory, size_t segmentSize, size_t maxDiskSize,
+        int drainRate, MQTTOfflineSend* send, void* sendContext);
+
+void MQTTOfflineClose(MQTTOffline* offline);
+
+int MQTTOfflinePut(MQTTOffline* offline, const char* topic, const void* payload, size_t len, int qos);
+
+int MQTTOfflineCount(MQTTOffline* offline);
+
+void MQTTOfflineSetConnected(MQTTOffline* offline, int connected);
+
+void MQTTOfflineWaitIdle(MQTTOffline* offline);
+
+#endif //_MQTT_OFFLINE_H_
@@ -0,0 +1,42 @@
+/**
+ * @file MQTTPersistence.h
+ *
+ * @brief MQTT persistence header(memory-mapped log)
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#ifndef _MQTT_PERSISTENCE_H_
+#define _MQTT_PERSISTENCE_H_
+
+#include <stddef.h>
+
+#include "MQTTClientPersistence.h"
+
+/*
+ ****************************************
+ * Structure Definition
+ ****************************************
+ */
+/**
+ * configuration of the memory-mapped persistence.
+ * paho keeps in-flight QoS 1/2 state in one preallocated log file per client ID and server,
+ * records are appended in place and removed by flagging them, so no file is created per message.
+ */
+typedef struct
+{
+	/** log directory(empty : persistence disabled) **/
+	char directory[256];
+	/** initial log file size in bytes. the log grows when live records do not fit **/
+	size_t size;
+} MQTTPersistenceConfig;
+
+/*
+ ****************************************
+ * Major Function
+ ****************************************
+ */
+void MQTTPersistenceInit(MQTTClient_persistence* persistence, MQTTPersistenceConfig* config);
+
+#endif //_MQTT_PERSISTENCE_H_
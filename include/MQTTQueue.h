@@ -0,0 +1,75 @@
+/**
+ * @file MQTTQueue.h
+ *
+ * @brief MQTT publish queue header
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#ifndef _MQTT_QUEUE_H_
+#define _MQTT_QUEUE_H_
+
+#include <stddef.h>
+
+#include "ThingPlug.h"
+
+/*
+ ****************************************
+ * Structure Definition
+ ****************************************
+ */
+/** queued publish. topic and payload are stored in the same allocation **/
+typedef struct MQTTQueueMessage
+{
+	/** next message **/
+	struct MQTTQueueMessage* next;
+	/** topic **/
+	char* topic;
+	/** payload **/
+	void* payload;
+	/** payload length **/
+	size_t len;
+	/** QoS **/
+	int qos;
+	/** completion callback(tpMQTTPublish) **/
+	tpMQTTPublishCallback* callback;
+	/** completion callback context **/
+	void* context;
+} MQTTQueueMessage;
+
+/** FIFO of publishes. not thread safe, the owner locks it **/
+typedef struct
+{
+	/** first message **/
+	MQTTQueueMessage* head;
+	/** last message **/
+	MQTTQueueMessage* tail;
+	/** message count **/
+	int count;
+	/** payload bytes **/
+	size_t bytes;
+} MQTTQueue;
+
+/*
+ ****************************************
+ * Major Function
+ ****************************************
+ */
+MQTTQueueMessage* MQTTQueueMessageAlloc(size_t topicLen, size_t len, int qos);
+
+MQTTQueueMessage* MQTTQueueMessageNew(const char* topic, const void* payload, size_t len, int qos);
+
+void MQTTQueueMessageFree(MQTTQueueMessage* message);
+
+void MQTTQueuePush(MQTTQueue* queue, MQTTQueueMessage* message);
+
+void MQTTQueuePushFront(MQTTQueue* queue, MQTTQueueMessage* message);
+
+MQTTQueueMessage* MQTTQueuePop(MQTTQueue* queue);
+
+void MQTTQueueClear(MQTTQueue* queue);
+
+void MQTTQueueClearResult(MQTTQueue* queue, int result);
+
+#endif //_MQTT_QUEUE_H_
@@ -0,0 +1,80 @@
+/**
+ * @file MQTTRing.h
+ *
+ * @brief bounded multi-producer ring with one consumer thread header
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#ifndef _MQTT_RING_H_
+#define _MQTT_RING_H_
+
+#include <stddef.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+/*
+ ****************************************
+ * Structure Definition
+ ****************************************
+ */
+/** item handler called in the consumer thread with a copy of the item **/
+typedef void MQTTRingHandler(void* item, void* context);
+
+/** bounded multi-producer ring drained in order by one consumer thread **/
+typedef struct
+{
+	/** cells of cellSize bytes, a sequence followed by the item. the sequence tells whether the cell is free or published for a lap **/
+	unsigned char* cells;
+	/** item size **/
+	size_t itemSize;
+	/** cell size **/
+	size_t cellSize;
+	unsigned long mask;
+	/** next cell reserved by a producer **/
+	unsigned long head;
+	/** next cell taken by the consumer **/
+	unsigned long tail;
+	/** items handled by the consumer **/
+	unsigned long done;
+	/** published item count(and one post to stop) **/
+	sem_t ready;
+	/** producers waiting for a free cell(MQTTRingPushWait) **/
+	int waiting;
+	/** posted when a cell is freed while producers wait **/
+	sem_t room;
+	/** threads waiting for the consumer(MQTTRingFlush) **/
+	int flushing;
+	/** progress lock and condition of MQTTRingFlush **/
+	pthread_mutex_t lock;
+	pthread_cond_t progress;
+	/** consumer copy of the item being handled **/
+	void* item;
+	/** items refused because the ring was full **/
+	unsigned long rejected;
+	pthread_t thread;
+	MQTTRingHandler* handler;
+	void* context;
+} MQTTRing;
+
+/*
+ ****************************************
+ * Major Function
+ ****************************************
+ */
+int MQTTRingStart(MQTTRing* ring, size_t itemSize, int size, MQTTRingHandler* handler, void* context);
+
+int MQTTRingStop(MQTTRing* ring);
+
+int MQTTRingRunning(MQTTRing* ring);
+
+int MQTTRingConsumer(MQTTRing* ring);
+
+int MQTTRingPush(MQTTRing* ring, const void* item);
+
+int MQTTRingPushWait(MQTTRing* ring, const void* item);
+
+int MQTTRingFlush(MQTTRing* ring);
+
+#endif //_MQTT_RING_H_
@@ -0,0 +1,30 @@
+/**
+ * @file MQTTSession.h
+ *
+ * @brief TLS session resumption cache header
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#ifndef _MQTT_SESSION_H_
+#define _MQTT_SESSION_H_
+
+#include <openssl/ssl.h>
+
+#include "ThingPlug.h"
+
+/*
+ ****************************************
+ * Major Function
+ ****************************************
+ */
+int MQTTSessionSetCache(int enable, char* directory);
+
+int MQTTSessionGetStats(tpTLSSessionStats* stats);
+
+void MQTTSessionPrepare(SSL* ssl);
+
+void MQTTSessionComplete(SSL* ssl, int rc);
+
+#endif //_MQTT_SESSION_H_
@@ -0,0 +1,85 @@
+/**
+ * @file MQTTSubmit.h
+ *
+ * @brief publish submission queue header
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#ifndef _MQTT_SUBMIT_H_
+#define _MQTT_SUBMIT_H_
+
+#include <pthread.h>
+
+#include "ThingPlug.h"
+#include "MQTTRing.h"
+
+/** publishes queued when no size is set **/
+#define MQTT_SUBMIT_QUEUE_SIZE      1024
+
+/*
+ ****************************************
+ * Structure Definition
+ ****************************************
+ */
+/** publish handed from a producer thread to the dispatcher **/
+typedef struct
+{
+	/** session handle **/
+	tpClient* client;
+	/** topic(owned by the submission, payload follows in the same allocation) **/
+	char* topic;
+	/** payload **/
+	void* payload;
+	/** payload length **/
+	size_t len;
+	/** QoS **/
+	int qos;
+	/** completion callback **/
+	tpMQTTPublishCallback* callback;
+	/** completion callback context **/
+	void* context;
+} MQTTSubmission;
+
+typedef void MQTTSubmitHandler(MQTTSubmission* submission);
+
+/** bounded multi-producer ring drained by one dispatcher thread **/
+typedef struct
+{
+	/** submissions, the ring consumer is the dispatcher thread **/
+	MQTTRing ring;
+	MQTTSubmitHandler* handler;
+	/** stop request, the queued submissions are handled once without retry **/
+	int stopping;
+	/** in-flight slot lock and condition, the dispatcher waits on it while paho refuses publishes **/
+	pthread_mutex_t slotLock;
+	pthread_cond_t slotCond;
+	/** freed in-flight slot count **/
+	unsigned long slots;
+} MQTTSubmitQueue;
+
+/*
+ ****************************************
+ * Major Function
+ ****************************************
+ */
+int MQTTSubmitStart(MQTTSubmitQueue* queue, int queueSize, MQTTSubmitHandler* handler);
+
+int MQTTSubmitStop(MQTTSubmitQueue* queue);
+
+int MQTTSubmitRunning(MQTTSubmitQueue* queue);
+
+int MQTTSubmitStopping(MQTTSubmitQueue* queue);
+
+int MQTTSubmitPush(MQTTSubmitQueue* queue, const MQTTSubmission* submission);
+
+int MQTTSubmitFlush(MQTTSubmitQueue* queue);
+
+unsigned long MQTTSubmitSlots(MQTTSubmitQueue* queue);
+
+void MQTTSubmitSlotWait(MQTTSubmitQueue* queue, unsigned long slots);
+
+void MQTTSubmitSlotFreed(MQTTSubmitQueue* queue);
+
+#endif //_MQTT_SUBMIT_H_
@@ -0,0 +1,62 @@
+/**
+ * @file MQTTTiming.h
+ *
+ * @brief connection establishment timing header
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#ifndef _MQTT_TIMING_H_
+#define _MQTT_TIMING_H_
+
+#include <sys/socket.h>
+
+/*
+ ****************************************
+ * Structure Definition
+ ****************************************
+ */
+/** socket phases of a connection opened by paho(usec) **/
+typedef struct
+{
+	/** resolved host name **/
+	char host[128];
+	/** peer port **/
+	int port;
+	/** socket **/
+	int fd;
+	/** name resolution time **/
+	unsigned long dns;
+	/** connect() call time(monotonic) **/
+	unsigned long long connectAt;
+	/** first SSL_connect() call time(0 : not TLS) **/
+	unsigned long long tlsStart;
+	/** TLS handshake end time **/
+	unsigned long long tlsEnd;
+	/** TLS session was resumed **/
+	int resumed;
+	/** taken by a session **/
+	int claimed;
+} MQTTConnectRecord;
+
+/*
+ ****************************************
+ * Major Function
+ ****************************************
+ */
+unsigned long long MQTTTimingNow();
+
+void MQTTTimingWatch(const char* host, int watch);
+
+int MQTTTimingWatched(const char* host);
+
+void MQTTTimingResolved(const char* host, unsigned long dns);
+
+void MQTTTimingConnect(int fd, const struct sockaddr* address, unsigned long long start);
+
+void MQTTTimingHandshake(int fd, int done, int resumed);
+
+int MQTTTimingClaim(const char* host, int port, unsigned long long since, MQTTConnectRecord* record);
+
+#endif //_MQTT_TIMING_H_
@@ -0,0 +1,93 @@
+/**
+ * @file MQTTTopic.h
+ *
+ * @brief MQTT subscription table(topic filter trie) header
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#ifndef _MQTT_TOPIC_H_
+#define _MQTT_TOPIC_H_
+
+#include "ThingPlug.h"
+
+/*
+ ****************************************
+ * Structure Definition
+ ****************************************
+ */
+/** subscription of a topic filter **/
+typedef struct
+{
+	/** topic filter **/
+	char* filter;
+	/** requested QoS **/
+	int qos;
+	/** subscribed by MQTTAsyncCreateEx(replaced by the next create) **/
+	int created;
+	/** handler without handle(NULL : message arrived callback) **/
+	tpMQTTTopicHandler* handler;
+	/** handler with handle **/
+	tpClientTopicHandler* handlerEx;
+	/** handler context **/
+	void* context;
+	/** unsubscribe sent, removed when the broker acknowledges it **/
+	int unsubscribing;
+} MQTTSubscription;
+
+/** trie node of a topic level **/
+typedef struct MQTTTopicNode
+{
+	/** topic level **/
+	char* level;
+	/** children of plain levels, sorted by level **/
+	struct MQTTTopicNode** children;
+	/** child count **/
+	int childCount;
+	/** child capacity **/
+	int childCapacity;
+	/** '+' child **/
+	struct MQTTTopicNode* plus;
+	/** '#' child **/
+	struct MQTTTopicNode* hash;
+	/** subscription ending at this level **/
+	MQTTSubscription* subscription;
+} MQTTTopicNode;
+
+/** subscription table. not thread safe, the owner locks it **/
+typedef struct
+{
+	/** root node **/
+	MQTTTopicNode root;
+	/** subscription count **/
+	int count;
+} MQTTTopicTree;
+
+/*
+ ****************************************
+ * Type Definition
+ ****************************************
+ */
+typedef void MQTTTopicVisitor(MQTTSubscription* subscription, void* arg);
+
+/*
+ ****************************************
+ * Major Function
+ ****************************************
+ */
+int MQTTTopicValidFilter(const char* filter);
+
+MQTTSubscription* MQTTTopicAdd(MQTTTopicTree* tree, const char* filter);
+
+MQTTSubscription* MQTTTopicGet(MQTTTopicTree* tree, const char* filter);
+
+int MQTTTopicRemove(MQTTTopicTree* tree, const char* filter);
+
+int MQTTTopicMatch(MQTTTopicTree* tree, const char* topic, MQTTTopicVisitor* visitor, void* arg);
+
+void MQTTTopicForEach(MQTTTopicTree* tree, MQTTTopicVisitor* visitor, void* arg);
+
+void MQTTTopicClear(MQTTTopicTree* tree);
+
+#endif //_MQTT_TOPIC_H_
@@ -9,8 +9,11 @@
 #ifndef _SIMPLE_H_
 #define _SIMPLE_H_
 
+#include <stddef.h>
+
 #include "Define.h"
 #include "cJSON.h"
+#include "ThingPlug.h"
 
 /*
  ****************************************
@@ -32,6 +35,11 @@ typedef enum data_format {
     FORMAT_OFFSET             // offset format
 } DATA_FORMAT;
 
+typedef enum offset_order {
+    OFFSET_BIG_ENDIAN = 0,    // most significant byte first
+    OFFSET_LITTLE_ENDIAN      // least significant byte first
+} OFFSET_ORDER;
+
 /*
  ****************************************
  * Structure Definition
@@ -91,12 +99,46 @@ typedef enum data_format {
      unsigned int cmdId;
  } DeviceSubscribe;
  
+ typedef struct
+ {
+     /** sample time, the ts member(JSON) or first field(CSV) of the record **/
+     long long timestamp;
+     /** sample values **/
+     ArrayElement* values;
+ } TelemetrySample;
+ 
+ typedef struct
+ {
+     /** session handle **/
+     tpClient* client;
+     /** value count **/
+     int total;
+     /** value types **/
+     DATA_TYPE* types;
+     /** payload text before each value and after the last one(total + 1) **/
+     char** segments;
+     /** telemetry topic **/
+     char telemetryTopic[SIZE_TOPIC];
+     /** attribute topic **/
+     char attributeTopic[SIZE_TOPIC];
+     /** CSV telemetry topic **/
+     char telemetryCsvTopic[SIZE_TOPIC];
+     /** CSV attribute topic **/
+     char attributeCsvTopic[SIZE_TOPIC];
+     /** offset format field widths in bytes(NULL until tpSimpleSetSchemaOffset) **/
+     int* widths;
+     /** offset format record size in bytes **/
+     size_t recordSize;
+     /** offset format byte order **/
+     OFFSET_ORDER order;
+ } tpSchema;
+ 
 /*
  ****************************************
  * Major Function
  ****************************************
  */
-int tpSimpleAddData(char* data, unsigned char length);
+int tpSimpleAddData(char* data, size_t length);
  
 int tpSimpleInitialize(char* serviceID, char* deviceID);
 
@@ -113,4 +155,132 @@ int tpSimpleRawTelemetry(char* telemetry, DATA_FORMAT format);
 int tpSimpleRawAttribute(char* attribute, DATA_FORMAT format);
 
 int tpSimpleRawResult(char* result);
+
+int tpSimpleAddDataEx(tpClient* client, char* data, size_t length);
+
+int tpSimpleResetData();
+
+int tpSimpleResetDataEx(tpClient* client);
+
+int tpSimpleInitializeEx(tpClient* client, char* serviceID, char* deviceID);
+
+int tpSimpleTelemetryEx(tpClient* client, ArrayElement* telemetry, unsigned char useAddedData);
+
+int tpSimpleAttributeEx(tpClient* client, ArrayElement* attribute);
+
+int tpSimpleResultEx(tpClient* client, RPCResponse* response);
+
+int tpSimpleSubscribeEx(tpClient* client, DeviceSubscribe* subscribe);
+
+int tpSimpleRawTelemetryEx(tpClient* client, char* telemetry, DATA_FORMAT format);
+
+int tpSimpleRawAttributeEx(tpClient* client, char* attribute, DATA_FORMAT format);
+
+int tpSimpleRawResultEx(tpClient* client, char* result);
+
+int tpSimpleSetQos(TOPIC_CLASS topicClass, int qos);
+
+int tpSimpleSetQosEx(tpClient* client, TOPIC_CLASS topicClass, int qos);
+
+int tpSimpleTelemetryQos(ArrayElement* telemetry, unsigned char useAddedData, int qos);
+
+int tpSimpleTelemetryQosEx(tpClient* client, ArrayElement* telemetry, unsigned char useAddedData, int qos);
+
+int tpSimpleAttributeQos(ArrayElement* attribute, int qos);
+
+int tpSimpleAttributeQosEx(tpClient* client, ArrayElement* attribute, int qos);
+
+int tpSimpleResultQos(RPCResponse* response, int qos);
+
+int tpSimpleResultQosEx(tpClient* client, RPCResponse* response, int qos);
+
+int tpSimpleRawTelemetryQos(char* telemetry, DATA_FORMAT format, int qos);
+
+int tpSimpleRawTelemetryQosEx(tpClient* client, char* telemetry, DATA_FORMAT format, int qos);
+
+int tpSimpleRawAttributeQos(char* attribute, DATA_FORMAT format, int qos);
+
+int tpSimpleRawAttributeQosEx(tpClient* client, char* attribute, DATA_FORMAT format, int qos);
+
+int tpSimpleRawResultQos(char* result, int qos);
+
+int tpSimpleRawResultQosEx(tpClient* client, char* result, int qos);
+
+int tpSimpleRawTelemetryBinary(const void* buf, size_t len, DATA_FORMAT format);
+
+int tpSimpleRawTelemetryBinaryEx(tpClient* client, const void* buf, size_t len, DATA_FORMAT format);
+
+int tpSimpleRawTelemetryBinaryQos(const void* buf, size_t len, DATA_FORMAT format, int qos);
+
+int tpSimpleRawTelemetryBinaryQosEx(tpClient* client, const void* buf, size_t len, DATA_FORMAT format, int qos);
+
+int tpSimpleRawAttributeBinary(const void* buf, size_t len, DATA_FORMAT format);
+
+int tpSimpleRawAttributeBinaryEx(tpClient* client, const void* buf, size_t len, DATA_FORMAT format);
+
+int tpSimpleRawAttributeBinaryQos(const void* buf, size_t len, DATA_FORMAT format, int qos);
+
+int tpSimpleRawAttributeBinaryQosEx(tpClient* client, const void* buf, size_t len, DATA_FORMAT format, int qos);
+
+int tpSimpleSetCoalescing(int window, size_t maxBytes);
+
+int tpSimpleSetCoalescingEx(tpClient* client, int window, size_t maxBytes);
+
+int tpSimpleSetCoalescingRaw(int enable);
+
+int tpSimpleSetCoalescingRawEx(tpClient* client, int enable);
+
+int tpSimpleFlushTelemetry();
+
+int tpSimpleFlushTelemetryEx(tpClient* client);
+
+int tpSimpleSetCompression(size_t threshold, int level);
+
+int tpSimpleSetCompressionEx(tpClient* client, size_t threshold, int level);
+
+int tpSimpleGetCompressionStats(tpCompressionStats* stats);
+
+int tpSimpleGetCompressionStatsEx(tpClient* client, tpCompressionStats* stats);
+
+tpSchema* tpSimplePrepareSchema(char** names, DATA_TYPE* types, int n);
+
+tpSchema* tpSimplePrepareSchemaEx(tpClient* client, char** names, DATA_TYPE* types, int n);
+
+void tpSimpleFreeSchema(tpSchema* schema);
+
+int tpSimpleTelemetryPrepared(tpSchema* schema, void** values);
+
+int tpSimpleTelemetryPreparedQos(tpSchema* schema, void** values, int qos);
+
+int tpSimpleAttributePrepared(tpSchema* schema, void** values);
+
+int tpSimpleAttributePreparedQos(tpSchema* schema, void** values, int qos);
+
+int tpSimpleTelemetryPreparedCsv(tpSchema* schema, void** values);
+
+int tpSimpleTelemetryPreparedCsvQos(tpSchema* schema, void** values, int qos);
+
+int tpSimpleAttributePreparedCsv(tpSchema* schema, void** values);
+
+int tpSimpleAttributePreparedCsvQos(tpSchema* schema, void** values, int qos);
+
+int tpSimpleSetSchemaOffset(tpSchema* schema, int* widths, OFFSET_ORDER order);
+
+int tpSimpleEncodeOffset(tpSchema* schema, void** values, void* buf, size_t size, size_t* len);
+
+int tpSimpleTelemetryPreparedOffset(tpSchema* schema, void** values);
+
+int tpSimpleTelemetryPreparedOffsetQos(tpSchema* schema, void** values, int qos);
+
+int tpSimpleAttributePreparedOffset(tpSchema* schema, void** values);
+
+int tpSimpleAttributePreparedOffsetQos(tpSchema* schema, void** values, int qos);
+
+int tpSimpleTelemetryBatch(TelemetrySample* samples, int n, DATA_FORMAT format);
+
+int tpSimpleTelemetryBatchEx(tpClient* client, TelemetrySample* samples, int n, DATA_FORMAT format);
+
+int tpSimpleTelemetryBatchQos(TelemetrySample* samples, int n, DATA_FORMAT format, int qos);
+
+int tpSimpleTelemetryBatchQosEx(tpClient* client, TelemetrySample* samples, int n, DATA_FORMAT format, int qos);
 #endif
@@ -10,11 +10,37 @@
 #ifndef _THINGPLUG_H_
 #define _THINGPLUG_H_
 
+#include <stddef.h>
+
+#include "MQTTAsync.h"
+
 /*
  ****************************************
  * Enumerations
  ****************************************
  */
+/** topic class of the QoS policy **/
+typedef enum topic_class {
+    TOPIC_CLASS_TELEMETRY = 0,  // telemetry(json, csv, offset)
+    TOPIC_CLASS_ATTRIBUTE,      // attribute(json, csv, offset)
+    TOPIC_CLASS_UP,             // control result, subscribe request
+    TOPIC_CLASS_MAX
+} TOPIC_CLASS;
+
+/** flow control state of the pending publish queue **/
+typedef enum flow_control_state {
+    FLOW_CONTROL_RESUME = 0,    // pending count fell to the low watermark
+    FLOW_CONTROL_PAUSE          // pending count reached the high watermark
+} FLOW_CONTROL_STATE;
+
+/** use the QoS policy of the topic class **/
+#define TP_QOS_DEFAULT              -1
+
+/** MQTT protocol version(tpSDKSetMQTTVersion) **/
+#define TP_MQTT_VERSION_DEFAULT     0   // 3.1.1, falling back to 3.1
+#define TP_MQTT_VERSION_3_1         3
+#define TP_MQTT_VERSION_3_1_1       4
+#define TP_MQTT_VERSION_5           5   // needs paho 1.3 or later
 
 
 /*
@@ -22,6 +48,117 @@
  * Structure Definition
  ****************************************
  */
+/** device session handle(see tpClientNew) **/
+typedef struct tpClient tpClient;
+
+/** completion handle of a publish or subscribe(see tpMQTTPublishFuture) **/
+typedef struct tpFuture tpFuture;
+
+/** received message owned by the application until tpMessageRelease **/
+typedef struct
+{
+    /** topic(NUL terminated) **/
+    char* topic;
+    /** topic length **/
+    int topicLen;
+    /** payload, payload[payloadLen] is always '\0' **/
+    char* payload;
+    /** payload length **/
+    int payloadLen;
+    /** paho message(qos, retained, dup, msgid), message->payload == payload **/
+    MQTTAsync_message* message;
+} tpMessage;
+
+/** send-to-completion(PUBACK, PUBCOMP or socket write for QoS 0) latency of publishes in usec **/
+typedef struct
+{
+    /** completed publishes **/
+    unsigned long count;
+    /** failed publishes(not in the latency) **/
+    unsigned long failed;
+    /** minimum latency **/
+    unsigned long min;
+    /** maximum latency **/
+    unsigned long max;
+    /** mean latency **/
+    unsigned long mean;
+    /** median latency **/
+    unsigned long p50;
+    /** 90th percentile latency **/
+    unsigned long p90;
+    /** 99th percentile latency **/
+    unsigned long p99;
+    /** 99.9th percentile latency **/
+    unsigned long p999;
+} tpPublishStats;
+
+/** PUBLISH packet bytes sent per topic class(retransmissions and acknowledgements are not counted) **/
+typedef struct
+{
+    /** sent publishes **/
+    unsigned long messages;
+    /** PUBLISH packet bytes(fixed header, topic, packet identifier, payload) **/
+    unsigned long long wireBytes;
+    /** topic bytes **/
+    unsigned long long topicBytes;
+    /** payload bytes **/
+    unsigned long long payloadBytes;
+    /** bytes MQTT 5 topic aliases would save(topic length - 4 per message) **/
+    unsigned long long aliasSavings;
+} tpWireStats;
+
+/** JSON payload compression of a session(tpSimpleSetCompression) **/
+typedef struct
+{
+    /** payloads sent compressed **/
+    unsigned long compressed;
+    /** payloads over the threshold sent as they are(no gain) **/
+    unsigned long skipped;
+    /** JSON bytes of the compressed payloads **/
+    unsigned long long inputBytes;
+    /** deflate bytes of the compressed payloads **/
+    unsigned long long outputBytes;
+    /** thread CPU time spent compressing(usec) **/
+    unsigned long long cpuUsec;
+} tpCompressionStats;
+
+/** TLS handshakes of the process(counted when linked with -Wl,--wrap=SSL_connect) **/
+typedef struct
+{
+    /** abbreviated handshakes with a cached session **/
+    unsigned long resumed;
+    /** full handshakes **/
+    unsigned long full;
+    /** failed handshakes **/
+    unsigned long failed;
+} tpTLSSessionStats;
+
+/**
+ * connection establishment phases of the last connect or reconnect in usec.
+ * dns, tcp and tls are measured when linked with -Wl,--wrap=getaddrinfo,--wrap=connect,--wrap=SSL_connect,
+ * otherwise they are included in connack.
+ */
+typedef struct
+{
+    /** paho client and persistence creation until the connect request(0 for a reconnect) **/
+    unsigned long create;
+    /** host name resolution **/
+    unsigned long dns;
+    /** TCP connect(TLS connections, included in connack for TCP) **/
+    unsigned long tcp;
+    /** TLS handshake **/
+    unsigned long tls;
+    /** connect request to CONNACK except the phases above **/
+    unsigned long connack;
+    /** CONNACK to the SUBACK of the subscriptions **/
+    unsigned long suback;
+    /** create(or reconnect) to the SUBACK, or to the CONNACK without subscriptions **/
+    unsigned long total;
+    /** TLS session was resumed **/
+    int resumed;
+    /** all phases are done **/
+    int complete;
+} tpConnectTiming;
 
 
 /*
@@ -41,6 +178,34 @@ typedef void tpMQTTMessageDeliveredCallback(int token);
 
 typedef void tpMQTTMessageArrivedCallback(char* topic, char* payload, int payloadLen);
 
+typedef void tpClientConnectedCallback(tpClient* client, int result);
+
+typedef void tpClientSubscribedCallback(tpClient* client, int result);
+
+typedef void tpClientDisconnectedCallback(tpClient* client, int result);
+
+typedef void tpClientConnectionLostCallback(tpClient* client, char* cause);
+
+typedef void tpClientMessageDeliveredCallback(tpClient* client, int token);
+
+typedef void tpClientMessageArrivedCallback(tpClient* client, char* topic, char* payload, int payloadLen);
+
+typedef void tpMQTTMessageReceivedCallback(tpMessage* message);
+
+typedef void tpMQTTFlowControlCallback(FLOW_CONTROL_STATE state, int pending);
+
+typedef void tpClientFlowControlCallback(tpClient* client, FLOW_CONTROL_STATE state, int pending);
+
+typedef void tpClientMessageReceivedCallback(tpClient* client, tpMessage* message);
+
+typedef void tpMQTTPublishCallback(void* context, int token, int result, unsigned long latency);
+
+typedef void tpMQTTTopicHandler(char* topic, char* payload, int payloadLen, void* context);
+
+typedef void tpClientTopicHandler(tpClient* client, char* topic, char* payload, int payloadLen, void* context);
+
+typedef void tpFutureCallback(tpFuture* future, void* context);
+
 /*
  ****************************************
  * Major Function
@@ -58,5 +223,123 @@ int tpMQTTDisconnect();
 
 void tpSDKDestroy();
 
+tpClient* tpClientNew();
+
+void tpClientFree(tpClient* client);
+
+tpClient* tpClientDefault();
+
+void tpClientSetContext(tpClient* client, void* context);
+
+void* tpClientGetContext(tpClient* client);
+
+int tpMQTTSetCallbacksEx(tpClient* client, tpClientConnectedCallback* cc, tpClientSubscribedCallback* sc, tpClientDisconnectedCallback* dc,
+    tpClientConnectionLostCallback* clc, tpClientMessageDeliveredCallback* mdc, tpClientMessageArrivedCallback* mac);
+
+int tpSDKCreateEx(tpClient* client, char* host, int port, int keepalive, char* userName, char* password, int enableServerCertAuth,
+    char* subscribeTopic[], int subscribeTopicSize, char* publishTopic, char* clientID, int cleanSession);
+
+int tpMQTTIsConnectedEx(tpClient* client);
+
+int tpMQTTDisconnectEx(tpClient* client);
+
+void tpSDKDestroyEx(tpClient* client);
+
+int tpMQTTSetMessageReceivedCallback(tpMQTTMessageReceivedCallback* mrc);
+
+int tpMQTTSetMessageReceivedCallbackEx(tpClient* client, tpClientMessageReceivedCallback* mrc);
+
+void tpMessageRelease(tpMessage* message);
+
+int tpSDKSetFlowControl(int maxInflight, int maxPending, int highWatermark, int lowWatermark, tpMQTTFlowControlCallback* fcc);
+
+int tpSDKSetFlowControlEx(tpClient* client, int maxInflight, int maxPending, int highWatermark, int lowWatermark, tpClientFlowControlCallback* fcc);
+
+int tpSDKGetPendingCount();
+
+int tpSDKGetPendingCountEx(tpClient* client);
+
+int tpSDKSetOfflineQueue(size_t memorySize, char* directory, size_t segmentSize, size_t maxDiskSize, int drainRate);
+
+int tpSDKSetOfflineQueueEx(tpClient* client, size_t memorySize, char* directory, size_t segmentSize, size_t maxDiskSize, int drainRate);
+
+int tpSDKGetOfflineCount();
+
+int tpSDKGetOfflineCountEx(tpClient* client);
+
+int tpMQTTPublish(char* topic, const void* payload, size_t len, int qos, tpMQTTPublishCallback* pc, void* context);
+
+int tpMQTTPublishEx(tpClient* client, char* topic, const void* payload, size_t len, int qos, tpMQTTPublishCallback* pc, void* context);
+
+int tpSDKGetPublishStats(TOPIC_CLASS topicClass, tpPublishStats* stats);
+
+int tpSDKGetPublishStatsEx(tpClient* client, TOPIC_CLASS topicClass, tpPublishStats* stats);
+
+void tpSDKResetPublishStats();
+
+void tpSDKResetPublishStatsEx(tpClient* client);
+
+int tpSDKSetPersistence(char* directory, size_t size);
+
+int tpSDKSetPersistenceEx(tpClient* client, char* directory, size_t size);
+
+int tpSDKSetReconnect(int minInterval, int maxInterval);
+
+int tpSDKSetReconnectEx(tpClient* client, int minInterval, int maxInterval);
+
+int tpSDKSetTLSSessionCache(int enable, char* directory);
+
+int tpSDKGetTLSSessionStats(tpTLSSessionStats* stats);
+
+int tpSDKGetConnectTiming(tpConnectTiming* timing);
+
+int tpSDKGetConnectTimingEx(tpClient* client, tpConnectTiming* timing);
+
+int tpSDKSetMQTTVersion(int version);
+
+int tpSDKSetMQTTVersionEx(tpClient* client, int version);
+
+int tpSDKGetWireStats(TOPIC_CLASS topicClass, tpWireStats* stats);
+
+int tpSDKGetWireStatsEx(tpClient* client, TOPIC_CLASS topicClass, tpWireStats* stats);
+
+int tpSDKSetCallbackWorkers(int workers, int queueSize);
+
+int tpSDKSetCallbackWorkersEx(tpClient* client, int workers, int queueSize);
+
+int tpSDKSetSubmitQueue(int queueSize);
+
+int tpSDKSetSubmitQueueEx(tpClient* client, int queueSize);
+
+int tpMQTTSubscribe(char* filter, int qos, tpMQTTTopicHandler* handler, void* context);
+
+int tpMQTTSubscribeEx(tpClient* client, char* filter, int qos, tpClientTopicHandler* handler, void* context);
+
+int tpMQTTUnsubscribe(char* filter);
+
+int tpMQTTUnsubscribeEx(tpClient* client, char* filter);
+
+tpFuture* tpMQTTPublishFuture(char* topic, const void* payload, size_t len, int qos);
+
+tpFuture* tpMQTTPublishFutureEx(tpClient* client, char* topic, const void* payload, size_t len, int qos);
+
+tpFuture* tpMQTTSubscribeFuture(char* filter, int qos, tpMQTTTopicHandler* handler, void* context);
+
+tpFuture* tpMQTTSubscribeFutureEx(tpClient* client, char* filter, int qos, tpClientTopicHandler* handler, void* context);
+
+int tpFutureWait(tpFuture* future, int timeout);
+
+int tpFutureWaitAll(tpFuture* futures[], int count, int timeout);
+
+int tpFuturePoll(tpFuture* future);
+
+int tpFutureResult(tpFuture* future);
+
+int tpFutureToken(tpFuture* future);
+
+int tpFutureThen(tpFuture* future, tpFutureCallback* callback, void* context);
+
+void tpFutureRelease(tpFuture* future);
+
 #endif //_THINGPLUG_H_
 
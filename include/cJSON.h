@@ -121,6 +121,28 @@ then using the CJSON_API_VISIBILITY flag to "export" the same symbols the way CJ
 #define CJSON_NESTING_LIMIT 1000
 #endif
 
+/* Limits how deeply nested arrays/objects a cJSON_Writer can write. */
+#define CJSON_WRITER_NESTING_LIMIT 32
+
+/* Streaming writer. Renders JSON directly into a buffer without building cJSON items, in the same layout as cJSON_Print/cJSON_PrintUnformatted.
+ * The buffer given to cJSON_WriterInit may live on the stack; it is only replaced by a heap copy when the output outgrows it. */
+typedef struct cJSON_Writer
+{
+    unsigned char *buffer;
+    size_t length;
+    size_t offset;
+    size_t depth;
+    /* bit per nesting depth: the container is an array */
+    unsigned long arrays;
+    /* bit per nesting depth: the container has a member */
+    unsigned long members;
+    cJSON_bool format;
+    /* the buffer was allocated by the writer */
+    cJSON_bool owned;
+    /* a write failed, everything after it is ignored */
+    cJSON_bool failed;
+} cJSON_Writer;
+
 /* returns the version of cJSON as a string */
 CJSON_PUBLIC(const char*) cJSON_Version(void);
 
@@ -143,6 +165,29 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
 /* Render a cJSON entity to text using a buffer already allocated in memory with given length. Returns 1 on success and 0 on failure. */
 /* NOTE: cJSON is not always 100% accurate in estimating how much memory it will use, so to be safe allocate 5 bytes more than you actually need */
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format);
+/* Start writing into buffer of the given length (may be NULL/0, then the writer allocates). fmt=0 gives unformatted, =1 gives formatted */
+CJSON_PUBLIC(void) cJSON_WriterInit(cJSON_Writer *writer, char *buffer, size_t length, cJSON_bool format);
+/* Start a new document in the buffer of the writer, keeping a grown buffer for reuse. */
+CJSON_PUBLIC(void) cJSON_WriterReset(cJSON_Writer *writer);
+CJSON_PUBLIC(void) cJSON_WriterBeginObject(cJSON_Writer *writer);
+CJSON_PUBLIC(void) cJSON_WriterEndObject(cJSON_Writer *writer);
+CJSON_PUBLIC(void) cJSON_WriterBeginArray(cJSON_Writer *writer);
+CJSON_PUBLIC(void) cJSON_WriterEndArray(cJSON_Writer *writer);
+/* Write the name of the next object member. The member value is written next. */
+CJSON_PUBLIC(void) cJSON_WriterKey(cJSON_Writer *writer, const char *key);
+CJSON_PUBLIC(void) cJSON_WriterNumber(cJSON_Writer *writer, double number);
+/* Write every digit of an integer, which cJSON_WriterNumber rounds above 2^53. */
+CJSON_PUBLIC(void) cJSON_WriterInteger(cJSON_Writer *writer, long long number);
+CJSON_PUBLIC(void) cJSON_WriterString(cJSON_Writer *writer, const char *string);
+CJSON_PUBLIC(void) cJSON_WriterRaw(cJSON_Writer *writer, const char *raw);
+/* Write length bytes of raw text, which need not be null terminated. */
+CJSON_PUBLIC(void) cJSON_WriterRawLength(cJSON_Writer *writer, const char *raw, size_t length);
+CJSON_PUBLIC(void) cJSON_WriterBool(cJSON_Writer *writer, cJSON_bool boolean);
+CJSON_PUBLIC(void) cJSON_WriterNull(cJSON_Writer *writer);
+/* Returns the null terminated document and stores its length in length (may be NULL), or NULL if a write failed or a container is open. The text belongs to the writer. */
+CJSON_PUBLIC(const char *) cJSON_WriterFinish(cJSON_Writer *writer, size_t *length);
+/* Release the buffer allocated by the writer. */
+CJSON_PUBLIC(void) cJSON_WriterFree(cJSON_Writer *writer);
 /* Delete a cJSON entity and all subentities. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *c);
 
@@ -17,6 +17,16 @@
 #define MQTT_KEEP_ALIVE                     120
 #define MQTT_CLEAN_SESSION                  1
 #define MQTT_ENABLE_SERVER_CERT_AUTH        1
+#define MQTT_RECONNECT_MIN_INTERVAL         1                   // reconnect backoff start(seconds)
+#define MQTT_RECONNECT_MAX_INTERVAL         60                  // reconnect backoff limit(seconds)
+#define TLS_SESSION_DIRECTORY               "./session"         // TLS session cache directory(NULL : memory only)
+#define MQTT_CALLBACK_WORKERS               2                   // callback worker threads(0 : paho threads)
+
+#define OFFLINE_MEMORY_SIZE                 (64 * 1024)         // offline memory ring size
+#define OFFLINE_DIRECTORY                   "./offline"         // offline segment directory(NULL : memory only)
+#define OFFLINE_SEGMENT_SIZE                (256 * 1024)        // offline segment file size
+#define OFFLINE_MAX_DISK_SIZE               (16 * 1024 * 1024)  // offline segment files limit
+#define OFFLINE_DRAIN_RATE                  20                  // offline messages sent per second after reconnect
 
 #define JSON_FORMAT
 // #define CSV_FORMAT
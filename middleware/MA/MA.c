@@ -35,7 +35,6 @@
 #define SIZE_RESPONSE_CODE                  10
 #define SIZE_RESPONSE_MESSAGE               128
 // #define SIZE_TOPIC                          128
-#define SIZE_PAYLOAD                        2048
 #define SIZE_CLIENT_ID                      24
 
 static enum PROCESS_STEP
@@ -64,10 +63,29 @@ typedef struct
 static char mTopicControlDown[SIZE_TOPIC] = "";
 static char mClientID[SIZE_CLIENT_ID] = "";
 
+#ifdef CSV_FORMAT
+// CSV columns start with the time
+static char* mTelemetryNames[] = { TIMESTAMP, "temp1", "humi1", "light1" };
+static DATA_TYPE mTelemetryTypes[] = { JSON_TYPE_LONGLONG, JSON_TYPE_RAW, JSON_TYPE_RAW, JSON_TYPE_RAW };
+#else
+static char* mTelemetryNames[] = { "temp1", "humi1", "light1", TIMESTAMP };
+static DATA_TYPE mTelemetryTypes[] = { JSON_TYPE_RAW, JSON_TYPE_RAW, JSON_TYPE_RAW, JSON_TYPE_LONGLONG };
+#endif
+static char* mAttributeNames[] = { "sysAvailableMemory", "sysFirmwareVersion", "sysHardwareVersion", "sysSerialNumber",
+    "sysErrorCode", "sysNetworkType", "sysDeviceIpAddress", "sysThingPlugIpAddress",
+    "sysLocationLatitude", "sysLocationLongitude", "act7colorLed" };
+static DATA_TYPE mAttributeTypes[] = { JSON_TYPE_LONG, JSON_TYPE_STRING, JSON_TYPE_STRING, JSON_TYPE_STRING,
+    JSON_TYPE_LONG, JSON_TYPE_STRING, JSON_TYPE_STRING, JSON_TYPE_STRING,
+    JSON_TYPE_RAW, JSON_TYPE_RAW, JSON_TYPE_LONG };
+// payload skeletons and column orders prepared once in start()
+static tpSchema* mTelemetrySchema = NULL;
+static tpSchema* mAttributeSchema = NULL;
+
 static void attribute();
 static void telemetry();
 static char* make_response(RPCResponse *rsp, char* resultBody);
 
+// called again on every automatic reconnect, only updates the status
 void MQTTConnected(int result) {
     SKTDebugPrint(LOG_LEVEL_INFO, "MQTTConnected result : %d", result);
     // if connection failed
@@ -97,14 +115,7 @@ void MQTTMessageDelivered(int token) {
     SKTDebugPrint(LOG_LEVEL_INFO, "MQTTMessageDelivered token : %d, step : %d", token, mStep);
 }
 
-void MQTTMessageArrived(char* topic, char* msg, int msgLen) {
-    SKTDebugPrint(LOG_LEVEL_INFO, "MQTTMessageArrived topic : %s, step : %d", topic, mStep);
-
-	if(msg == NULL || msgLen < 1) {
-		return;
-    }
-    char payload[SIZE_PAYLOAD] = "";
-    memcpy(payload, msg, msgLen);
+static void processMessage(char* topic, char* payload) {
     SKTDebugPrint(LOG_LEVEL_INFO, "payload : %s", payload);
     
     cJSON* root = cJSON_Parse(payload);
@@ -271,15 +282,24 @@ void MQTTMessageArrived(char* topic, char* msg, int msgLen) {
             free(arrayElement);
 #endif
 #ifdef CSV_FORMAT
-            char csvAttr[256] = "";
-            snprintf(csvAttr, sizeof(csvAttr), ",,,,,,,,,,%d", act7colorLed);
-            tpSimpleRawAttribute(csvAttr, FORMAT_CSV);
+            // only the led column is updated
+            void* values[] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &act7colorLed };
+            tpSimpleAttributePreparedCsv(mAttributeSchema, values);
 #endif
         }
     }
     cJSON_Delete(root);
 }
 
+void MQTTMessageReceived(tpMessage* message) {
+    SKTDebugPrint(LOG_LEVEL_INFO, "MQTTMessageReceived topic : %s, step : %d", message->topic, mStep);
+    // payload is NUL terminated and owned until tpMessageRelease
+    if(message->payloadLen > 0) {
+        processMessage(message->topic, message->payload);
+    }
+    tpMessageRelease(message);
+}
+
 long long current_timestamp() {
     struct timeval te;
     gettimeofday(&te, NULL); // get current time
@@ -295,71 +315,32 @@ static void telemetry() {
 #ifdef JSON_FORMAT
     char *temp, *humi, *light;
     int len;
-    ArrayElement* arrayElement = calloc(1, sizeof(ArrayElement));
-    
-    arrayElement->capacity = 4;
-    arrayElement->element = calloc(1, sizeof(Element) * arrayElement->capacity);
-    Element *item;
 
-    SMAGetData(sensor_list[arrayElement->total], &temp, &len);
+    SMAGetData(sensor_list[0], &temp, &len);
     temp = SRAConvertRawData(temp);
-    item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_RAW;
-    item->name = sensor_list[arrayElement->total];
-    item->value = temp;
-    arrayElement->total++;
-
-    SMAGetData(sensor_list[arrayElement->total], &humi, &len);
+    SMAGetData(sensor_list[1], &humi, &len);
     humi = SRAConvertRawData(humi);
-    item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_RAW;
-    item->name = sensor_list[arrayElement->total];
-    item->value = humi;
-    arrayElement->total++;
-    
-    SMAGetData(sensor_list[arrayElement->total], &light, &len);
+    SMAGetData(sensor_list[2], &light, &len);
     light = SRAConvertRawData(light);
-    item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_RAW;
-    item->name = sensor_list[arrayElement->total];
-    item->value = light;
-    arrayElement->total++;
-
-    item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_LONGLONG;
-    item->name = TIMESTAMP;
     long long time = current_timestamp();
-    item->value = (void *)&time;
-    arrayElement->total++;
 
-    tpSimpleTelemetry(arrayElement, 0);
-    free(arrayElement->element);
-    free(arrayElement);
+    void* values[] = { temp, humi, light, &time };
+    tpSimpleTelemetryPrepared(mTelemetrySchema, values);
     free(temp);
     free(humi);
     free(light);
 #endif
 #ifdef CSV_FORMAT
-    char *temp, *humi, *light,time[16];
-    int len,total_len;
+    char *temp, *humi, *light;
+    int len;
 
-    long long ctime = current_timestamp();
-    snprintf(time, 16, "%lld", ctime);
-    total_len = (strlen(time) + 1);
+    long long time = current_timestamp();
     SMAGetData(sensor_list[0], &temp, &len);
-    total_len += (strlen(temp) + 1);
     SMAGetData(sensor_list[1], &humi, &len);
-    total_len += (strlen(humi) + 1);
     SMAGetData(sensor_list[2], &light, &len);
-    total_len += (strlen(light) + 1);
-
-    char* csv_data = (char *) calloc(total_len + 1, sizeof(char));
-    SRAConvertCSVData( csv_data, time);
-    SRAConvertCSVData( csv_data, temp);
-    SRAConvertCSVData( csv_data, humi);
-    SRAConvertCSVData( csv_data, light);
-    tpSimpleRawTelemetry(csv_data, FORMAT_CSV);
-    free(csv_data);
+
+    void* values[] = { &time, temp, humi, light };
+    tpSimpleTelemetryPreparedCsv(mTelemetrySchema, values);
     free(temp);
     free(humi);
     free(light);
@@ -414,124 +395,33 @@ static int getNetworkInfo(NetworkInfo* info, char* interface) {
 static void attribute() {
 
 #ifdef JSON_FORMAT
-    ArrayElement* arrayElement = calloc(1, sizeof(ArrayElement));
-    
-    arrayElement->capacity = 15;
-    arrayElement->element = calloc(1, sizeof(Element) * arrayElement->capacity);
-    
-    Element* item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_LONG;
-    item->name = "sysAvailableMemory";
     unsigned long availableMemory = getAvailableMemory();
-    item->value = &availableMemory;
-    arrayElement->total++;
-
-    item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_STRING;
-    item->name = "sysFirmwareVersion";
-    item->value = "2.0.0";
-    arrayElement->total++;
-
-    item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_STRING;
-    item->name = "sysHardwareVersion";
-    item->value = "1.0";
-    arrayElement->total++;
-
-    item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_STRING;
-    item->name = "sysSerialNumber";
-    item->value = "710DJC5I10000290";
-    arrayElement->total++;
-
-    item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_LONG;
-    item->name = "sysErrorCode";
     unsigned long errorCode = 0;
-    item->value = &errorCode;
-    arrayElement->total++;
-
-    item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_STRING;
-    item->name = "sysNetworkType";
-    item->value = "ethernet";
-    arrayElement->total++;
-
+    unsigned long act7colorLed = 0;
     NetworkInfo info;
     memset(&info, 0, sizeof(NetworkInfo));
     getNetworkInfo(&info, "eth0");
-    item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_STRING;
-    item->name = "sysDeviceIpAddress";
-    item->value = info.deviceIpAddress;
-    arrayElement->total++;
-
-    item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_STRING;
-    item->name = "sysThingPlugIpAddress";
-    item->value = MQTT_HOST;
-    arrayElement->total++;
-
-    item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_RAW;
-    item->name = "sysLocationLatitude";    
-    item->value = "37.380257";
-    arrayElement->total++;
-
-    item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_RAW;
-    item->name = "sysLocationLongitude";
-    item->value = "127.115479";
-    arrayElement->total++;
-
-    item = arrayElement->element + arrayElement->total;
-    item->type = JSON_TYPE_LONG;
-    item->name = "act7colorLed";
-    unsigned long act7colorLed = 0;
-    item->value = &act7colorLed;
-    arrayElement->total++;
 
-    tpSimpleAttribute(arrayElement);
-    free(arrayElement->element);
-    free(arrayElement);
+    void* values[] = { &availableMemory, "2.0.0", "1.0", "710DJC5I10000290",
+        &errorCode, "ethernet", info.deviceIpAddress, MQTT_HOST,
+        "37.380257", "127.115479", &act7colorLed };
+    tpSimpleAttributePrepared(mAttributeSchema, values);
 
     mStep = PROCESS_TELEMETRY;
 #endif
 #ifdef CSV_FORMAT
-    char csv_attr[256] = "";
     unsigned long availableMemory = getAvailableMemory();
-    char tmp[64];
-    snprintf( tmp, 64, "%lu", availableMemory );
-    // Memory 
-    SRAConvertCSVData( csv_attr, tmp);
-    // SW Version
-    SRAConvertCSVData( csv_attr, "2.0.0");
-    // HW Version
-    SRAConvertCSVData( csv_attr, "1.0");
-    //Serial
-    SRAConvertCSVData( csv_attr, "710DJC5I10000290");
     unsigned long errorCode = 0;
-    snprintf( tmp, 64, "%d", errorCode);
-    //Error code
-    SRAConvertCSVData( csv_attr, tmp);
-    //NetworkType
-    SRAConvertCSVData( csv_attr, "ethernet");
+    unsigned long act7colorLed = 0;
     NetworkInfo info;
     memset(&info, 0, sizeof(NetworkInfo));
     getNetworkInfo(&info, "eth0");
-    //IPAddr
-    SRAConvertCSVData( csv_attr, info.deviceIpAddress);
-    //ServerIPAddr
-    SRAConvertCSVData( csv_attr, MQTT_HOST); 
-    //Latitude
-    SRAConvertCSVData( csv_attr, "37.380257"); 
-    //Longitude
-    SRAConvertCSVData( csv_attr, "127.115479"); 
-    //Led
-    unsigned long act7colorLed = 0;
-    snprintf( tmp, 64, "%d", act7colorLed );
-    SRAConvertCSVData( csv_attr, tmp);
-    tpSimpleRawAttribute(csv_attr, FORMAT_CSV);
+
+    // Memory, SW Version, HW Version, Serial, Error code, NetworkType, IPAddr, ServerIPAddr, Latitude, Longitude, Led
+    void* values[] = { &availableMemory, "2.0.0", "1.0", "710DJC5I10000290",
+        &errorCode, "ethernet", info.deviceIpAddress, MQTT_HOST,
+        "37.380257", "127.115479", &act7colorLed };
+    tpSimpleAttributePreparedCsv(mAttributeSchema, values);
     
     mStep = PROCESS_TELEMETRY;
 #endif
@@ -603,11 +493,17 @@ void start() {
     RGB_LEDControl(0);
 
     // set callbacks
-    rc = tpMQTTSetCallbacks(MQTTConnected, MQTTSubscribed, MQTTDisconnected, MQTTConnectionLost, MQTTMessageDelivered, MQTTMessageArrived);
+    rc = tpMQTTSetMessageReceivedCallback(MQTTMessageReceived);
+    SKTDebugPrint(LOG_LEVEL_INFO, "tpMQTTSetMessageReceivedCallback result : %d", rc);
+    rc = tpMQTTSetCallbacks(MQTTConnected, MQTTSubscribed, MQTTDisconnected, MQTTConnectionLost, MQTTMessageDelivered, NULL);
     SKTDebugPrint(LOG_LEVEL_INFO, "tpMQTTSetCallbacks result : %d", rc);
     // Simple SDK initialize
     rc = tpSimpleInitialize(SIMPLE_SERVICE_NAME, SIMPLE_DEVICE_NAME);
     SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleInitialize : %d", rc);
+    if(!mTelemetrySchema) {
+        mTelemetrySchema = tpSimplePrepareSchema(mTelemetryNames, mTelemetryTypes, sizeof(mTelemetryTypes) / sizeof(DATA_TYPE));
+        mAttributeSchema = tpSimplePrepareSchema(mAttributeNames, mAttributeTypes, sizeof(mAttributeTypes) / sizeof(DATA_TYPE));
+    }
     // create clientID - MAC address
     char* macAddress = GetMacAddressWithoutColon();
     snprintf(mClientID, sizeof(mClientID), MQTT_CLIENT_ID, SIMPLE_DEVICE_NAME, macAddress);
@@ -633,17 +529,24 @@ void start() {
 int MARun() {
     SKTDebugInit(1, LOG_LEVEL_INFO, NULL);
 	SKTDebugPrint(LOG_LEVEL_INFO, "ThingPlug_Simple_SDK");
+    // keep telemetry while disconnected
+    int rc = tpSDKSetOfflineQueue(OFFLINE_MEMORY_SIZE, OFFLINE_DIRECTORY, OFFLINE_SEGMENT_SIZE, OFFLINE_MAX_DISK_SIZE, OFFLINE_DRAIN_RATE);
+    SKTDebugPrint(LOG_LEVEL_INFO, "tpSDKSetOfflineQueue result : %d", rc);
+    // the SDK reconnects with backoff and keeps the subscriptions
+    rc = tpSDKSetReconnect(MQTT_RECONNECT_MIN_INTERVAL, MQTT_RECONNECT_MAX_INTERVAL);
+    SKTDebugPrint(LOG_LEVEL_INFO, "tpSDKSetReconnect result : %d", rc);
+    // abbreviated TLS handshakes on reconnects and restarts
+    rc = tpSDKSetTLSSessionCache(1, TLS_SESSION_DIRECTORY);
+    SKTDebugPrint(LOG_LEVEL_INFO, "tpSDKSetTLSSessionCache result : %d", rc);
+    // control messages drive actuators, keep them off the paho receive thread
+    rc = tpSDKSetCallbackWorkers(MQTT_CALLBACK_WORKERS, 0);
+    SKTDebugPrint(LOG_LEVEL_INFO, "tpSDKSetCallbackWorkers result : %d", rc);
     start();
 
     while (mStep < PROCESS_END) {
-		if(tpMQTTIsConnected() && mStep == PROCESS_TELEMETRY) {
+		if(mStep == PROCESS_TELEMETRY) {
             telemetry();
         } 
-        // reconnect when disconnected 
-        else if(mConnectionStatus == DISCONNECTED) {
-            tpSDKDestroy();
-            start();
-        }
 
         #if defined(WIN32) || defined(WIN64)
             Sleep(100);
@@ -652,5 +555,7 @@ int MARun() {
         #endif
     }
     tpSDKDestroy();
+    // write queued telemetry to disk for the next run
+    tpSDKSetOfflineQueue(0, NULL, 0, 0, 0);
     return 0;
 }
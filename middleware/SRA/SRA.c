@@ -21,10 +21,3 @@ char* SRAConvertRawData(char *raw)
 {
     return raw;
 }
-
-void SRAConvertCSVData(char *merge, char *data)
-{
-    if( strlen(merge) != 0 )
-        strncat(merge,",",strlen(","));
-    strncat(merge,data,strlen(data));
-}
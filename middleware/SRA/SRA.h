@@ -2,6 +2,5 @@
 #define _SRA_H_
 
 char* SRAConvertRawData(char *raw);
-void SRAConvertCSVData(char *merge, char *data);
 
 #endif//_SRA_H_
@@ -10,6 +10,8 @@
 #include <stddef.h>
 
 #include "MQTT.h"
+#include "MQTTSession.h"
+#include "MQTTFuture.h"
  
 
 /**
@@ -19,7 +21,7 @@
  * @param[in] dc disconnect callback
  * @param[in] clc connection lost callback
  * @param[in] mdc message delivered callback
- * @param[in] mac message arrived callback
+ * @param[in] mac message arrived callback, may be NULL when a message received callback is set
  * @return the return code of the set callbacks result
  */
 int tpMQTTSetCallbacks(tpMQTTConnectedCallback* cc, tpMQTTSubscribedCallback* sc, tpMQTTDisconnectedCallback* dc, 
@@ -74,3 +76,678 @@ void tpSDKDestroy() {
 }
 
  
+/**
+ * @brief allocate a new device session
+ * @return session handle, NULL if allocation failed
+ */
+tpClient* tpClientNew() {
+    return MQTTClientNew();
+}
+
+/**
+ * @brief destroy and free a device session
+ * @param[in] client session handle
+ */
+void tpClientFree(tpClient* client) {
+    MQTTClientFree(client);
+}
+
+/**
+ * @brief get the session used by the API without handle
+ * @return default session handle
+ */
+tpClient* tpClientDefault() {
+    return MQTTDefaultClient();
+}
+
+/**
+ * @brief set application context of the session
+ * @param[in] client session handle
+ * @param[in] context application context
+ */
+void tpClientSetContext(tpClient* client, void* context) {
+    if(client) client->context = context;
+}
+
+/**
+ * @brief get application context of the session
+ * @param[in] client session handle
+ * @return application context
+ */
+void* tpClientGetContext(tpClient* client) {
+    return client ? client->context : NULL;
+}
+
+/**
+ * @brief set callback function of the session
+ * @param[in] client session handle
+ * @param[in] cc connect callback
+ * @param[in] sc subscribe callback
+ * @param[in] dc disconnect callback
+ * @param[in] clc connection lost callback
+ * @param[in] mdc message delivered callback
+ * @param[in] mac message arrived callback, may be NULL when a message received callback is set
+ * @return the return code of the set callbacks result
+ */
+int tpMQTTSetCallbacksEx(tpClient* client, tpClientConnectedCallback* cc, tpClientSubscribedCallback* sc, tpClientDisconnectedCallback* dc,
+        tpClientConnectionLostCallback* clc, tpClientMessageDeliveredCallback* mdc, tpClientMessageArrivedCallback* mac) {
+    int rc = MQTTSetCallbacksEx(client, cc, sc, dc, clc, mdc, mac);
+    return rc;
+}
+
+/**
+ * @brief create mqtt of the session
+ * @param[in] client session handle
+ * @param[in] host the hostname or ip address of the broker to connect to.
+ * @param[in] port the network port to connect to.  Usually 1883.
+ * @param[in] keepalive the number of seconds after which the broker should send a PING message to the client if no other messages have been exchanged in that time.
+ * @param[in] userName authentication user name
+ * @param[in] password authentication password
+ * @param[in] enableServerCertAuth True/False option to enable verification of the server certificate
+ * @param[in] subscribeTopic mqtt topic
+ * @param[in] subscribeTopicSize mqtt topic size
+ * @param[in] publishTopic publish topic
+ * @param[in] clientID The client identifier passed to the server when the client connects to it.
+ * @return the return code of the connection response
+ */
+int tpSDKCreateEx(tpClient* client, char* host, int port, int keepalive, char* userName, char* password,
+        int enableServerCertAuth, char* subscribeTopic[], int subscribeTopicSize, char* publishTopic, char* clientID, int cleanSession) {
+    int rc = MQTTAsyncCreateEx(client, host, port, keepalive, userName, password, enableServerCertAuth,
+        subscribeTopic, subscribeTopicSize, publishTopic, NULL, cleanSession, clientID);
+    return rc;
+}
+
+/**
+ * @brief is connected of the session
+ * @param[in] client session handle
+ * @return true : connected <-> false
+ */
+int tpMQTTIsConnectedEx(tpClient* client) {
+    int rc = MQTTAsyncIsConnectedEx(client);
+    return rc;
+}
+
+/**
+ * @brief disconnect mqtt of the session
+ * @param[in] client session handle
+ */
+int tpMQTTDisconnectEx(tpClient* client) {
+    int rc = MQTTAsyncDisconnectEx(client);
+    return rc;
+}
+
+/**
+ * @brief destroy connection of the session. the handle can be reused with tpSDKCreateEx.
+ * @param[in] client session handle
+ */
+void tpSDKDestroyEx(tpClient* client) {
+    MQTTAsyncDestroyEx(client);
+}
+
+/**
+ * @brief set callback which takes ownership of arrived messages
+ * @param[in] mrc message received callback. the message must be released with tpMessageRelease.
+ * @return the return code of the set callback result
+ */
+int tpMQTTSetMessageReceivedCallback(tpMQTTMessageReceivedCallback* mrc) {
+    int rc = MQTTSetMessageReceivedCallbackEx(MQTTDefaultClient(), mrc, NULL);
+    return rc;
+}
+
+/**
+ * @brief set callback which takes ownership of arrived messages of the session
+ * @param[in] client session handle
+ * @param[in] mrc message received callback. the message must be released with tpMessageRelease.
+ * @return the return code of the set callback result
+ */
+int tpMQTTSetMessageReceivedCallbackEx(tpClient* client, tpClientMessageReceivedCallback* mrc) {
+    int rc = MQTTSetMessageReceivedCallbackEx(client, NULL, mrc);
+    return rc;
+}
+
+/**
+ * @brief release a received message
+ * @param[in] message message from the message received callback
+ */
+void tpMessageRelease(tpMessage* message) {
+    MQTTMessageRelease(message);
+}
+
+/**
+ * @brief set in-flight window and pending queue. call before tpSDKCreate.
+ * @param[in] maxInflight maximum in-flight messages(0 : paho default)
+ * @param[in] maxPending maximum publishes queued while the window is full(0 : no queue)
+ * @param[in] highWatermark pending count which pauses producers(0 : maxPending)
+ * @param[in] lowWatermark pending count which resumes producers(0 : half of highWatermark)
+ * @param[in] fcc flow control callback
+ * @return the return code of the set flow control result
+ */
+int tpSDKSetFlowControl(int maxInflight, int maxPending, int highWatermark, int lowWatermark, tpMQTTFlowControlCallback* fcc) {
+    int rc = MQTTSetFlowControlEx(MQTTDefaultClient(), maxInflight, maxPending, highWatermark, lowWatermark, fcc, NULL);
+    return rc;
+}
+
+/**
+ * @brief set in-flight window and pending queue of the session. call before tpSDKCreateEx.
+ * @param[in] client session handle
+ * @param[in] maxInflight maximum in-flight messages(0 : paho default)
+ * @param[in] maxPending maximum publishes queued while the window is full(0 : no queue)
+ * @param[in] highWatermark pending count which pauses producers(0 : maxPending)
+ * @param[in] lowWatermark pending count which resumes producers(0 : half of highWatermark)
+ * @param[in] fcc flow control callback
+ * @return the return code of the set flow control result
+ */
+int tpSDKSetFlowControlEx(tpClient* client, int maxInflight, int maxPending, int highWatermark, int lowWatermark, tpClientFlowControlCallback* fcc) {
+    int rc = MQTTSetFlowControlEx(client, maxInflight, maxPending, highWatermark, lowWatermark, NULL, fcc);
+    return rc;
+}
+
+/**
+ * @brief get count of publishes waiting for an in-flight slot
+ * @return pending count
+ */
+int tpSDKGetPendingCount() {
+    return MQTTGetPendingCountEx(MQTTDefaultClient());
+}
+
+/**
+ * @brief get count of publishes waiting for an in-flight slot of the session
+ * @param[in] client session handle
+ * @return pending count
+ */
+int tpSDKGetPendingCountEx(tpClient* client) {
+    return MQTTGetPendingCountEx(client);
+}
+
+/**
+ * @brief set offline queue. publishes made while disconnected are kept in a memory ring
+ * which spills to segment files in the directory, and sent after connected.
+ * the queue is kept across tpSDKDestroy. set memorySize 0 and directory NULL to close it.
+ * @param[in] memorySize memory ring size in bytes(0 : disk only)
+ * @param[in] directory segment directory(NULL : memory only). segments of a previous run are sent too.
+ * @param[in] segmentSize maximum bytes of a segment file(0 : 1MB)
+ * @param[in] maxDiskSize maximum bytes of all segment files(0 : no limit)
+ * @param[in] drainRate sent messages per second after connected(0 : unlimited)
+ * @return the return code of the set offline queue result
+ */
+int tpSDKSetOfflineQueue(size_t memorySize, char* directory, size_t segmentSize, size_t maxDiskSize, int drainRate) {
+    int rc = MQTTSetOfflineQueueEx(MQTTDefaultClient(), memorySize, directory, segmentSize, maxDiskSize, drainRate);
+    return rc;
+}
+
+/**
+ * @brief set offline queue of the session. the queue is kept across tpSDKDestroyEx and closed by tpClientFree.
+ * @param[in] client session handle
+ * @param[in] memorySize memory ring size in bytes(0 : disk only)
+ * @param[in] directory segment directory(NULL : memory only). use a different directory per session.
+ * @param[in] segmentSize maximum bytes of a segment file(0 : 1MB)
+ * @param[in] maxDiskSize maximum bytes of all segment files(0 : no limit)
+ * @param[in] drainRate sent messages per second after connected(0 : unlimited)
+ * @return the return code of the set offline queue result
+ */
+int tpSDKSetOfflineQueueEx(tpClient* client, size_t memorySize, char* directory, size_t segmentSize, size_t maxDiskSize, int drainRate) {
+    int rc = MQTTSetOfflineQueueEx(client, memorySize, directory, segmentSize, maxDiskSize, drainRate);
+    return rc;
+}
+
+/**
+ * @brief get count of publishes in the offline queue
+ * @return offline count
+ */
+int tpSDKGetOfflineCount() {
+    return MQTTGetOfflineCountEx(MQTTDefaultClient());
+}
+
+/**
+ * @brief get count of publishes in the offline queue of the session
+ * @param[in] client session handle
+ * @return offline count
+ */
+int tpSDKGetOfflineCountEx(tpClient* client) {
+    return MQTTGetOfflineCountEx(client);
+}
+
+/**
+ * @brief publish with a completion callback
+ * @param[in] topic publish topic
+ * @param[in] payload payload. it may contain zero bytes.
+ * @param[in] len payload length
+ * @param[in] qos The quality of service of the message(0, 1 or 2).
+ * @param[in] pc completion callback with token, result and latency(usec). not called for publishes stored in the offline queue.
+ * @param[in] context completion callback context
+ * @return the return code of the publish result
+ */
+int tpMQTTPublish(char* topic, const void* payload, size_t len, int qos, tpMQTTPublishCallback* pc, void* context) {
+    int rc = MQTTAsyncPublishCallbackEx(MQTTDefaultClient(), topic, payload, len, qos, pc, context);
+    return rc;
+}
+
+/**
+ * @brief publish with a completion callback of the session
+ * @param[in] client session handle
+ * @param[in] topic publish topic
+ * @param[in] payload payload. it may contain zero bytes.
+ * @param[in] len payload length
+ * @param[in] qos The quality of service of the message(0, 1 or 2).
+ * @param[in] pc completion callback with token, result and latency(usec). not called for publishes stored in the offline queue.
+ * @param[in] context completion callback context
+ * @return the return code of the publish result
+ */
+int tpMQTTPublishEx(tpClient* client, char* topic, const void* payload, size_t len, int qos, tpMQTTPublishCallback* pc, void* context) {
+    int rc = MQTTAsyncPublishCallbackEx(client, topic, payload, len, qos, pc, context);
+    return rc;
+}
+
+/**
+ * @brief get send-to-completion latency of publishes of the topic class
+ * @param[in] topicClass topic class
+ * @param[out] stats latency statistics(usec)
+ * @return the return code of the get statistics result
+ */
+int tpSDKGetPublishStats(TOPIC_CLASS topicClass, tpPublishStats* stats) {
+    int rc = MQTTGetPublishStatsEx(MQTTDefaultClient(), topicClass, stats);
+    return rc;
+}
+
+/**
+ * @brief get send-to-completion latency of publishes of the topic class of the session
+ * @param[in] client session handle
+ * @param[in] topicClass topic class
+ * @param[out] stats latency statistics(usec)
+ * @return the return code of the get statistics result
+ */
+int tpSDKGetPublishStatsEx(tpClient* client, TOPIC_CLASS topicClass, tpPublishStats* stats) {
+    int rc = MQTTGetPublishStatsEx(client, topicClass, stats);
+    return rc;
+}
+
+/**
+ * @brief clear publish latency statistics
+ */
+void tpSDKResetPublishStats() {
+    MQTTResetPublishStatsEx(MQTTDefaultClient());
+}
+
+/**
+ * @brief clear publish latency statistics of the session
+ * @param[in] client session handle
+ */
+void tpSDKResetPublishStatsEx(tpClient* client) {
+    MQTTResetPublishStatsEx(client);
+}
+
+/**
+ * @brief set persistence of QoS 1/2 in-flight messages. call before tpSDKCreate.
+ * the state is kept in a preallocated memory-mapped log per client ID in the directory,
+ * so it survives a process restart when the session is not clean(cleanSession 0).
+ * @param[in] directory log directory(NULL : in-memory persistence)
+ * @param[in] size initial log size in bytes(0 : 64KB)
+ * @return the return code of the set persistence result
+ */
+int tpSDKSetPersistence(char* directory, size_t size) {
+    int rc = MQTTSetPersistenceEx(MQTTDefaultClient(), directory, size);
+    return rc;
+}
+
+/**
+ * @brief set persistence of QoS 1/2 in-flight messages of the session. call before tpSDKCreateEx.
+ * @param[in] client session handle
+ * @param[in] directory log directory(NULL : in-memory persistence)
+ * @param[in] size initial log size in bytes(0 : 64KB)
+ * @return the return code of the set persistence result
+ */
+int tpSDKSetPersistenceEx(tpClient* client, char* directory, size_t size) {
+    int rc = MQTTSetPersistenceEx(client, directory, size);
+    return rc;
+}
+
+/**
+ * @brief set SDK-managed reconnect.
+ * after a connection loss the SDK reconnects the same client with exponential backoff and random jitter,
+ * keeping subscriptions and queued messages. the connected callback is called again(result 0) on every
+ * successful reconnect, so it must be safe to repeat. the subscribed callback is called for the first connection only,
+ * a failed resubscribe is retried with the same backoff.
+ * @param[in] minInterval minimum reconnect interval in seconds(0 : no reconnect)
+ * @param[in] maxInterval maximum reconnect interval in seconds
+ * @return the return code of the set reconnect result
+ */
+int tpSDKSetReconnect(int minInterval, int maxInterval) {
+    int rc = MQTTSetReconnectEx(MQTTDefaultClient(), minInterval, maxInterval);
+    return rc;
+}
+
+/**
+ * @brief set SDK-managed reconnect of the session
+ * @param[in] client session handle
+ * @param[in] minInterval minimum reconnect interval in seconds(0 : no reconnect)
+ * @param[in] maxInterval maximum reconnect interval in seconds
+ * @return the return code of the set reconnect result
+ */
+int tpSDKSetReconnectEx(tpClient* client, int minInterval, int maxInterval) {
+    int rc = MQTTSetReconnectEx(client, minInterval, maxInterval);
+    return rc;
+}
+
+/**
+ * @brief set the MQTT protocol version used from the next tpSDKCreate.
+ * TP_MQTT_VERSION_3_1_1 skips the 3.1 fallback connect of TP_MQTT_VERSION_DEFAULT.
+ * TP_MQTT_VERSION_5(topic aliases) is not supported by the bundled paho 1.2.
+ * @param[in] version TP_MQTT_VERSION_DEFAULT, TP_MQTT_VERSION_3_1 or TP_MQTT_VERSION_3_1_1
+ * @return the return code of the set version result, TP_SDK_NOT_SUPPORTED for TP_MQTT_VERSION_5
+ */
+int tpSDKSetMQTTVersion(int version) {
+    int rc = MQTTSetVersionEx(MQTTDefaultClient(), version);
+    return rc;
+}
+
+/**
+ * @brief set the MQTT protocol version of the session used from the next tpSDKCreateEx
+ * @param[in] client session handle
+ * @param[in] version TP_MQTT_VERSION_DEFAULT, TP_MQTT_VERSION_3_1 or TP_MQTT_VERSION_3_1_1
+ * @return the return code of the set version result, TP_SDK_NOT_SUPPORTED for TP_MQTT_VERSION_5
+ */
+int tpSDKSetMQTTVersionEx(tpClient* client, int version) {
+    int rc = MQTTSetVersionEx(client, version);
+    return rc;
+}
+
+/**
+ * @brief get PUBLISH bytes on the wire of the topic class, with the topic share and the MQTT 5 topic alias estimate.
+ * reset with tpSDKResetPublishStats.
+ * @param[in] topicClass topic class
+ * @param[out] stats PUBLISH bytes
+ * @return the return code of the get statistics result
+ */
+int tpSDKGetWireStats(TOPIC_CLASS topicClass, tpWireStats* stats) {
+    int rc = MQTTGetWireStatsEx(MQTTDefaultClient(), topicClass, stats);
+    return rc;
+}
+
+/**
+ * @brief get PUBLISH bytes on the wire of the topic class of the session
+ * @param[in] client session handle
+ * @param[in] topicClass topic class
+ * @param[out] stats PUBLISH bytes
+ * @return the return code of the get statistics result
+ */
+int tpSDKGetWireStatsEx(tpClient* client, TOPIC_CLASS topicClass, tpWireStats* stats) {
+    int rc = MQTTGetWireStatsEx(client, topicClass, stats);
+    return rc;
+}
+
+/**
+ * @brief set callback workers. call before tpSDKCreate or after tpSDKDestroy.
+ * the message and session callbacks are handed from the paho threads to the workers
+ * so that a slow callback does not delay keepalives and other messages.
+ * messages of a topic are handled in arrival order by one worker, and session callbacks in order by one worker.
+ * @param[in] workers worker count(0 : callbacks in the paho threads)
+ * @param[in] queueSize events queued per worker(0 : 256)
+ * @return the return code of the set callback workers result
+ */
+int tpSDKSetCallbackWorkers(int workers, int queueSize) {
+    int rc = MQTTSetCallbackWorkersEx(MQTTDefaultClient(), workers, queueSize);
+    return rc;
+}
+
+/**
+ * @brief set callback workers of the session. call before tpSDKCreateEx or after tpSDKDestroyEx.
+ * @param[in] client session handle
+ * @param[in] workers worker count(0 : callbacks in the paho threads)
+ * @param[in] queueSize events queued per worker(0 : 256)
+ * @return the return code of the set callback workers result
+ */
+int tpSDKSetCallbackWorkersEx(tpClient* client, int workers, int queueSize) {
+    int rc = MQTTSetCallbackWorkersEx(client, workers, queueSize);
+    return rc;
+}
+
+/**
+ * @brief set the publish submission queue. call before tpSDKCreate or after tpSDKDestroy.
+ * publishes of any thread are copied into a lock-free queue and sent in order by one dispatcher thread,
+ * so sensor threads can publish concurrently. a publish returns TP_SDK_MQTT_MAX_MESSAGES_INFLIGHT when the queue is full.
+ * the completion callback also receives the failure or TP_SDK_OFFLINE_QUEUED of a queued publish.
+ * @param[in] queueSize queued publishes(0 : publish in the calling thread)
+ * @return the return code of the set submission queue result
+ */
+int tpSDKSetSubmitQueue(int queueSize) {
+    int rc = MQTTSetSubmitQueueEx(MQTTDefaultClient(), queueSize);
+    return rc;
+}
+
+/**
+ * @brief set the publish submission queue of the session. call before tpSDKCreateEx or after tpSDKDestroyEx.
+ * @param[in] client session handle
+ * @param[in] queueSize queued publishes(0 : publish in the calling thread)
+ * @return the return code of the set submission queue result
+ */
+int tpSDKSetSubmitQueueEx(tpClient* client, int queueSize) {
+    int rc = MQTTSetSubmitQueueEx(client, queueSize);
+    return rc;
+}
+
+/**
+ * @brief subscribe a topic filter with its own handler.
+ * messages matching the filter are routed to the handler instead of the message arrived callback.
+ * the subscription is kept across reconnects and tpSDKDestroy, and sent at the next connect when disconnected.
+ * @param[in] filter topic filter, which may include wildcards('+', '#').
+ * @param[in] qos The requested quality of service for the subscription.
+ * @param[in] handler topic handler(NULL : message arrived callback)
+ * @param[in] context handler context
+ * @return the return code of the subscribe result
+ */
+int tpMQTTSubscribe(char* filter, int qos, tpMQTTTopicHandler* handler, void* context) {
+    int rc = MQTTSubscribeHandlerEx(MQTTDefaultClient(), filter, qos, handler, NULL, context, NULL);
+    return rc;
+}
+
+/**
+ * @brief subscribe a topic filter with its own handler of the session
+ * @param[in] client session handle
+ * @param[in] filter topic filter, which may include wildcards('+', '#').
+ * @param[in] qos The requested quality of service for the subscription.
+ * @param[in] handler topic handler(NULL : message arrived callback)
+ * @param[in] context handler context
+ * @return the return code of the subscribe result
+ */
+int tpMQTTSubscribeEx(tpClient* client, char* filter, int qos, tpClientTopicHandler* handler, void* context) {
+    int rc = MQTTSubscribeHandlerEx(client, filter, qos, NULL, handler, context, NULL);
+    return rc;
+}
+
+/**
+ * @brief unsubscribe a topic filter
+ * @param[in] filter topic filter used to subscribe
+ * @return the return code of the unsubscribe result
+ */
+int tpMQTTUnsubscribe(char* filter) {
+    int rc = MQTTUnsubscribeEx(MQTTDefaultClient(), filter);
+    return rc;
+}
+
+/**
+ * @brief unsubscribe a topic filter of the session
+ * @param[in] client session handle
+ * @param[in] filter topic filter used to subscribe
+ * @return the return code of the unsubscribe result
+ */
+int tpMQTTUnsubscribeEx(tpClient* client, char* filter) {
+    int rc = MQTTUnsubscribeEx(client, filter);
+    return rc;
+}
+
+/**
+ * @brief set the TLS session cache of the process.
+ * sessions of each server are kept across tpSDKDestroy/tpSDKCreate and, with a directory,
+ * across restarts so that reconnects use abbreviated handshakes.
+ * the application must be linked with -Wl,--wrap=SSL_connect.
+ * @param[in] enable 1 : enable, 0 : disable
+ * @param[in] directory session directory(NULL : memory only)
+ * @return the return code of the set session cache result
+ */
+int tpSDKSetTLSSessionCache(int enable, char* directory) {
+    int rc = MQTTSessionSetCache(enable, directory);
+    return rc;
+}
+
+/**
+ * @brief get resumed and full TLS handshake counts of the process
+ * @param[out] stats handshake counts
+ * @return the return code of the get statistics result
+ */
+int tpSDKGetTLSSessionStats(tpTLSSessionStats* stats) {
+    int rc = MQTTSessionGetStats(stats);
+    return rc;
+}
+
+/**
+ * @brief get the connection phases(DNS, TCP, TLS, CONNACK, SUBACK) of the last connect or reconnect.
+ * the phases are logged at INFO when the connect ends.
+ * @param[out] timing connection phases(usec)
+ * @return the return code of the get timing result
+ */
+int tpSDKGetConnectTiming(tpConnectTiming* timing) {
+    int rc = MQTTGetConnectTimingEx(MQTTDefaultClient(), timing);
+    return rc;
+}
+
+/**
+ * @brief get the connection phases of the last connect or reconnect of the session
+ * @param[in] client session handle
+ * @param[out] timing connection phases(usec)
+ * @return the return code of the get timing result
+ */
+int tpSDKGetConnectTimingEx(tpClient* client, tpConnectTiming* timing) {
+    int rc = MQTTGetConnectTimingEx(client, timing);
+    return rc;
+}
+
+/**
+ * @brief publish binary message and get a future of its completion.
+ * the future is completed by PUBACK/PUBCOMP(QoS 1/2) or by the send(QoS 0), and at once
+ * with TP_SDK_OFFLINE_QUEUED when the message is stored in the offline queue.
+ * @param[in] topic publish topic
+ * @param[in] payload A pointer to the payload of the MQTT message. It may contain zero bytes.
+ * @param[in] len The length of the payload in bytes.
+ * @param[in] qos The quality of service of the message(0, 1 or 2).
+ * @return future released by tpFutureRelease, NULL if allocation failed
+ */
+tpFuture* tpMQTTPublishFuture(char* topic, const void* payload, size_t len, int qos) {
+    tpFuture* future = MQTTAsyncPublishFutureEx(MQTTDefaultClient(), topic, payload, len, qos);
+    return future;
+}
+
+/**
+ * @brief publish binary message and get a future of its completion of the session
+ * @param[in] client session handle
+ * @param[in] topic publish topic
+ * @param[in] payload A pointer to the payload of the MQTT message. It may contain zero bytes.
+ * @param[in] len The length of the payload in bytes.
+ * @param[in] qos The quality of service of the message(0, 1 or 2).
+ * @return future released by tpFutureRelease, NULL if allocation failed
+ */
+tpFuture* tpMQTTPublishFutureEx(tpClient* client, char* topic, const void* payload, size_t len, int qos) {
+    tpFuture* future = MQTTAsyncPublishFutureEx(client, topic, payload, len, qos);
+    return future;
+}
+
+/**
+ * @brief subscribe a topic filter with its own handler and get a future of the SUBACK.
+ * the future is completed at once with TP_SDK_OFFLINE_QUEUED when disconnected.
+ * @param[in] filter topic filter, which may include wildcards('+', '#').
+ * @param[in] qos The requested quality of service for the subscription.
+ * @param[in] handler topic handler(NULL : message arrived callback)
+ * @param[in] context handler context
+ * @return future released by tpFutureRelease, NULL if allocation failed
+ */
+tpFuture* tpMQTTSubscribeFuture(char* filter, int qos, tpMQTTTopicHandler* handler, void* context) {
+    tpFuture* future = MQTTSubscribeFutureEx(MQTTDefaultClient(), filter, qos, handler, NULL, context);
+    return future;
+}
+
+/**
+ * @brief subscribe a topic filter with its own handler and get a future of the SUBACK of the session
+ * @param[in] client session handle
+ * @param[in] filter topic filter, which may include wildcards('+', '#').
+ * @param[in] qos The requested quality of service for the subscription.
+ * @param[in] handler topic handler(NULL : message arrived callback)
+ * @param[in] context handler context
+ * @return future released by tpFutureRelease, NULL if allocation failed
+ */
+tpFuture* tpMQTTSubscribeFutureEx(tpClient* client, char* filter, int qos, tpClientTopicHandler* handler, void* context) {
+    tpFuture* future = MQTTSubscribeFutureEx(client, filter, qos, NULL, handler, context);
+    return future;
+}
+
+/**
+ * @brief wait for the completion of a future
+ * @param[in] future future
+ * @param[in] timeout timeout in msec(negative : no timeout, 0 : no wait)
+ * @return the result of the operation, TP_SDK_TIMEOUT if not completed in time
+ */
+int tpFutureWait(tpFuture* future, int timeout) {
+    int rc = MQTTFutureWait(future, timeout);
+    return rc;
+}
+
+/**
+ * @brief wait for the completion of every future within one timeout
+ * @param[in] futures futures(NULL entries are skipped)
+ * @param[in] count future count
+ * @param[in] timeout timeout in msec for all of them(negative : no timeout)
+ * @return TP_SDK_SUCCESS if all are completed, TP_SDK_TIMEOUT otherwise. results are read by tpFutureResult.
+ */
+int tpFutureWaitAll(tpFuture* futures[], int count, int timeout) {
+    int rc = MQTTFutureWaitAll(futures, count, timeout);
+    return rc;
+}
+
+/**
+ * @brief check the completion of a future without waiting
+ * @param[in] future future
+ * @return 1 if completed, 0 otherwise
+ */
+int tpFuturePoll(tpFuture* future) {
+    int rc = MQTTFuturePoll(future);
+    return rc;
+}
+
+/**
+ * @brief get the result of a future
+ * @param[in] future future
+ * @return the result of the operation, TP_SDK_TIMEOUT if not completed yet
+ */
+int tpFutureResult(tpFuture* future) {
+    int rc = MQTTFutureResult(future);
+    return rc;
+}
+
+/**
+ * @brief get the message token of a completed publish future
+ * @param[in] future future
+ * @return the message token, 0 if not completed or not sent
+ */
+int tpFutureToken(tpFuture* future) {
+    int rc = MQTTFutureToken(future);
+    return rc;
+}
+
+/**
+ * @brief set the completion callback of a future.
+ * it is called in the paho callback thread, or at once when the future is already completed.
+ * @param[in] future future
+ * @param[in] callback completion callback
+ * @param[in] context callback context
+ * @return the return code of the set callback result(one callback per future)
+ */
+int tpFutureThen(tpFuture* future, tpFutureCallback* callback, void* context) {
+    int rc = MQTTFutureThen(future, callback, context);
+    return rc;
+}
+
+/**
+ * @brief release a future. the completion is still processed when released before it.
+ * @param[in] future future
+ */
+void tpFutureRelease(tpFuture* future) {
+    MQTTFutureRelease(future);
+}
@@ -10,107 +10,943 @@
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
+#include "time.h"
+#include "errno.h"
+#include "unistd.h"
 #include "MQTTAsync.h"
 
 #include "MQTT.h"
+#include "MQTTTiming.h"
+#include "MQTTFuture.h"
+#include "Define.h"
 #ifdef SPT_DEBUG_ENABLE
 #include "SKTDebug.h"
 #else
 #include "SKTtpDebug.h"
 #endif
 
-static MQTTAsync mClient;
+/** QoS of the topic class when no policy is set **/
+#define MQTT_DEFAULT_QOS            2
 
-static char mUserName[32];
-static char mUserPass[90];
+/** maximum payload length of a PUBLISH(remaining length limit) **/
+#define MQTT_MAX_PAYLOAD_LENGTH     268435455
 
-static char mPublishTopic[128];
-static char mSubscribeTopic[5][128];
-static int mSubscribeTopicsize;
+/** session used by the API without handle **/
+static tpClient mDefaultClient = {
+    .qos = { MQTT_DEFAULT_QOS, MQTT_DEFAULT_QOS, MQTT_DEFAULT_QOS },
+    .pendingLock = PTHREAD_MUTEX_INITIALIZER,
+    .statsLock = PTHREAD_MUTEX_INITIALIZER,
+    .subscribeLock = PTHREAD_MUTEX_INITIALIZER,
+    .reconnectLock = PTHREAD_MUTEX_INITIALIZER,
+    .reconnectCond = PTHREAD_COND_INITIALIZER,
+    .coalesce = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER },
+    .deflate = { .lock = PTHREAD_MUTEX_INITIALIZER }
+};
 
-static tpMQTTConnectedCallback* mConnectedCallback;
-static tpMQTTSubscribedCallback* mSubscribedCallback;
-static tpMQTTDisconnectedCallback* mDisconnectedCallback;
-static tpMQTTConnectionLostCallback* mConnectionLostCallback;
-static tpMQTTMessageDeliveredCallback* mMessageDeliveredCallback;
-static tpMQTTMessageArrivedCallback* mMessageArrivedCallback;
+/** publish being completed by paho **/
+typedef struct
+{
+    /** session handle **/
+    tpClient* client;
+    /** topic class of the latency **/
+    TOPIC_CLASS topicClass;
+    /** send time(usec, monotonic) **/
+    unsigned long long start;
+    /** completion callback **/
+    tpMQTTPublishCallback* callback;
+    /** completion callback context **/
+    void* context;
+} MQTTPublishTracker;
 
-Content* gContent = NULL;
-static int mReconnected = 0;
+/** subscribe completed into a future **/
+typedef struct
+{
+    /** session handle **/
+    tpClient* client;
+    /** future completed by the SUBACK **/
+    tpFuture* future;
+} MQTTSubscribeRequest;
 
+/** unsubscribe waiting for the UNSUBACK **/
+typedef struct
+{
+    /** session handle **/
+    tpClient* client;
+    /** topic filter(follows in the same allocation) **/
+    char* filter;
+} MQTTUnsubscribeRequest;
+
+/** subscriptions collected for a SUBSCRIBE **/
+typedef struct
+{
+    /** topic filters(owned by the subscription table) **/
+    char** filters;
+    /** requested QoS **/
+    int* qos;
+    /** collected count **/
+    int count;
+    /** collect the subscriptions made by MQTTAsyncCreateEx only **/
+    int createdOnly;
+} MQTTSubscriptionList;
+
+/** handler of a matched subscription, called after the subscription lock is released **/
+typedef struct
+{
+    tpMQTTTopicHandler* handler;
+    tpClientTopicHandler* handlerEx;
+    void* context;
+} MQTTTopicDispatch;
+
+/** matched handlers of an arrived message **/
+typedef struct
+{
+    /** handlers(stack array, heap when more than MQTT_DISPATCH_STACK_SIZE) **/
+    MQTTTopicDispatch* items;
+    /** handler count **/
+    int count;
+    /** handler capacity **/
+    int capacity;
+    /** allocation failed **/
+    int failed;
+} MQTTDispatchList;
+
+/** matched handlers kept on the stack **/
+#define MQTT_DISPATCH_STACK_SIZE    8
 
 volatile MQTTAsync_token deliveredtoken;
 
-int MQTTAsyncSubscribeMany(int qos);
+int MQTTAsyncSubscribeMany(tpClient* client, int qos);
+static void MQTTPendingDrain(tpClient* client);
+static int MQTTAsyncSend(tpClient* client, char* topic, const void* payload, size_t len, int qos,
+        tpMQTTPublishCallback* pc, void* context);
+static void MQTTReconnectScheduleLocked(tpClient* client);
+static void MQTTNotify(tpClient* client, MQTT_DISPATCH_TYPE type, int result, char* cause);
+static int MQTTAsyncPublishQueued(tpClient* client, char* topic, const void* payload, size_t len, int qos,
+        tpMQTTPublishCallback* pc, void* context, int* queued);
+static int MQTTAsyncPublishNow(tpClient* client, char* topic, const void* payload, size_t len, int qos,
+        tpMQTTPublishCallback* pc, void* context, int* queued);
 
-void OnConnect(void* context, MQTTAsync_successData* response) {
-    if(mConnectedCallback) mConnectedCallback(MQTTASYNC_SUCCESS);
-    int i, rc;
-    rc = MQTTAsyncSubscribeMany(1);
-    for(i =0; i < mSubscribeTopicsize; i++) {
+/**
+ * @brief remember the server of the session for the connection timing
+ * @param[in] client session handle
+ * @param[in] host server host, may have a scheme("ssl://") and a port
+ * @param[in] port server port(0 : in the host)
+ */
+static void MQTTTimingServer(tpClient* client, const char* host, int port) {
+    const char* begin = strstr(host, "://");
+    const char* colon;
+    size_t len;
+
+    begin = begin ? begin + 3 : host;
+    len = strlen(begin);
+    colon = strchr(begin, ':');
+    if(port <= 0 && colon) {
+        len = colon - begin;
+        port = atoi(colon + 1);
+    }
+    if(len >= sizeof(client->timingHost)) len = sizeof(client->timingHost) - 1;
+    pthread_mutex_lock(&client->statsLock);
+    if(client->timingWatch) {
+        MQTTTimingWatch(client->timingHost, 0);
+        client->timingWatch = 0;
+    }
+    memcpy(client->timingHost, begin, len);
+    client->timingHost[len] = '\0';
+    client->timingPort = port > 0 ? port : 0;
+    pthread_mutex_unlock(&client->statsLock);
+}
+
+/**
+ * @brief start the connection timing of a connect request
+ * @param[in] client session handle
+ * @param[in] start MQTTAsyncCreateEx start time, 0 for a reconnect
+ */
+static void MQTTTimingStart(tpClient* client, unsigned long long start) {
+    pthread_mutex_lock(&client->statsLock);
+    memset(&client->timing, 0, sizeof(client->timing));
+    client->connectAt = MQTTTimingNow();
+    client->timingStart = start ? start : client->connectAt;
+    client->timing.create = (unsigned long)(client->connectAt - client->timingStart);
+    client->timingSuback = 0;
+    // the hooks record the connections to watched servers only
+    if(!client->timingWatch) {
+        MQTTTimingWatch(client->timingHost, 1);
+        client->timingWatch = 1;
+    }
+    pthread_mutex_unlock(&client->statsLock);
+}
+
+/**
+ * @brief stop watching the server after the CONNACK or a failed connect
+ * @param[in] client session handle
+ */
+static void MQTTTimingUnwatch(tpClient* client) {
+    pthread_mutex_lock(&client->statsLock);
+    if(client->timingWatch) {
+        MQTTTimingWatch(client->timingHost, 0);
+        client->timingWatch = 0;
+    }
+    pthread_mutex_unlock(&client->statsLock);
+}
+
+/**
+ * @brief log the connection phases
+ * @param[in] timing connection phases
+ */
+static void MQTTTimingLog(tpConnectTiming* timing) {
 #ifdef SPT_DEBUG_ENABLE
-	   	SKTtpDebugLog(LOG_LEVEL_INFO, "subscribed topic : %s", mSubscribeTopic[i]);
+    SKTtpDebugLog(LOG_LEVEL_INFO, "connect timing(usec) create : %lu, dns : %lu, tcp : %lu, tls : %lu%s, connack : %lu, suback : %lu, total : %lu",
+        timing->create, timing->dns, timing->tcp, timing->tls, timing->resumed ? "(resumed)" : "", timing->connack, timing->suback, timing->total);
 #else
-        SKTDebugPrint(LOG_LEVEL_INFO, "subscribed topic : %s", mSubscribeTopic[i]);
+    SKTDebugPrint(LOG_LEVEL_INFO, "connect timing(usec) create : %lu, dns : %lu, tcp : %lu, tls : %lu%s, connack : %lu, suback : %lu, total : %lu",
+        timing->create, timing->dns, timing->tcp, timing->tls, timing->resumed ? "(resumed)" : "", timing->connack, timing->suback, timing->total);
 #endif
+}
+
+/**
+ * @brief split the connect request to CONNACK time into the socket phases of paho
+ * @param[in] client session handle
+ * @param[in] subscribing subscriptions are sent, the timing ends at the SUBACK
+ */
+static void MQTTTimingConnected(tpClient* client, int subscribing) {
+    MQTTConnectRecord record;
+    tpConnectTiming timing;
+    unsigned long long now = MQTTTimingNow();
+    unsigned long long elapsed, phases;
+
+    pthread_mutex_lock(&client->statsLock);
+    client->connackAt = now;
+    elapsed = now - client->connectAt;
+    if(client->timingWatch) {
+        MQTTTimingWatch(client->timingHost, 0);
+        client->timingWatch = 0;
     }
+    if(MQTTTimingClaim(client->timingHost, client->timingPort, client->connectAt, &record)) {
+        client->timing.dns = record.dns;
+        if(record.tlsStart) {
+            client->timing.tcp = (unsigned long)(record.tlsStart - record.connectAt);
+            if(record.tlsEnd) client->timing.tls = (unsigned long)(record.tlsEnd - record.tlsStart);
+            client->timing.resumed = record.resumed;
+        }
+    }
+    phases = (unsigned long long)client->timing.dns + client->timing.tcp + client->timing.tls;
+    client->timing.connack = (unsigned long)(elapsed > phases ? elapsed - phases : 0);
+    client->timingSuback = subscribing;
+    if(!subscribing) {
+        client->timing.total = (unsigned long)(now - client->timingStart);
+        client->timing.complete = 1;
+    }
+    timing = client->timing;
+    pthread_mutex_unlock(&client->statsLock);
+    if(!subscribing) MQTTTimingLog(&timing);
+}
+
+/**
+ * @brief end the connection timing at the SUBACK of the connect
+ * @param[in] client session handle
+ */
+static void MQTTTimingSubscribed(tpClient* client) {
+    tpConnectTiming timing;
+    unsigned long long now = MQTTTimingNow();
+
+    pthread_mutex_lock(&client->statsLock);
+    if(!client->timingSuback) {
+        pthread_mutex_unlock(&client->statsLock);
+        return;
+    }
+    client->timingSuback = 0;
+    client->timing.suback = (unsigned long)(now - client->connackAt);
+    client->timing.total = (unsigned long)(now - client->timingStart);
+    client->timing.complete = 1;
+    timing = client->timing;
+    pthread_mutex_unlock(&client->statsLock);
+    MQTTTimingLog(&timing);
+}
+
+/**
+ * @brief reconnect thread. reconnects the paho handle at the scheduled time,
+ * keeping the subscriptions, the pending and offline queues and the TLS settings.
+ * @param[in] arg session handle
+ * @return NULL
+ */
+static void* MQTTReconnectRun(void* arg) {
+    tpClient* client = (tpClient *)arg;
+    struct timespec at;
+    int rc;
+
+    pthread_mutex_lock(&client->reconnectLock);
+    while(!client->reconnectStop) {
+        if(!client->reconnectDue) {
+            pthread_cond_wait(&client->reconnectCond, &client->reconnectLock);
+            continue;
+        }
+        at = client->reconnectAt;
+        // woken before the time : rescheduled, stopped or spurious
+        if(pthread_cond_timedwait(&client->reconnectCond, &client->reconnectLock, &at) != ETIMEDOUT) continue;
+        if(client->reconnectStop || !client->reconnectDue) continue;
+        client->reconnectDue = 0;
+        // the subscribed callback is called for the first connection only
+        client->reconnected = 1;
+        pthread_mutex_unlock(&client->reconnectLock);
+
+#ifdef SPT_DEBUG_ENABLE
+        SKTtpDebugLog(LOG_LEVEL_INFO, "reconnect attempt : %d", client->reconnectAttempt);
+#else
+        SKTDebugPrint(LOG_LEVEL_INFO, "reconnect attempt : %d", client->reconnectAttempt);
+#endif
+        if(MQTTAsync_isConnected(client->handle)) {
+            // connected but the resubscribe failed in OnConnect, its result comes to OnSubscribe(Failure)
+            rc = MQTTAsyncSubscribeMany(client, 1);
+        } else {
+            // paho queues the connect of the last MQTTAsync_connect, its result comes to OnConnect(Failure)
+            MQTTTimingStart(client, 0);
+            rc = MQTTAsync_reconnect(client->handle);
+        }
+
+        pthread_mutex_lock(&client->reconnectLock);
+        if(rc != MQTTASYNC_SUCCESS) MQTTReconnectScheduleLocked(client);
+    }
+    pthread_mutex_unlock(&client->reconnectLock);
+    return NULL;
+}
+
+/**
+ * @brief schedule the next reconnect with exponential backoff and jitter. call with the reconnect lock.
+ * the delay doubles from the minimum interval up to the maximum, and a random half of it is added
+ * so that devices dropped together by a broker restart do not reconnect in lockstep.
+ * @param[in] client session handle
+ */
+static void MQTTReconnectScheduleLocked(tpClient* client) {
+    unsigned long long base, delay;
+    unsigned long long maximum = (unsigned long long)client->reconnectMax * 1000;
+    int i;
+
+    if(client->reconnectMin <= 0 || client->reconnectStop || client->handle == NULL) return;
+    base = (unsigned long long)client->reconnectMin * 1000;
+    for(i = 0; i < client->reconnectAttempt && base < maximum; i++) {
+        base *= 2;
+    }
+    if(base > maximum) base = maximum;
+    if(client->reconnectSeed == 0) {
+        client->reconnectSeed = (unsigned int)time(NULL) ^ (unsigned int)getpid() ^ (unsigned int)(size_t)client;
+    }
+    // msec in [base / 2, base]
+    delay = base / 2 + (unsigned long long)rand_r(&client->reconnectSeed) % (base / 2 + 1);
+    client->reconnectAttempt++;
+
+    clock_gettime(CLOCK_REALTIME, &client->reconnectAt);
+    client->reconnectAt.tv_sec += delay / 1000;
+    client->reconnectAt.tv_nsec += (delay % 1000) * 1000000;
+    if(client->reconnectAt.tv_nsec >= 1000000000) {
+        client->reconnectAt.tv_sec++;
+        client->reconnectAt.tv_nsec -= 1000000000;
+    }
+    client->reconnectDue = 1;
+#ifdef SPT_DEBUG_ENABLE
+    SKTtpDebugLog(LOG_LEVEL_INFO, "reconnect in %llu msec", delay);
+#else
+    SKTDebugPrint(LOG_LEVEL_INFO, "reconnect in %llu msec", delay);
+#endif
+
+    if(client->reconnectRunning) {
+        pthread_cond_signal(&client->reconnectCond);
+    } else if(pthread_create(&client->reconnectThread, NULL, MQTTReconnectRun, client) == 0) {
+        client->reconnectRunning = 1;
+    } else {
+        client->reconnectDue = 0;
+    }
+}
+
+/**
+ * @brief schedule the next reconnect when reconnect is enabled
+ * @param[in] client session handle
+ */
+static void MQTTReconnectSchedule(tpClient* client) {
+    pthread_mutex_lock(&client->reconnectLock);
+    MQTTReconnectScheduleLocked(client);
+    pthread_mutex_unlock(&client->reconnectLock);
+}
+
+/**
+ * @brief stop the reconnect thread. reconnects are not scheduled until MQTTReconnectResume.
+ * @param[in] client session handle
+ */
+static void MQTTReconnectStop(tpClient* client) {
+    int running;
+    pthread_mutex_lock(&client->reconnectLock);
+    client->reconnectStop = 1;
+    client->reconnectDue = 0;
+    client->reconnectAttempt = 0;
+    running = client->reconnectRunning;
+    client->reconnectRunning = 0;
+    pthread_cond_broadcast(&client->reconnectCond);
+    pthread_mutex_unlock(&client->reconnectLock);
+    if(running) pthread_join(client->reconnectThread, NULL);
+}
+
+/**
+ * @brief allow reconnects again after MQTTReconnectStop
+ * @param[in] client session handle
+ */
+static void MQTTReconnectResume(tpClient* client) {
+    pthread_mutex_lock(&client->reconnectLock);
+    client->reconnectStop = 0;
+    pthread_mutex_unlock(&client->reconnectLock);
+}
+
+void OnConnect(void* context, MQTTAsync_successData* response) {
+    tpClient* client = (tpClient *)context;
+    int rc, subscribing, reconnecting = 0;
+    pthread_mutex_lock(&client->subscribeLock);
+    subscribing = client->subscriptions.count > 0;
+    pthread_mutex_unlock(&client->subscribeLock);
+    MQTTTimingConnected(client, subscribing);
+    MQTTNotify(client, MQTT_DISPATCH_CONNECTED, MQTTASYNC_SUCCESS, NULL);
+    rc = MQTTAsyncSubscribeMany(client, 1);
+    pthread_mutex_lock(&client->reconnectLock);
     if(rc != MQTTASYNC_SUCCESS) {
-        MQTTAsyncDestroy();
+        // the handle cannot be destroyed in a paho callback, the reconnect thread subscribes again
+        reconnecting = client->reconnectMin > 0;
+        MQTTReconnectScheduleLocked(client);
+    } else {
+        // no SUBACK clears the flag when there is nothing to subscribe
+        if(!subscribing) client->reconnected = 0;
+        client->reconnectAttempt = 0;
     }
+    pthread_mutex_unlock(&client->reconnectLock);
+    if(rc != MQTTASYNC_SUCCESS) {
+#ifdef SPT_DEBUG_ENABLE
+        SKTtpDebugLog(LOG_LEVEL_ERROR, "subscribe failed : %d", rc);
+#else
+        SKTDebugPrint(LOG_LEVEL_ERROR, "subscribe failed : %d", rc);
+#endif
+        if(!reconnecting) MQTTNotify(client, MQTT_DISPATCH_SUBSCRIBED, rc, NULL);
+    }
+    // publishes do not need the subscriptions
+    MQTTPendingDrain(client);
+    MQTTOfflineSetConnected(&client->offline, 1);
 }
 
 void OnConnected(void* context, char* cause) {
+    tpClient* client = (tpClient *)context;
 #ifdef SPT_DEBUG_ENABLE
     SKTtpDebugLog(LOG_LEVEL_INFO, "on connected : %s", cause);
 #else
     SKTDebugPrint(LOG_LEVEL_INFO, "on connected : %s", cause);
 #endif
-    if(strstr(cause, "reconnect")) {
-        mReconnected = 1;
-        MQTTAsyncSubscribeMany(1);
+    if(cause && strstr(cause, "reconnect")) {
+        pthread_mutex_lock(&client->reconnectLock);
+        client->reconnected = 1;
+        pthread_mutex_unlock(&client->reconnectLock);
+        MQTTAsyncSubscribeMany(client, 1);
     }
 }
 
 void OnConnectFailure(void* context, MQTTAsync_failureData* response){
-    if(mConnectedCallback) mConnectedCallback((response ? response->code : MQTTASYNC_FAILURE));
+    tpClient* client = (tpClient *)context;
+    int result = (response ? response->code : MQTTASYNC_FAILURE);
+    int retrying;
+    MQTTTimingUnwatch(client);
+    pthread_mutex_lock(&client->reconnectLock);
+    retrying = client->reconnectMin > 0 && client->reconnectAttempt > 0;
+    MQTTReconnectScheduleLocked(client);
+    pthread_mutex_unlock(&client->reconnectLock);
+    // failed reconnects are not reported, the connection lost callback was called already
+    if(retrying) return;
+    MQTTNotify(client, MQTT_DISPATCH_CONNECTED, result, NULL);
 }
 
 void OnSubscribe(void* context, MQTTAsync_successData* response) {
-    if(mReconnected) {
-        mReconnected = 0;
-    } else {
-        if(mSubscribedCallback) mSubscribedCallback(MQTTASYNC_SUCCESS);
-    }
+    tpClient* client = (tpClient *)context;
+    int reconnected;
+    MQTTTimingSubscribed(client);
+    pthread_mutex_lock(&client->reconnectLock);
+    reconnected = client->reconnected;
+    client->reconnected = 0;
+    if(reconnected) client->reconnectAttempt = 0;
+    pthread_mutex_unlock(&client->reconnectLock);
+    if(!reconnected) MQTTNotify(client, MQTT_DISPATCH_SUBSCRIBED, MQTTASYNC_SUCCESS, NULL);
 }
 
 void OnSubscribeFailure(void* context, MQTTAsync_failureData* response) {
-    if(mSubscribedCallback) mSubscribedCallback((response ? response->code : MQTTASYNC_FAILURE));
+    tpClient* client = (tpClient *)context;
+    MQTTTimingSubscribed(client);
+    int result = (response ? response->code : MQTTASYNC_FAILURE);
+    int retrying;
+    pthread_mutex_lock(&client->reconnectLock);
+    // a failed resubscribe after a reconnect is retried by the reconnect thread
+    retrying = client->reconnected && client->reconnectMin > 0;
+    if(retrying) MQTTReconnectScheduleLocked(client);
+    else client->reconnected = 0;
+    pthread_mutex_unlock(&client->reconnectLock);
+    if(!retrying) MQTTNotify(client, MQTT_DISPATCH_SUBSCRIBED, result, NULL);
+}
+
+void OnUnsubscribe(void* context, MQTTAsync_successData* response) {
+    MQTTUnsubscribeRequest* request = (MQTTUnsubscribeRequest *)context;
+    tpClient* client = request->client;
+    MQTTSubscription* subscription;
+
+    pthread_mutex_lock(&client->subscribeLock);
+    subscription = MQTTTopicGet(&client->subscriptions, request->filter);
+    // not removed when it was subscribed again after the request
+    if(subscription && subscription->unsubscribing) MQTTTopicRemove(&client->subscriptions, request->filter);
+    pthread_mutex_unlock(&client->subscribeLock);
+    free(request);
+}
+
+void OnUnsubscribeFailure(void* context, MQTTAsync_failureData* response) {
+    MQTTUnsubscribeRequest* request = (MQTTUnsubscribeRequest *)context;
+    tpClient* client = request->client;
+    MQTTSubscription* subscription;
+
+#ifdef SPT_DEBUG_ENABLE
+    SKTtpDebugLog(LOG_LEVEL_ERROR, "unsubscribe failed : %s, %d", request->filter, response ? response->code : MQTTASYNC_FAILURE);
+#else
+    SKTDebugPrint(LOG_LEVEL_ERROR, "unsubscribe failed : %s, %d", request->filter, response ? response->code : MQTTASYNC_FAILURE);
+#endif
+    // still subscribed at the broker, keep delivering
+    pthread_mutex_lock(&client->subscribeLock);
+    subscription = MQTTTopicGet(&client->subscriptions, request->filter);
+    if(subscription) subscription->unsubscribing = 0;
+    pthread_mutex_unlock(&client->subscribeLock);
+    free(request);
+}
+
+void OnSubscribeFuture(void* context, MQTTAsync_successData* response) {
+    MQTTSubscribeRequest* request = (MQTTSubscribeRequest *)context;
+    // paho reports a refused filter(granted QoS 0x80) as a success
+    int result = (response && response->alt.qos == 0x80) ? MQTTASYNC_FAILURE : MQTTASYNC_SUCCESS;
+    OnSubscribe(request->client, response);
+    MQTTFutureComplete(request->future, response ? response->token : 0, result, 0);
+    free(request);
+}
+
+void OnSubscribeFutureFailure(void* context, MQTTAsync_failureData* response) {
+    MQTTSubscribeRequest* request = (MQTTSubscribeRequest *)context;
+    int result = (response && response->code != MQTTASYNC_SUCCESS) ? response->code : MQTTASYNC_FAILURE;
+    OnSubscribeFailure(request->client, response);
+    MQTTFutureComplete(request->future, response ? response->token : 0, result, 0);
+    free(request);
 }
 
 void OnDisconnect(void* context, MQTTAsync_successData* response){
-    if(mDisconnectedCallback) mDisconnectedCallback(MQTTASYNC_SUCCESS);
+    tpClient* client = (tpClient *)context;
+    MQTTOfflineSetConnected(&client->offline, 0);
+    MQTTNotify(client, MQTT_DISPATCH_DISCONNECTED, MQTTASYNC_SUCCESS, NULL);
 }
 
 void ConnectionLostCallback(void *context, char *cause) {
-    if(mConnectionLostCallback) mConnectionLostCallback(cause);    
+    tpClient* client = (tpClient *)context;
+    MQTTOfflineSetConnected(&client->offline, 0);
+    MQTTNotify(client, MQTT_DISPATCH_CONNECTION_LOST, 0, cause);
+    MQTTReconnectSchedule(client);
 }
 
-int MessageArrivedCallback(void *context, char *topicName, int topicLen, MQTTAsync_message *message) {
-    if(mMessageArrivedCallback) {
-        mMessageArrivedCallback(topicName, message->payload, message->payloadlen);
+/**
+ * @brief monotonic time
+ * @return usec
+ */
+static unsigned long long MQTTNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+/**
+ * @brief record a completed publish and call its callback
+ * @param[in] tracker publish tracker, freed here
+ * @param[in] token message token
+ * @param[in] result MQTTASYNC_SUCCESS or error code
+ */
+static void MQTTPublishComplete(MQTTPublishTracker* tracker, int token, int result) {
+    tpClient* client = tracker->client;
+    unsigned long latency = (unsigned long)(MQTTNow() - tracker->start);
+
+    pthread_mutex_lock(&client->statsLock);
+    if(result == MQTTASYNC_SUCCESS) {
+        MQTTHistogramRecord(&client->latency[tracker->topicClass], latency);
+    } else {
+        client->publishFailed[tracker->topicClass]++;
+    }
+    pthread_mutex_unlock(&client->statsLock);
+
+    if(tracker->callback) tracker->callback(tracker->context, token, result, latency);
+    free(tracker);
+    // an in-flight slot is free
+    MQTTSubmitSlotFreed(&client->submit);
+    MQTTPendingDrain(client);
+}
+
+void OnPublish(void* context, MQTTAsync_successData* response) {
+    MQTTPublishComplete((MQTTPublishTracker *)context, response ? response->token : 0, MQTTASYNC_SUCCESS);
+}
+
+void OnPublishFailure(void* context, MQTTAsync_failureData* response) {
+    MQTTPublishComplete((MQTTPublishTracker *)context, response ? response->token : 0,
+        (response && response->code != MQTTASYNC_SUCCESS) ? response->code : MQTTASYNC_FAILURE);
+}
+
+/**
+ * @brief wrap an arrived paho message for the application
+ * @param[in] topicName topic from paho
+ * @param[in] topicLen topic length from paho(0 if NUL terminated)
+ * @param[in] message message from paho
+ * @return message owned by the application, NULL if allocation failed
+ */
+static tpMessage* MQTTMessageNew(char* topicName, int topicLen, MQTTAsync_message* message) {
+    // the payload is kept in the same allocation with its terminator.
+    // paho payloads come from its tracked heap and cannot be grown in place.
+    tpMessage* msg = (tpMessage *)malloc(sizeof(tpMessage) + message->payloadlen + 1);
+    if(msg == NULL) return NULL;
+    msg->topic = topicName;
+    msg->topicLen = topicLen > 0 ? topicLen : (int)strlen(topicName);
+    msg->payload = (char *)(msg + 1);
+    msg->payloadLen = message->payloadlen;
+    if(message->payloadlen > 0) {
+        memcpy(msg->payload, message->payload, message->payloadlen);
+    }
+    msg->payload[msg->payloadLen] = '\0';
+    MQTTAsync_free(message->payload);
+    message->payload = msg->payload;
+    msg->message = message;
+    return msg;
+}
+
+/**
+ * @brief collect the handler of a matched subscription(MQTTTopicVisitor)
+ * @param[in] subscription matched subscription
+ * @param[in] arg dispatch list
+ */
+static void MQTTDispatchCollect(MQTTSubscription* subscription, void* arg) {
+    MQTTDispatchList* list = (MQTTDispatchList *)arg;
+    MQTTTopicDispatch* items;
+    int capacity;
+    // subscriptions without handler go to the message arrived callback
+    if(subscription->handler == NULL && subscription->handlerEx == NULL) return;
+    if(list->count == list->capacity) {
+        capacity = list->capacity * 2;
+        if(list->capacity == MQTT_DISPATCH_STACK_SIZE) {
+            items = (MQTTTopicDispatch *)malloc(sizeof(MQTTTopicDispatch) * capacity);
+            if(items) memcpy(items, list->items, sizeof(MQTTTopicDispatch) * list->count);
+        } else {
+            items = (MQTTTopicDispatch *)realloc(list->items, sizeof(MQTTTopicDispatch) * capacity);
+        }
+        if(items == NULL) {
+            list->failed = 1;
+            return;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count].handler = subscription->handler;
+    list->items[list->count].handlerEx = subscription->handlerEx;
+    list->items[list->count].context = subscription->context;
+    list->count++;
+}
+
+/**
+ * @brief route an arrived message to the topic handlers or the message callbacks
+ * @param[in] client session handle
+ * @param[in] topicName topic from paho
+ * @param[in] topicLen topic length from paho(0 if NUL terminated)
+ * @param[in] message message from paho
+ * @return 1 if the message is handled and freed, 0 if it is left to the caller
+ */
+static int MQTTMessageDispatch(tpClient* client, char *topicName, int topicLen, MQTTAsync_message *message) {
+    MQTTTopicDispatch stackItems[MQTT_DISPATCH_STACK_SIZE];
+    MQTTDispatchList list = { stackItems, 0, MQTT_DISPATCH_STACK_SIZE, 0 };
+    int i;
+
+    // route to the handlers of the matching filters. the cost depends on the topic depth only.
+    pthread_mutex_lock(&client->subscribeLock);
+    MQTTTopicMatch(&client->subscriptions, topicName, MQTTDispatchCollect, &list);
+    pthread_mutex_unlock(&client->subscribeLock);
+    if(list.failed) {
+        if(list.items != stackItems) free(list.items);
+        // not handled, paho delivers the message again
+        return 0;
+    }
+    if(list.count > 0) {
+        for(i = 0; i < list.count; i++) {
+            if(list.items[i].handlerEx) {
+                list.items[i].handlerEx(client, topicName, message->payload, message->payloadlen, list.items[i].context);
+            } else {
+                list.items[i].handler(topicName, message->payload, message->payloadlen, list.items[i].context);
+            }
+        }
+        if(list.items != stackItems) free(list.items);
+        MQTTAsync_freeMessage(&message);
+        MQTTAsync_free(topicName);
+        return 1;
+    }
+
+    if(client->messageReceivedCallbackEx || client->messageReceivedCallback) {
+        tpMessage* msg = MQTTMessageNew(topicName, topicLen, message);
+        // not handled, paho delivers the message again
+        if(msg == NULL) return 0;
+        if(client->messageReceivedCallbackEx) client->messageReceivedCallbackEx(client, msg);
+        else client->messageReceivedCallback(msg);
+        return 1;
+    }
+
+    if(client->messageArrivedCallbackEx) {
+        client->messageArrivedCallbackEx(client, topicName, message->payload, message->payloadlen);
+    } else if(client->messageArrivedCallback) {
+        client->messageArrivedCallback(topicName, message->payload, message->payloadlen);
     }
 
     MQTTAsync_freeMessage(&message);
     MQTTAsync_free(topicName);
-    
+
     return 1;
 }
 
+/**
+ * @brief log a full callback queue. logged at every power of two to avoid flooding.
+ * @param[in] client session handle
+ */
+static void MQTTDispatchOverflow(tpClient* client) {
+    unsigned long overflow = __atomic_load_n(&client->dispatcher.overflow, __ATOMIC_RELAXED);
+    if(overflow & (overflow - 1)) return;
+#ifdef SPT_DEBUG_ENABLE
+    SKTtpDebugLog(LOG_LEVEL_WARN, "callback queue full, overflow : %lu", overflow);
+#else
+    SKTDebugPrint(LOG_LEVEL_WARN, "callback queue full, overflow : %lu", overflow);
+#endif
+}
+
+/**
+ * @brief call the application callback of an event
+ * @param[in] event callback event
+ */
+static void MQTTNotifyRun(MQTTDispatchEvent* event) {
+    tpClient* client = event->client;
+    switch(event->type) {
+        case MQTT_DISPATCH_ARRIVED:
+            if(!MQTTMessageDispatch(client, event->topic, event->topicLen, event->message)) {
+                // paho cannot deliver it again once handed to a worker
+#ifdef SPT_DEBUG_ENABLE
+                SKTtpDebugLog(LOG_LEVEL_ERROR, "message dropped : %s", event->topic);
+#else
+                SKTDebugPrint(LOG_LEVEL_ERROR, "message dropped : %s", event->topic);
+#endif
+                MQTTAsync_freeMessage(&event->message);
+                MQTTAsync_free(event->topic);
+            }
+            break;
+        case MQTT_DISPATCH_DELIVERED:
+            if(client->messageDeliveredCallbackEx) client->messageDeliveredCallbackEx(client, event->result);
+            else if(client->messageDeliveredCallback) client->messageDeliveredCallback(event->result);
+            break;
+        case MQTT_DISPATCH_CONNECTED:
+            if(client->connectedCallbackEx) client->connectedCallbackEx(client, event->result);
+            else if(client->connectedCallback) client->connectedCallback(event->result);
+            break;
+        case MQTT_DISPATCH_SUBSCRIBED:
+            if(client->subscribedCallbackEx) client->subscribedCallbackEx(client, event->result);
+            else if(client->subscribedCallback) client->subscribedCallback(event->result);
+            break;
+        case MQTT_DISPATCH_DISCONNECTED:
+            if(client->disconnectedCallbackEx) client->disconnectedCallbackEx(client, event->result);
+            else if(client->disconnectedCallback) client->disconnectedCallback(event->result);
+            break;
+        case MQTT_DISPATCH_CONNECTION_LOST:
+            if(client->connectionLostCallbackEx) client->connectionLostCallbackEx(client, event->cause);
+            else if(client->connectionLostCallback) client->connectionLostCallback(event->cause);
+            break;
+    }
+}
+
+/**
+ * @brief handle an event in a callback worker(MQTTDispatchHandler)
+ * @param[in] event callback event
+ */
+static void MQTTNotifyWorker(MQTTDispatchEvent* event) {
+    MQTTNotifyRun(event);
+    free(event->cause);
+}
+
+/**
+ * @brief call a session callback of the application, in a callback worker when they are started.
+ * session events share one worker so they keep their order, the paho thread waits while its ring is full.
+ * @param[in] client session handle
+ * @param[in] type event type
+ * @param[in] result result code or token
+ * @param[in] cause connection lost cause(may be NULL)
+ */
+static void MQTTNotify(tpClient* client, MQTT_DISPATCH_TYPE type, int result, char* cause) {
+    MQTTDispatchEvent event;
+    memset(&event, 0, sizeof(MQTTDispatchEvent));
+    event.type = type;
+    event.client = client;
+    event.result = result;
+    event.cause = cause;
+    if(client->dispatcher.count > 0) {
+        event.cause = cause ? strdup(cause) : NULL;
+        // session events cannot be delivered again, wait for the worker to keep their order
+        if(MQTTDispatchPushWait(&client->dispatcher, MQTTDispatchKey(NULL, 0), &event) == 0) return;
+        // raised by a callback of the session worker itself
+        MQTTDispatchOverflow(client);
+        free(event.cause);
+        event.cause = cause;
+    }
+    MQTTNotifyRun(&event);
+}
+
+int MessageArrivedCallback(void *context, char *topicName, int topicLen, MQTTAsync_message *message) {
+    tpClient* client = (tpClient *)context;
+    MQTTDispatchEvent event;
+
+    if(client->dispatcher.count > 0) {
+        memset(&event, 0, sizeof(MQTTDispatchEvent));
+        event.type = MQTT_DISPATCH_ARRIVED;
+        event.client = client;
+        event.topic = topicName;
+        event.topicLen = topicLen;
+        event.message = message;
+        // messages of a topic go to one worker and keep their order
+        if(MQTTDispatchPush(&client->dispatcher, MQTTDispatchKey(topicName, topicLen), &event) == 0) return 1;
+        MQTTDispatchOverflow(client);
+        // not handled, paho delivers the message again
+        return 0;
+    }
+    return MQTTMessageDispatch(client, topicName, topicLen, message);
+}
+
 void MessageDeliveredCallback(void *context, MQTTAsync_token dt) {
-    if(mMessageDeliveredCallback) mMessageDeliveredCallback((int)dt);
+    tpClient* client = (tpClient *)context;
+    MQTTNotify(client, MQTT_DISPATCH_DELIVERED, (int)dt, NULL);
+    client->deliveredToken = dt;
     deliveredtoken = dt;
 }
 
+/**
+ * @brief collect a subscription for a SUBSCRIBE(MQTTTopicVisitor)
+ * @param[in] subscription subscription
+ * @param[in] arg subscription list
+ */
+static void MQTTSubscriptionsAppend(MQTTSubscription* subscription, void* arg) {
+    MQTTSubscriptionList* list = (MQTTSubscriptionList *)arg;
+    if(list->createdOnly && !subscription->created) return;
+    list->filters[list->count] = subscription->filter;
+    list->qos[list->count] = subscription->created ? -1 : subscription->qos;
+    list->count++;
+}
+
+/**
+ * @brief collect the subscriptions of the session. call with the subscription lock.
+ * @param[in] client session handle
+ * @param[in] createdOnly collect the subscriptions made by MQTTAsyncCreateEx only
+ * @param[out] list filters and QoS(-1 : create topic). free the arrays after use.
+ * @return MQTTASYNC_SUCCESS, MQTTASYNC_FAILURE if allocation failed
+ */
+static int MQTTSubscriptionsCollect(tpClient* client, int createdOnly, MQTTSubscriptionList* list) {
+    int size = client->subscriptions.count > 0 ? client->subscriptions.count : 1;
+    list->count = 0;
+    list->createdOnly = createdOnly;
+    list->filters = (char **)malloc(sizeof(char *) * size);
+    list->qos = (int *)malloc(sizeof(int) * size);
+    if(list->filters == NULL || list->qos == NULL) {
+        free(list->filters);
+        free(list->qos);
+        return MQTTASYNC_FAILURE;
+    }
+    MQTTTopicForEach(&client->subscriptions, MQTTSubscriptionsAppend, list);
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief replace the subscriptions of the previous create with the create topics
+ * @param[in] client session handle
+ * @param[in] subscribeTopic create topics
+ * @param[in] subscribeTopicSize create topic count
+ * @return MQTTASYNC_SUCCESS, MQTTASYNC_FAILURE if allocation failed
+ */
+static int MQTTSubscriptionsCreate(tpClient* client, char* subscribeTopic[], int subscribeTopicSize) {
+    MQTTSubscriptionList list;
+    MQTTSubscription* subscription;
+    int i;
+
+    pthread_mutex_lock(&client->subscribeLock);
+    if(MQTTSubscriptionsCollect(client, 1, &list) != MQTTASYNC_SUCCESS) {
+        pthread_mutex_unlock(&client->subscribeLock);
+        return MQTTASYNC_FAILURE;
+    }
+    // the filter is owned by the subscription, MQTTTopicRemove does not read it after freeing
+    for(i = list.count - 1; i >= 0; i--) {
+        MQTTTopicRemove(&client->subscriptions, list.filters[i]);
+    }
+    free(list.filters);
+    free(list.qos);
+    for(i = 0; i < subscribeTopicSize; i++) {
+        subscription = MQTTTopicAdd(&client->subscriptions, subscribeTopic[i]);
+        if(subscription == NULL) {
+            pthread_mutex_unlock(&client->subscribeLock);
+            return MQTTASYNC_FAILURE;
+        }
+        // a tpMQTTSubscribe filter keeps its handler
+        if(subscription->handler == NULL && subscription->handlerEx == NULL) subscription->created = 1;
+    }
+    pthread_mutex_unlock(&client->subscribeLock);
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief allocate a new session
+ * @return session handle, NULL if allocation failed
+ */
+tpClient* MQTTClientNew() {
+    tpClient* client = (tpClient *)calloc(1, sizeof(tpClient));
+    int i;
+    if(client) {
+        for(i = 0; i < TOPIC_CLASS_MAX; i++) {
+            client->qos[i] = MQTT_DEFAULT_QOS;
+        }
+        pthread_mutex_init(&client->pendingLock, NULL);
+        pthread_mutex_init(&client->statsLock, NULL);
+        pthread_mutex_init(&client->subscribeLock, NULL);
+        pthread_mutex_init(&client->reconnectLock, NULL);
+        pthread_cond_init(&client->reconnectCond, NULL);
+        pthread_mutex_init(&client->coalesce.lock, NULL);
+        pthread_cond_init(&client->coalesce.cond, NULL);
+        pthread_mutex_init(&client->deflate.lock, NULL);
+    }
+    return client;
+}
+
+/**
+ * @brief free a session allocated with MQTTClientNew
+ * @param[in] client session handle
+ */
+void MQTTClientFree(tpClient* client) {
+    if(!client || client == &mDefaultClient) return;
+    MQTTCoalesceStop(client);
+    MQTTDeflateStop(client);
+    MQTTAsyncDestroyEx(client);
+    MQTTSubmitStop(&client->submit);
+    MQTTDispatchStop(&client->dispatcher);
+    MQTTOfflineClose(&client->offline);
+    pthread_mutex_destroy(&client->pendingLock);
+    pthread_mutex_destroy(&client->statsLock);
+    MQTTTopicClear(&client->subscriptions);
+    pthread_mutex_destroy(&client->subscribeLock);
+    pthread_mutex_destroy(&client->reconnectLock);
+    pthread_cond_destroy(&client->reconnectCond);
+    pthread_mutex_destroy(&client->coalesce.lock);
+    pthread_cond_destroy(&client->coalesce.cond);
+    pthread_mutex_destroy(&client->deflate.lock);
+    free(client);
+}
+
+/**
+ * @brief get the session used by the API without handle
+ * @return default session handle
+ */
+tpClient* MQTTDefaultClient() {
+    return &mDefaultClient;
+}
+
 /**
  * @brief set callback function
  * @param[in] cc connect callback
@@ -118,31 +954,352 @@ void MessageDeliveredCallback(void *context, MQTTAsync_token dt) {
  * @param[in] dc disconnect callback
  * @param[in] clc connection lost callback
  * @param[in] mdc message delivered callback
- * @param[in] mac message arrived callback
+ * @param[in] mac message arrived callback, may be NULL when a message received callback is set
  * @return the return code of the set callbacks result
  */
 int MQTTSetCallbacks(tpMQTTConnectedCallback* cc, tpMQTTSubscribedCallback* sc, tpMQTTDisconnectedCallback* dc,
         tpMQTTConnectionLostCallback* clc, tpMQTTMessageDeliveredCallback* mdc, tpMQTTMessageArrivedCallback* mac) {
 
-    if(mac == NULL) {
+    if(mac == NULL && mDefaultClient.messageReceivedCallback == NULL) {
         return -1;
     }
-    
-    mConnectedCallback = cc;
-    mSubscribedCallback = sc;
-    mDisconnectedCallback = dc;
-    mConnectionLostCallback = clc;
-    mMessageDeliveredCallback = mdc;
-    mMessageArrivedCallback = mac;
+
+    mDefaultClient.connectedCallback = cc;
+    mDefaultClient.subscribedCallback = sc;
+    mDefaultClient.disconnectedCallback = dc;
+    mDefaultClient.connectionLostCallback = clc;
+    mDefaultClient.messageDeliveredCallback = mdc;
+    mDefaultClient.messageArrivedCallback = mac;
 
     return 0;
 }
 
+/**
+ * @brief set callback function of the session
+ * @param[in] client session handle
+ * @param[in] cc connect callback
+ * @param[in] sc subscribe callback
+ * @param[in] dc disconnect callback
+ * @param[in] clc connection lost callback
+ * @param[in] mdc message delivered callback
+ * @param[in] mac message arrived callback, may be NULL when a message received callback is set
+ * @return the return code of the set callbacks result
+ */
+int MQTTSetCallbacksEx(tpClient* client, tpClientConnectedCallback* cc, tpClientSubscribedCallback* sc, tpClientDisconnectedCallback* dc,
+        tpClientConnectionLostCallback* clc, tpClientMessageDeliveredCallback* mdc, tpClientMessageArrivedCallback* mac) {
+
+    if(client == NULL || (mac == NULL && client->messageReceivedCallbackEx == NULL)) {
+        return -1;
+    }
+
+    client->connectedCallbackEx = cc;
+    client->subscribedCallbackEx = sc;
+    client->disconnectedCallbackEx = dc;
+    client->connectionLostCallbackEx = clc;
+    client->messageDeliveredCallbackEx = mdc;
+    client->messageArrivedCallbackEx = mac;
+
+    return 0;
+}
+
+/**
+ * @brief set ownership transfer arrival callback. it takes precedence over the message arrived callback.
+ * @param[in] client session handle
+ * @param[in] mrc message received callback without handle
+ * @param[in] mrcEx message received callback with handle
+ * @return the return code of the set callback result
+ */
+int MQTTSetMessageReceivedCallbackEx(tpClient* client, tpMQTTMessageReceivedCallback* mrc, tpClientMessageReceivedCallback* mrcEx) {
+    if(client == NULL) {
+        return -1;
+    }
+    client->messageReceivedCallback = mrc;
+    client->messageReceivedCallbackEx = mrcEx;
+    return 0;
+}
+
+/**
+ * @brief release a message passed to the message received callback
+ * @param[in] message received message
+ */
+void MQTTMessageRelease(tpMessage* message) {
+    if(message == NULL) return;
+    if(message->message) {
+        // payload belongs to this allocation
+        message->message->payload = NULL;
+        MQTTAsync_freeMessage(&message->message);
+    }
+    if(message->topic) {
+        MQTTAsync_free(message->topic);
+    }
+    free(message);
+}
+
+/**
+ * @brief set in-flight window and pending queue. call before MQTTAsyncCreateEx.
+ * a queued publish which fails to send or is still queued at destroy is reported to its completion callback.
+ * @param[in] client session handle
+ * @param[in] maxInflight maximum in-flight messages(0 : paho default)
+ * @param[in] maxPending maximum publishes queued while the window is full(0 : no queue)
+ * @param[in] highWatermark pending count which pauses producers(0 : maxPending)
+ * @param[in] lowWatermark pending count which resumes producers(0 : half of highWatermark)
+ * @param[in] fcc flow control callback without handle
+ * @param[in] fccEx flow control callback with handle
+ * @return the return code of the set flow control result
+ */
+int MQTTSetFlowControlEx(tpClient* client, int maxInflight, int maxPending, int highWatermark, int lowWatermark,
+        tpMQTTFlowControlCallback* fcc, tpClientFlowControlCallback* fccEx) {
+    if(client == NULL || maxInflight < 0 || maxPending < 0 || highWatermark < 0 || lowWatermark < 0) {
+        return -1;
+    }
+    if(highWatermark == 0 || highWatermark > maxPending) {
+        highWatermark = maxPending;
+    }
+    if(lowWatermark == 0 || lowWatermark >= highWatermark) {
+        lowWatermark = highWatermark / 2;
+    }
+    pthread_mutex_lock(&client->pendingLock);
+    client->maxInflight = maxInflight;
+    client->maxPending = maxPending;
+    client->highWatermark = highWatermark;
+    client->lowWatermark = lowWatermark;
+    client->flowControlCallback = fcc;
+    client->flowControlCallbackEx = fccEx;
+    pthread_mutex_unlock(&client->pendingLock);
+    return 0;
+}
+
+/**
+ * @brief get count of publishes waiting for an in-flight slot
+ * @param[in] client session handle
+ * @return pending count
+ */
+int MQTTGetPendingCountEx(tpClient* client) {
+    int count;
+    if(client == NULL) return 0;
+    pthread_mutex_lock(&client->pendingLock);
+    count = client->pending.count;
+    pthread_mutex_unlock(&client->pendingLock);
+    return count;
+}
+
+/**
+ * @brief send a message drained from the offline queue
+ * @param[in] context session handle
+ * @param[in] message drained message
+ * @return MQTTASYNC_SUCCESS if the message is accepted for publication.
+ */
+static int MQTTOfflineSendMessage(void* context, MQTTQueueMessage* message) {
+    tpClient* client = (tpClient *)context;
+    if(client->handle == NULL) {
+        return MQTTASYNC_DISCONNECTED;
+    }
+    return MQTTAsyncSend(client, message->topic, message->payload, message->len, message->qos, NULL, NULL);
+}
+
+/**
+ * @brief set offline queue. it is kept across MQTTAsyncDestroyEx and closed by MQTTClientFree.
+ * @param[in] client session handle
+ * @param[in] memorySize memory ring size in bytes(0 : disk only)
+ * @param[in] directory segment directory(NULL : memory only)
+ * @param[in] segmentSize maximum bytes of a segment file(0 : 1MB)
+ * @param[in] maxDiskSize maximum bytes of all segment files(0 : no limit)
+ * @param[in] drainRate sent messages per second after connected(0 : unlimited)
+ * @return the return code of the set offline queue result
+ */
+int MQTTSetOfflineQueueEx(tpClient* client, size_t memorySize, char* directory, size_t segmentSize, size_t maxDiskSize, int drainRate) {
+    if(client == NULL || drainRate < 0) {
+        return -1;
+    }
+    // records still in memory are written to the old directory
+    MQTTOfflineClose(&client->offline);
+    if(memorySize == 0 && (directory == NULL || directory[0] == '\0')) {
+        return 0;
+    }
+    if(MQTTOfflineOpen(&client->offline, memorySize, directory, segmentSize, maxDiskSize, drainRate,
+            MQTTOfflineSendMessage, client) != MQTTASYNC_SUCCESS) {
+        return -1;
+    }
+    if(client->handle && MQTTAsync_isConnected(client->handle)) {
+        MQTTOfflineSetConnected(&client->offline, 1);
+    }
+    return 0;
+}
+
+/**
+ * @brief get count of publishes in the offline queue
+ * @param[in] client session handle
+ * @return offline count
+ */
+int MQTTGetOfflineCountEx(tpClient* client) {
+    if(client == NULL) return 0;
+    return MQTTOfflineCount(&client->offline);
+}
+
+/**
+ * @brief set SDK-managed reconnect of the session.
+ * after a connection loss or a failed connect the same handle is reconnected after a random delay
+ * between the half and the whole of the backoff interval, which doubles from minInterval up to maxInterval.
+ * subscriptions, pending and offline messages are kept across reconnects.
+ * CONNECTED is notified again on every reconnect, SUBSCRIBED for the first connection only.
+ * @param[in] client session handle
+ * @param[in] minInterval minimum interval in seconds(0 : no reconnect)
+ * @param[in] maxInterval maximum interval in seconds(>= minInterval)
+ * @return the return code of the set reconnect result
+ */
+int MQTTSetReconnectEx(tpClient* client, int minInterval, int maxInterval) {
+    if(client == NULL || minInterval < 0 || (minInterval > 0 && maxInterval < minInterval)) {
+        return MQTTASYNC_FAILURE;
+    }
+    pthread_mutex_lock(&client->reconnectLock);
+    client->reconnectMin = minInterval;
+    client->reconnectMax = maxInterval;
+    if(minInterval == 0) client->reconnectDue = 0;
+    pthread_mutex_unlock(&client->reconnectLock);
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief set the MQTT protocol version of the session. used from the next MQTTAsyncCreateEx.
+ * MQTT 5(topic aliases) needs the paho 1.3 API, which the bundled paho 1.2 does not have.
+ * @param[in] client session handle
+ * @param[in] version TP_MQTT_VERSION_DEFAULT, TP_MQTT_VERSION_3_1 or TP_MQTT_VERSION_3_1_1
+ * @return MQTTASYNC_SUCCESS, TP_SDK_NOT_SUPPORTED for TP_MQTT_VERSION_5, MQTTASYNC_FAILURE for others
+ */
+int MQTTSetVersionEx(tpClient* client, int version) {
+    if(client == NULL) {
+        return MQTTASYNC_FAILURE;
+    }
+    if(version == TP_MQTT_VERSION_5) {
+        return TP_SDK_NOT_SUPPORTED;
+    }
+    if(version != TP_MQTT_VERSION_DEFAULT && version != TP_MQTT_VERSION_3_1 && version != TP_MQTT_VERSION_3_1_1) {
+        return MQTTASYNC_FAILURE;
+    }
+    client->mqttVersion = version;
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief set the callback workers of the session. call before MQTTAsyncCreateEx or after MQTTAsyncDestroyEx.
+ * @param[in] client session handle
+ * @param[in] workers worker count(0 : callbacks in the paho threads)
+ * @param[in] queueSize events queued per worker(0 : MQTT_DISPATCH_QUEUE_SIZE)
+ * @return MQTTASYNC_SUCCESS, MQTTASYNC_FAILURE if connected, called in a callback worker or the workers cannot start
+ */
+int MQTTSetCallbackWorkersEx(tpClient* client, int workers, int queueSize) {
+    if(client == NULL || workers < 0 || queueSize < 0 || client->handle != NULL) {
+        return MQTTASYNC_FAILURE;
+    }
+    // the queued events are handled before the workers stop
+    if(MQTTDispatchStop(&client->dispatcher) != 0) {
+        return MQTTASYNC_FAILURE;
+    }
+    if(workers == 0) {
+        return MQTTASYNC_SUCCESS;
+    }
+    if(MQTTDispatchStart(&client->dispatcher, workers, queueSize, MQTTNotifyWorker) != 0) {
+        return MQTTASYNC_FAILURE;
+    }
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief publish a submission in the dispatcher(MQTTSubmitHandler).
+ * waits for an in-flight slot when there is no pending queue, so the submission order is kept.
+ * @param[in] submission queued publish
+ */
+static void MQTTSubmitWorker(MQTTSubmission* submission) {
+    tpClient* client = submission->client;
+    unsigned long slots;
+    int queued, rc;
+
+    for(;;) {
+        // a slot freed between the refusal and the wait is not missed
+        slots = MQTTSubmitSlots(&client->submit);
+        rc = MQTTAsyncPublishNow(client, submission->topic, submission->payload, submission->len, submission->qos,
+            submission->callback, submission->context, &queued);
+        if(rc != MQTTASYNC_MAX_MESSAGES_INFLIGHT || MQTTSubmitStopping(&client->submit)) break;
+        MQTTSubmitSlotWait(&client->submit, slots);
+    }
+    // the producer has returned already, the result goes to the completion callback
+    if(submission->callback && (rc != MQTTASYNC_SUCCESS || queued)) {
+        submission->callback(submission->context, 0, queued ? TP_SDK_OFFLINE_QUEUED : rc, 0);
+    }
+    if(rc != MQTTASYNC_SUCCESS) {
+#ifdef SPT_DEBUG_ENABLE
+        SKTtpDebugLog(LOG_LEVEL_ERROR, "submitted publish failed : %s, rc : %d", submission->topic, rc);
+#else
+        SKTDebugPrint(LOG_LEVEL_ERROR, "submitted publish failed : %s, rc : %d", submission->topic, rc);
+#endif
+    }
+    free(submission->topic);
+}
+
+/**
+ * @brief set the publish submission queue of the session.
+ * publishes are copied into a lock-free queue and sent by one dispatcher thread.
+ * @param[in] client session handle
+ * @param[in] queueSize queued publishes(0 : stop the queue, publish in the calling thread)
+ * @return MQTTASYNC_SUCCESS, MQTTASYNC_FAILURE if the session is created or the dispatcher cannot start
+ */
+int MQTTSetSubmitQueueEx(tpClient* client, int queueSize) {
+    if(client == NULL || queueSize < 0 || client->handle != NULL) {
+        return MQTTASYNC_FAILURE;
+    }
+    // the queued publishes are handled before the dispatcher stops
+    if(MQTTSubmitStop(&client->submit) != 0) {
+        return MQTTASYNC_FAILURE;
+    }
+    if(queueSize == 0) {
+        return MQTTASYNC_SUCCESS;
+    }
+    if(MQTTSubmitStart(&client->submit, queueSize, MQTTSubmitWorker) != 0) {
+        return MQTTASYNC_FAILURE;
+    }
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief get the connection phases of the last connect of the session
+ * @param[in] client session handle
+ * @param[out] timing connection phases(usec)
+ * @return MQTTASYNC_SUCCESS, MQTTASYNC_FAILURE if the parameter is NULL
+ */
+int MQTTGetConnectTimingEx(tpClient* client, tpConnectTiming* timing) {
+    if(client == NULL || timing == NULL) {
+        return MQTTASYNC_FAILURE;
+    }
+    pthread_mutex_lock(&client->statsLock);
+    *timing = client->timing;
+    pthread_mutex_unlock(&client->statsLock);
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief set persistence of in-flight messages. call before MQTTAsyncCreateEx.
+ * @param[in] client session handle
+ * @param[in] directory log directory(NULL : in-memory persistence)
+ * @param[in] size initial log size in bytes(0 : default)
+ * @return the return code of the set persistence result
+ */
+int MQTTSetPersistenceEx(tpClient* client, char* directory, size_t size) {
+    if(client == NULL || (directory && strlen(directory) >= sizeof(client->persistenceConfig.directory))) {
+        return -1;
+    }
+    memset(client->persistenceConfig.directory, 0, sizeof(client->persistenceConfig.directory));
+    if(directory) {
+        strcpy(client->persistenceConfig.directory, directory);
+    }
+    client->persistenceConfig.size = size;
+    return 0;
+}
+
 /**
  * @brief create mqtt
  * @param[in] host the hostname or ip address of the broker to connect to.
  * @param[in] port the network port to connect to.  Usually 1883.
- * @param[in] keepalive the number of seconds after which the broker should send a PING message to the client if no other messages have been exchanged in that time. 
+ * @param[in] keepalive the number of seconds after which the broker should send a PING message to the client if no other messages have been exchanged in that time.
  * @param[in] userName authentication user name
  * @param[in] password authentication password
  * @param[in] enableServerCertAuth True/False option to enable verification of the server certificate
@@ -154,24 +1311,56 @@ int MQTTSetCallbacks(tpMQTTConnectedCallback* cc, tpMQTTSubscribedCallback* sc,
  * @param[in] clientID The client identifier(no longer 23 characters).
  * @return the return code of the connection response
  */
-int MQTTAsyncCreate(char* host, int port, int keepalive, char* userName, char* password, int enableServerCertAuth, 
+int MQTTAsyncCreate(char* host, int port, int keepalive, char* userName, char* password, int enableServerCertAuth,
+         char* subscribeTopic[], int subscribeTopicSize, char* publishTopic, char* enabledCipherSuites, int cleanSession, char* clientID) {
+    return MQTTAsyncCreateEx(&mDefaultClient, host, port, keepalive, userName, password, enableServerCertAuth,
+        subscribeTopic, subscribeTopicSize, publishTopic, enabledCipherSuites, cleanSession, clientID);
+}
+
+/**
+ * @brief create mqtt of the session
+ * @param[in] client session handle
+ * @param[in] host the hostname or ip address of the broker to connect to.
+ * @param[in] port the network port to connect to.  Usually 1883.
+ * @param[in] keepalive the number of seconds after which the broker should send a PING message to the client if no other messages have been exchanged in that time.
+ * @param[in] userName authentication user name
+ * @param[in] password authentication password
+ * @param[in] enableServerCertAuth True/False option to enable verification of the server certificate
+ * @param[in] subscribeTopic mqtt topic
+ * @param[in] subscribeTopicSize mqtt topic size
+ * @param[in] publishTopic publish topic
+ * @param[in] enabledCipherSuites cipher format. If this setting is ommitted, its default value will be "ALL".
+ * @param[in] cleanSession if cleanSession=true, then the previous session information is cleared.
+ * @param[in] clientID The client identifier(no longer 23 characters).
+ * @return the return code of the connection response
+ */
+int MQTTAsyncCreateEx(tpClient* client, char* host, int port, int keepalive, char* userName, char* password, int enableServerCertAuth,
          char* subscribeTopic[], int subscribeTopicSize, char* publishTopic, char* enabledCipherSuites, int cleanSession, char* clientID) {
 #ifdef SPT_DEBUG_ENABLE
 	SKTtpDebugLog(LOG_LEVEL_INFO, "MQTTAsyncCreate()");
 #else
 	SKTDebugPrint(LOG_LEVEL_INFO, "MQTTAsyncCreate()");
 #endif
+    int i;
+    if(client == NULL || host == NULL || subscribeTopicSize < 0 || (subscribeTopicSize > 0 && subscribeTopic == NULL)) {
+        return MQTTASYNC_FAILURE;
+    }
+    for(i = 0; i < subscribeTopicSize; i++) {
+        if(!MQTTTopicValidFilter(subscribeTopic[i])) return MQTTASYNC_FAILURE;
+    }
     MQTTAsync_connectOptions conn_opts = MQTTAsync_connectOptions_initializer;
     MQTTAsync_SSLOptions ssl_opts = MQTTAsync_SSLOptions_initializer;
 
     int rc;
-    int i = 0;
+    unsigned long long timingStart;
     int hostLength = strlen(host);
     int serverLength = hostLength + 10;
     int portLength = 5;
     char server[serverLength];
     char pt[portLength];
-    mReconnected = 0;
+    pthread_mutex_lock(&client->reconnectLock);
+    client->reconnected = 0;
+    pthread_mutex_unlock(&client->reconnectLock);
 
     memset(server, 0, serverLength);
     memset(pt, 0, portLength);
@@ -182,37 +1371,52 @@ int MQTTAsyncCreate(char* host, int port, int keepalive, char* userName, char* p
         memcpy(server + hostLength, ":", 1);
         memcpy(server + hostLength + 1, pt, strlen(pt));
     }
-
-    MQTTAsync_create(&mClient, server, clientID, MQTTCLIENT_PERSISTENCE_NONE, NULL);
+
+    timingStart = MQTTTimingNow();
+    MQTTTimingServer(client, host, port);
+    if(client->persistenceConfig.directory[0]) {
+        MQTTPersistenceInit(&client->persistence, &client->persistenceConfig);
+        rc = MQTTAsync_create(&client->handle, server, clientID, MQTTCLIENT_PERSISTENCE_USER, &client->persistence);
+    } else {
+        rc = MQTTAsync_create(&client->handle, server, clientID, MQTTCLIENT_PERSISTENCE_NONE, NULL);
+    }
+    if(rc != MQTTASYNC_SUCCESS) {
+        client->handle = NULL;
+        return rc;
+    }
     conn_opts.keepAliveInterval = keepalive;
     conn_opts.cleansession = cleanSession;
     conn_opts.automaticReconnect = 0;
+    if(client->maxInflight > 0) {
+        conn_opts.maxInflight = client->maxInflight;
+    }
+    conn_opts.MQTTVersion = client->mqttVersion;
 	conn_opts.onSuccess = OnConnect;
     conn_opts.onFailure = OnConnectFailure;
-    conn_opts.context = mClient;
-    conn_opts.ssl = &ssl_opts;	
+    conn_opts.context = client;
+    conn_opts.ssl = &ssl_opts;
 
     if(userName) {
-		memset(mUserName, 0, sizeof(mUserName));
-		memcpy(mUserName, userName, strlen(userName));
-        conn_opts.username = mUserName;
+		memset(client->userName, 0, sizeof(client->userName));
+		memcpy(client->userName, userName, strlen(userName));
+        conn_opts.username = client->userName;
    	}
     if(password && strlen(password) > 0) {
-		memset(mUserPass, 0, sizeof(mUserPass));
-		memcpy(mUserPass, password, strlen(password));
-        conn_opts.password = mUserPass;
+		memset(client->userPass, 0, sizeof(client->userPass));
+		memcpy(client->userPass, password, strlen(password));
+        conn_opts.password = client->userPass;
    	}
     ssl_opts.enableServerCertAuth = enableServerCertAuth;
-    
-    mSubscribeTopicsize = subscribeTopicSize;
-    for(i = 0; i < subscribeTopicSize; i++) {
-        memset(mSubscribeTopic[i], 0, sizeof(mSubscribeTopic[i]));
-        strncpy(mSubscribeTopic[i], subscribeTopic[i], strlen(subscribeTopic[i]));
+
+    rc = MQTTSubscriptionsCreate(client, subscribeTopic, subscribeTopicSize);
+    if(rc != MQTTASYNC_SUCCESS) {
+        MQTTAsyncDestroyEx(client);
+        return rc;
     }
 
     if(publishTopic) {
-        memset(mPublishTopic, 0, sizeof(mPublishTopic));
-        memcpy(mPublishTopic, publishTopic, strlen(publishTopic));
+        memset(client->publishTopic, 0, sizeof(client->publishTopic));
+        memcpy(client->publishTopic, publishTopic, strlen(publishTopic));
 #ifdef SPT_DEBUG_ENABLE
     SKTtpDebugLog(LOG_LEVEL_INFO, "MQTTAsyncCreate() publish topic : %s", publishTopic);
 #else
@@ -220,11 +1424,12 @@ int MQTTAsyncCreate(char* host, int port, int keepalive, char* userName, char* p
 #endif
     }
 
-    MQTTAsync_setCallbacks(mClient, NULL, ConnectionLostCallback, MessageArrivedCallback, MessageDeliveredCallback);
-    MQTTAsync_setConnected(mClient, NULL, OnConnected);
+    MQTTAsync_setCallbacks(client->handle, client, ConnectionLostCallback, MessageArrivedCallback, MessageDeliveredCallback);
+    MQTTAsync_setConnected(client->handle, client, OnConnected);
 
-    if ((rc = MQTTAsync_connect(mClient, &conn_opts)) != MQTTASYNC_SUCCESS){
-        MQTTAsyncDestroy();
+    MQTTTimingStart(client, timingStart);
+    if ((rc = MQTTAsync_connect(client->handle, &conn_opts)) != MQTTASYNC_SUCCESS){
+        MQTTAsyncDestroyEx(client);
         return rc;
     }
 
@@ -238,35 +1443,200 @@ int MQTTAsyncCreate(char* host, int port, int keepalive, char* userName, char* p
  * @return MQTTASYNC_SUCCESS if the subscription request is successful.
  */
 int MQTTAsyncSubscribe(char* topic, int qos) {
+    return MQTTAsyncSubscribeEx(&mDefaultClient, topic, qos);
+}
+
+/**
+ * @brief async subscribe of the session
+ * @param[in] client session handle
+ * @param[in] topic The subscription topic, which may include wildcards.
+ * @param[in] qos The requested quality of service for the subscription.
+ * @return MQTTASYNC_SUCCESS if the subscription request is successful.
+ */
+int MQTTAsyncSubscribeEx(tpClient* client, char* topic, int qos) {
+    if(client == NULL || client->handle == NULL) {
+        return MQTTASYNC_FAILURE;
+    }
     MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
     opts.onSuccess = OnSubscribe;
     opts.onFailure = OnSubscribeFailure;
-    opts.context = mClient;
-    int rc = MQTTAsync_subscribe(mClient, topic, qos, &opts);
+    opts.context = client;
+    int rc = MQTTAsync_subscribe(client->handle, topic, qos, &opts);
+    return rc;
+}
+
+/**
+ * @brief async subscribe of the session completing a future
+ * @param[in] client session handle
+ * @param[in] topic The subscription topic, which may include wildcards.
+ * @param[in] qos The requested quality of service for the subscription.
+ * @param[in] future future completed by the SUBACK
+ * @return MQTTASYNC_SUCCESS if the subscription request is successful. the future is not completed otherwise.
+ */
+static int MQTTAsyncSubscribeFuture(tpClient* client, char* topic, int qos, tpFuture* future) {
+    MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
+    MQTTSubscribeRequest* request;
+    int rc;
+
+    if(client == NULL || client->handle == NULL) {
+        return MQTTASYNC_FAILURE;
+    }
+    request = (MQTTSubscribeRequest *)malloc(sizeof(MQTTSubscribeRequest));
+    if(request == NULL) {
+        return MQTTASYNC_FAILURE;
+    }
+    request->client = client;
+    request->future = future;
+    opts.onSuccess = OnSubscribeFuture;
+    opts.onFailure = OnSubscribeFutureFailure;
+    opts.context = request;
+    rc = MQTTAsync_subscribe(client->handle, topic, qos, &opts);
+    if(rc != MQTTASYNC_SUCCESS) {
+        // paho does not call the response callbacks of a rejected subscribe
+        free(request);
+    }
     return rc;
 }
 
 /**
  * @brief async subscribe a list of topics
+ * @param[in] client session handle
  * @param[in] qos The requested quality of service for the subscription.
  * @return MQTTASYNC_SUCCESS if the subscription request is successful.
  */
-int MQTTAsyncSubscribeMany(int qos) {
+int MQTTAsyncSubscribeMany(tpClient* client, int qos) {
     MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
     opts.onSuccess = OnSubscribe;
     opts.onFailure = OnSubscribeFailure;
-    opts.context = mClient;
-    int qosArray[mSubscribeTopicsize];
-    int i;
-    for (i = 0; i < mSubscribeTopicsize; i++) {
-        qosArray[i] = qos;
-    }
-    char* topics[] = {(char* const)mSubscribeTopic[0], 
-        (char* const)mSubscribeTopic[1], 
-        (char* const)mSubscribeTopic[2], 
-        (char* const)mSubscribeTopic[3], 
-        (char* const)mSubscribeTopic[4]};
-    int rc = MQTTAsync_subscribeMany(mClient, mSubscribeTopicsize, topics, qosArray, &opts);
+    opts.context = client;
+    MQTTSubscriptionList list;
+    int i, rc = MQTTASYNC_SUCCESS;
+
+    pthread_mutex_lock(&client->subscribeLock);
+    if(MQTTSubscriptionsCollect(client, 0, &list) != MQTTASYNC_SUCCESS) {
+        pthread_mutex_unlock(&client->subscribeLock);
+        return MQTTASYNC_FAILURE;
+    }
+    for(i = 0; i < list.count; i++) {
+        // create topics use the QoS of the call, tpMQTTSubscribe filters keep their own
+        if(list.qos[i] < 0) list.qos[i] = qos;
+#ifdef SPT_DEBUG_ENABLE
+        SKTtpDebugLog(LOG_LEVEL_INFO, "subscribed topic : %s", list.filters[i]);
+#else
+        SKTDebugPrint(LOG_LEVEL_INFO, "subscribed topic : %s", list.filters[i]);
+#endif
+    }
+    if(list.count > 0) {
+        // paho copies the filters before returning
+        rc = MQTTAsync_subscribeMany(client->handle, list.count, list.filters, list.qos, &opts);
+    }
+    pthread_mutex_unlock(&client->subscribeLock);
+    free(list.filters);
+    free(list.qos);
+    return rc;
+}
+
+/**
+ * @brief subscribe a topic filter with a handler of the session
+ * @param[in] client session handle
+ * @param[in] filter topic filter, which may include wildcards('+', '#').
+ * @param[in] qos The requested quality of service for the subscription.
+ * @param[in] handler topic handler without handle
+ * @param[in] handlerEx topic handler with handle, used instead of handler when set
+ * @param[in] context handler context
+ * @param[in] future future completed by the SUBACK(may be NULL). it is completed at once
+ * with TP_SDK_OFFLINE_QUEUED when disconnected, or with the error when the request fails.
+ * @return MQTTASYNC_SUCCESS if the filter is added and, when connected, the subscription request is successful.
+ */
+int MQTTSubscribeHandlerEx(tpClient* client, char* filter, int qos,
+        tpMQTTTopicHandler* handler, tpClientTopicHandler* handlerEx, void* context, tpFuture* future) {
+    MQTTSubscription* subscription;
+    MQTTSubscription previous;
+    int count, sent = 0, rc = MQTTASYNC_SUCCESS;
+
+    if(client == NULL || qos < 0 || qos > 2 || !MQTTTopicValidFilter(filter)) {
+        if(future) MQTTFutureComplete(future, 0, MQTTASYNC_FAILURE, 0);
+        return MQTTASYNC_FAILURE;
+    }
+    pthread_mutex_lock(&client->subscribeLock);
+    count = client->subscriptions.count;
+    subscription = MQTTTopicAdd(&client->subscriptions, filter);
+    if(subscription == NULL) {
+        pthread_mutex_unlock(&client->subscribeLock);
+        if(future) MQTTFutureComplete(future, 0, MQTTASYNC_FAILURE, 0);
+        return MQTTASYNC_FAILURE;
+    }
+    previous = *subscription;
+    subscription->qos = qos;
+    subscription->created = 0;
+    subscription->unsubscribing = 0;
+    subscription->handler = handler;
+    subscription->handlerEx = handlerEx;
+    subscription->context = context;
+    if(MQTTAsyncIsConnectedEx(client)) {
+        if(future) rc = MQTTAsyncSubscribeFuture(client, filter, qos, future);
+        else rc = MQTTAsyncSubscribeEx(client, filter, qos);
+        if(rc != MQTTASYNC_SUCCESS) {
+            if(client->subscriptions.count != count) MQTTTopicRemove(&client->subscriptions, filter);
+            else *subscription = previous;
+        }
+        sent = 1;
+    }
+    pthread_mutex_unlock(&client->subscribeLock);
+    // the SUBACK completes the future of a sent request
+    if(future && !sent) MQTTFutureComplete(future, 0, TP_SDK_OFFLINE_QUEUED, 0);
+    else if(future && rc != MQTTASYNC_SUCCESS) MQTTFutureComplete(future, 0, rc, 0);
+    return rc;
+}
+
+/**
+ * @brief unsubscribe a topic filter of the session.
+ *        when connected the filter keeps delivering until the broker acknowledges the unsubscribe.
+ * @param[in] client session handle
+ * @param[in] filter topic filter used to subscribe
+ * @return MQTTASYNC_SUCCESS if the filter is removed or, when connected, the unsubscribe request is successful.
+ */
+int MQTTUnsubscribeEx(tpClient* client, char* filter) {
+    MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
+    MQTTUnsubscribeRequest* request;
+    MQTTSubscription* subscription;
+    size_t len;
+    int rc = MQTTASYNC_SUCCESS;
+
+    if(client == NULL || filter == NULL) {
+        return MQTTASYNC_FAILURE;
+    }
+    pthread_mutex_lock(&client->subscribeLock);
+    subscription = MQTTTopicGet(&client->subscriptions, filter);
+    if(subscription == NULL) {
+        pthread_mutex_unlock(&client->subscribeLock);
+        return MQTTASYNC_FAILURE;
+    }
+    if(!MQTTAsyncIsConnectedEx(client)) {
+        // not subscribed again at the next connect
+        MQTTTopicRemove(&client->subscriptions, filter);
+        pthread_mutex_unlock(&client->subscribeLock);
+        return MQTTASYNC_SUCCESS;
+    }
+    len = strlen(filter);
+    request = (MQTTUnsubscribeRequest *)malloc(sizeof(MQTTUnsubscribeRequest) + len + 1);
+    if(request == NULL) {
+        pthread_mutex_unlock(&client->subscribeLock);
+        return MQTTASYNC_FAILURE;
+    }
+    request->client = client;
+    request->filter = (char *)(request + 1);
+    memcpy(request->filter, filter, len + 1);
+    opts.context = request;
+    opts.onSuccess = OnUnsubscribe;
+    opts.onFailure = OnUnsubscribeFailure;
+    subscription->unsubscribing = 1;
+    rc = MQTTAsync_unsubscribe(client->handle, filter, &opts);
+    if(rc != MQTTASYNC_SUCCESS) {
+        subscription->unsubscribing = 0;
+        free(request);
+    }
+    pthread_mutex_unlock(&client->subscribeLock);
     return rc;
 }
 
@@ -276,19 +1646,20 @@ int MQTTAsyncSubscribeMany(int qos) {
  * @return MQTTASYNC_SUCCESS if the message is accepted for publication.
  */
 int MQTTAsyncPublishMessage(char* payload) {
-    if(mClient == NULL || mPublishTopic == NULL || payload == NULL) {
+    return MQTTAsyncPublishMessageEx(&mDefaultClient, payload);
+}
+
+/**
+ * @brief publish message of the session
+ * @param[in] client session handle
+ * @param[in] payload A pointer to the payload of the MQTT message.
+ * @return MQTTASYNC_SUCCESS if the message is accepted for publication.
+ */
+int MQTTAsyncPublishMessageEx(tpClient* client, char* payload) {
+    if(client == NULL || client->publishTopic[0] == '\0') {
         return MQTTASYNC_FAILURE;
     }
-    MQTTAsync_message pubmsg = MQTTAsync_message_initializer;
-    MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
-
-    pubmsg.payload = payload;
-    pubmsg.payloadlen = strlen(payload);
-    pubmsg.qos = 2;
-    pubmsg.retained = 0;
-    
-    int rc = MQTTAsync_sendMessage(mClient, mPublishTopic, &pubmsg, &opts);
-    return rc;
+    return MQTTAsyncPublishMessageWithTopicEx(client, client->publishTopic, payload);
 }
 
 /**
@@ -297,26 +1668,502 @@ int MQTTAsyncPublishMessage(char* payload) {
  * @param[in] payload A pointer to the payload of the MQTT message.
  * @return MQTTASYNC_SUCCESS if the message is accepted for publication.
  */
- int MQTTAsyncPublishMessageWithTopic(char* topic, char* payload) {
-    if(mClient == NULL || topic == NULL || payload == NULL) {
+int MQTTAsyncPublishMessageWithTopic(char* topic, char* payload) {
+    return MQTTAsyncPublishMessageWithTopicEx(&mDefaultClient, topic, payload);
+}
+
+/**
+ * @brief publish message with topic of the session
+ * @param[in] client session handle
+ * @param[in] topic publish topic
+ * @param[in] payload A pointer to the payload of the MQTT message.
+ * @return MQTTASYNC_SUCCESS if the message is accepted for publication.
+ */
+int MQTTAsyncPublishMessageWithTopicEx(tpClient* client, char* topic, char* payload) {
+    return MQTTAsyncPublishMessageQosEx(client, topic, payload, MQTT_DEFAULT_QOS);
+}
+
+/**
+ * @brief publish message with topic and QoS of the session
+ * @param[in] client session handle
+ * @param[in] topic publish topic
+ * @param[in] payload A pointer to the payload of the MQTT message.
+ * @param[in] qos The quality of service of the message(0, 1 or 2).
+ * @return MQTTASYNC_SUCCESS if the message is accepted for publication.
+ */
+int MQTTAsyncPublishMessageQosEx(tpClient* client, char* topic, char* payload, int qos) {
+    if(payload == NULL) {
         return MQTTASYNC_FAILURE;
     }
+    return MQTTAsyncPublishBufferEx(client, topic, payload, strlen(payload), qos);
+}
+
+/**
+ * @brief topic class of a publish topic(see TOPIC_TELEMETRY, TOPIC_ATTRIBUTE)
+ * @param[in] topic publish topic
+ * @return topic class
+ */
+static TOPIC_CLASS MQTTTopicClass(const char* topic) {
+    if(strstr(topic, "/" TELEMETRY)) return TOPIC_CLASS_TELEMETRY;
+    if(strstr(topic, "/" ATTRIBUTE)) return TOPIC_CLASS_ATTRIBUTE;
+    return TOPIC_CLASS_UP;
+}
+
+/**
+ * @brief count the bytes of an MQTT 3.1.1 PUBLISH packet
+ * @param[in] client session handle
+ * @param[in] topicClass topic class
+ * @param[in] topicLen topic length
+ * @param[in] len payload length
+ * @param[in] qos QoS
+ */
+static void MQTTWireRecord(tpClient* client, TOPIC_CLASS topicClass, size_t topicLen, size_t len, int qos) {
+    // topic length field, topic, packet identifier(QoS 1/2), payload
+    unsigned long remaining = 2 + topicLen + (qos > 0 ? 2 : 0) + len;
+    // fixed header byte and the variable length remaining length
+    unsigned long header = 1 + (remaining < 128 ? 1 : remaining < 16384 ? 2 : remaining < 2097152 ? 3 : 4);
+    tpWireStats* wire = &client->wire[topicClass];
+
+    pthread_mutex_lock(&client->statsLock);
+    wire->messages++;
+    wire->wireBytes += header + remaining;
+    wire->topicBytes += topicLen;
+    wire->payloadBytes += len;
+    // an aliased MQTT 5 PUBLISH has an empty topic, a property length and a 3 byte topic alias property
+    if(topicLen > 4) wire->aliasSavings += topicLen - 4;
+    pthread_mutex_unlock(&client->statsLock);
+}
+
+/**
+ * @brief send a publish to paho
+ * @param[in] client session handle
+ * @param[in] topic publish topic
+ * @param[in] payload payload
+ * @param[in] len payload length
+ * @param[in] qos QoS
+ * @param[in] pc completion callback(may be NULL)
+ * @param[in] context completion callback context
+ * @return MQTTASYNC_SUCCESS if the message is accepted for publication.
+ */
+static int MQTTAsyncSend(tpClient* client, char* topic, const void* payload, size_t len, int qos,
+        tpMQTTPublishCallback* pc, void* context) {
     MQTTAsync_message pubmsg = MQTTAsync_message_initializer;
     MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
+    MQTTPublishTracker* tracker = (MQTTPublishTracker *)malloc(sizeof(MQTTPublishTracker));
+    TOPIC_CLASS topicClass = MQTTTopicClass(topic);
+    if(tracker == NULL) {
+        return MQTTASYNC_FAILURE;
+    }
+    tracker->client = client;
+    tracker->topicClass = topicClass;
+    tracker->callback = pc;
+    tracker->context = context;
 
-    pubmsg.payload = payload;
-    pubmsg.payloadlen = strlen(payload);
-    pubmsg.qos = 2;
+    pubmsg.payload = (void *)payload;
+    pubmsg.payloadlen = (int)len;
+    pubmsg.qos = qos;
     pubmsg.retained = 0;
-    
-    int rc = MQTTAsync_sendMessage(mClient, topic, &pubmsg, &opts);
+    opts.onSuccess = OnPublish;
+    opts.onFailure = OnPublishFailure;
+    opts.context = tracker;
+
+    tracker->start = MQTTNow();
+    int rc = MQTTAsync_sendMessage(client->handle, topic, &pubmsg, &opts);
+    if(rc != MQTTASYNC_SUCCESS) {
+        // paho does not call the response callbacks of a rejected publish
+        free(tracker);
+    } else {
+        // the tracker may be freed by OnPublish in a paho thread already
+        MQTTWireRecord(client, topicClass, strlen(topic), len, qos);
+    }
+    return rc;
+}
+
+/**
+ * @brief notify producers of a flow control state change
+ * @param[in] client session handle
+ * @param[in] state new state
+ * @param[in] pending pending count
+ */
+static void MQTTFlowControlNotify(tpClient* client, FLOW_CONTROL_STATE state, int pending) {
+#ifdef SPT_DEBUG_ENABLE
+    SKTtpDebugLog(LOG_LEVEL_INFO, "flow control : %s, pending : %d", state == FLOW_CONTROL_PAUSE ? "pause" : "resume", pending);
+#else
+    SKTDebugPrint(LOG_LEVEL_INFO, "flow control : %s, pending : %d", state == FLOW_CONTROL_PAUSE ? "pause" : "resume", pending);
+#endif
+    if(client->flowControlCallbackEx) client->flowControlCallbackEx(client, state, pending);
+    else if(client->flowControlCallback) client->flowControlCallback(state, pending);
+}
+
+/**
+ * @brief queue a publish until an in-flight slot is free
+ * @param[in] client session handle
+ * @param[in] topic publish topic
+ * @param[in] payload payload
+ * @param[in] len payload length
+ * @param[in] qos QoS
+ * @param[in] pc completion callback(may be NULL)
+ * @param[in] context completion callback context
+ * @return MQTTASYNC_SUCCESS if queued, MQTTASYNC_MAX_BUFFERED_MESSAGES if the queue is full
+ */
+static int MQTTPendingAdd(tpClient* client, char* topic, const void* payload, size_t len, int qos,
+        tpMQTTPublishCallback* pc, void* context) {
+    int pause = 0, pending;
+    MQTTQueueMessage* message;
+
+    pthread_mutex_lock(&client->pendingLock);
+    if(client->pending.count >= client->maxPending) {
+        pthread_mutex_unlock(&client->pendingLock);
+        return MQTTASYNC_MAX_BUFFERED_MESSAGES;
+    }
+    message = MQTTQueueMessageNew(topic, payload, len, qos);
+    if(message == NULL) {
+        pthread_mutex_unlock(&client->pendingLock);
+        return MQTTASYNC_FAILURE;
+    }
+    message->callback = pc;
+    message->context = context;
+    MQTTQueuePush(&client->pending, message);
+    pending = client->pending.count;
+    if(!client->paused && pending >= client->highWatermark) {
+        client->paused = 1;
+        pause = 1;
+    }
+    pthread_mutex_unlock(&client->pendingLock);
+
+    if(pause) MQTTFlowControlNotify(client, FLOW_CONTROL_PAUSE, pending);
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief send pending publishes while in-flight slots are free
+ * @param[in] client session handle
+ */
+static void MQTTPendingDrain(tpClient* client) {
+    int rc, resume = 0, pending;
+    MQTTQueueMessage* message;
+
+    pthread_mutex_lock(&client->pendingLock);
+    if(client->draining || client->pending.count == 0) {
+        pthread_mutex_unlock(&client->pendingLock);
+        return;
+    }
+    client->draining = 1;
+    while((message = MQTTQueuePop(&client->pending)) != NULL) {
+        // paho is not called with the lock held, its callbacks drain too
+        pthread_mutex_unlock(&client->pendingLock);
+        rc = client->handle ? MQTTAsyncSend(client, message->topic, message->payload, message->len, message->qos,
+            message->callback, message->context) : MQTTASYNC_FAILURE;
+        if(rc != MQTTASYNC_SUCCESS && rc != MQTTASYNC_MAX_MESSAGES_INFLIGHT && rc != MQTTASYNC_DISCONNECTED) {
+#ifdef SPT_DEBUG_ENABLE
+            SKTtpDebugLog(LOG_LEVEL_ERROR, "pending publish dropped : %s, rc : %d", message->topic, rc);
+#else
+            SKTDebugPrint(LOG_LEVEL_ERROR, "pending publish dropped : %s, rc : %d", message->topic, rc);
+#endif
+            // the producer has returned already, the failure goes to the completion callback
+            if(message->callback) message->callback(message->context, 0, rc, 0);
+        }
+        pthread_mutex_lock(&client->pendingLock);
+        if(rc == MQTTASYNC_MAX_MESSAGES_INFLIGHT || rc == MQTTASYNC_DISCONNECTED) {
+            MQTTQueuePushFront(&client->pending, message);
+            break;
+        }
+        MQTTQueueMessageFree(message);
+    }
+    client->draining = 0;
+    pending = client->pending.count;
+    if(client->paused && pending <= client->lowWatermark) {
+        client->paused = 0;
+        resume = 1;
+    }
+    pthread_mutex_unlock(&client->pendingLock);
+
+    if(resume) MQTTFlowControlNotify(client, FLOW_CONTROL_RESUME, pending);
+}
+
+/**
+ * @brief publish binary message with topic and QoS
+ * @param[in] topic publish topic
+ * @param[in] payload A pointer to the payload of the MQTT message. It may contain zero bytes.
+ * @param[in] len The length of the payload in bytes.
+ * @param[in] qos The quality of service of the message(0, 1 or 2).
+ * @return MQTTASYNC_SUCCESS if the message is accepted for publication.
+ */
+int MQTTAsyncPublishBuffer(char* topic, const void* payload, size_t len, int qos) {
+    return MQTTAsyncPublishBufferEx(&mDefaultClient, topic, payload, len, qos);
+}
+
+/**
+ * @brief publish binary message with topic and QoS of the session
+ * @param[in] client session handle
+ * @param[in] topic publish topic
+ * @param[in] payload A pointer to the payload of the MQTT message. It may contain zero bytes.
+ * @param[in] len The length of the payload in bytes.
+ * @param[in] qos The quality of service of the message(0, 1 or 2).
+ * @return MQTTASYNC_SUCCESS if the message is accepted for publication.
+ */
+int MQTTAsyncPublishBufferEx(tpClient* client, char* topic, const void* payload, size_t len, int qos) {
+    return MQTTAsyncPublishCallbackEx(client, topic, payload, len, qos, NULL, NULL);
+}
+
+/**
+ * @brief publish binary message with a completion callback of the session
+ * @param[in] client session handle
+ * @param[in] topic publish topic
+ * @param[in] payload A pointer to the payload of the MQTT message. It may contain zero bytes.
+ * @param[in] len The length of the payload in bytes.
+ * @param[in] qos The quality of service of the message(0, 1 or 2).
+ * @param[in] pc completion callback(may be NULL). not called when the publish is stored in the offline queue.
+ * @param[in] context completion callback context
+ * @return MQTTASYNC_SUCCESS if the message is accepted for publication.
+ */
+int MQTTAsyncPublishCallbackEx(tpClient* client, char* topic, const void* payload, size_t len, int qos,
+        tpMQTTPublishCallback* pc, void* context) {
+    int queued;
+    return MQTTAsyncPublishQueued(client, topic, payload, len, qos, pc, context, &queued);
+}
+
+/**
+ * @brief publish binary message completing a future of the session
+ * @param[in] client session handle
+ * @param[in] topic publish topic
+ * @param[in] payload A pointer to the payload of the MQTT message. It may contain zero bytes.
+ * @param[in] len The length of the payload in bytes.
+ * @param[in] qos The quality of service of the message(0, 1 or 2).
+ * @return future completed by the publish result, TP_SDK_OFFLINE_QUEUED when stored in the offline queue.
+ * NULL if allocation failed.
+ */
+tpFuture* MQTTAsyncPublishFutureEx(tpClient* client, char* topic, const void* payload, size_t len, int qos) {
+    tpFuture* future = MQTTFutureNew();
+    int queued, rc;
+    if(future == NULL) {
+        return NULL;
+    }
+    rc = MQTTAsyncPublishQueued(client, topic, payload, len, qos, MQTTFuturePublished, future, &queued);
+    if(rc != MQTTASYNC_SUCCESS) MQTTFutureComplete(future, 0, rc, 0);
+    else if(queued) MQTTFutureComplete(future, 0, TP_SDK_OFFLINE_QUEUED, 0);
+    return future;
+}
+
+/**
+ * @brief subscribe a topic filter with a handler completing a future of the session
+ * @param[in] client session handle
+ * @param[in] filter topic filter, which may include wildcards('+', '#').
+ * @param[in] qos The requested quality of service for the subscription.
+ * @param[in] handler topic handler without handle
+ * @param[in] handlerEx topic handler with handle, used instead of handler when set
+ * @param[in] context handler context
+ * @return future completed by the SUBACK, TP_SDK_OFFLINE_QUEUED when disconnected. NULL if allocation failed.
+ */
+tpFuture* MQTTSubscribeFutureEx(tpClient* client, char* filter, int qos,
+        tpMQTTTopicHandler* handler, tpClientTopicHandler* handlerEx, void* context) {
+    tpFuture* future = MQTTFutureNew();
+    if(future == NULL) {
+        return NULL;
+    }
+    MQTTSubscribeHandlerEx(client, filter, qos, handler, handlerEx, context, future);
+    return future;
+}
+
+/**
+ * @brief publish binary message with a completion callback of the session
+ * @param[in] client session handle
+ * @param[in] topic publish topic
+ * @param[in] payload A pointer to the payload of the MQTT message. It may contain zero bytes.
+ * @param[in] len The length of the payload in bytes.
+ * @param[in] qos The quality of service of the message(0, 1 or 2).
+ * @param[in] pc completion callback(may be NULL). not called when the publish is stored in the offline queue.
+ * @param[in] context completion callback context
+ * @param[out] queued 1 if the publish is stored in the offline queue
+ * @return MQTTASYNC_SUCCESS if the message is accepted for publication.
+ */
+static int MQTTAsyncPublishQueued(tpClient* client, char* topic, const void* payload, size_t len, int qos,
+        tpMQTTPublishCallback* pc, void* context, int* queued) {
+    MQTTSubmission submission;
+    size_t topicLen;
+
+    *queued = 0;
+    if(client == NULL || topic == NULL || (payload == NULL && len > 0)) {
+        return MQTTASYNC_FAILURE;
+    }
+    if(len > MQTT_MAX_PAYLOAD_LENGTH) {
+        return MQTTASYNC_FAILURE;
+    }
+    if(qos < 0 || qos > 2) {
+        return MQTTASYNC_BAD_QOS;
+    }
+    if(!MQTTSubmitRunning(&client->submit)) {
+        return MQTTAsyncPublishNow(client, topic, payload, len, qos, pc, context, queued);
+    }
+    // topic and payload in one allocation, freed by the dispatcher
+    topicLen = strlen(topic);
+    submission.topic = (char *)malloc(topicLen + 1 + len);
+    if(submission.topic == NULL) {
+        return MQTTASYNC_FAILURE;
+    }
+    memcpy(submission.topic, topic, topicLen + 1);
+    submission.payload = submission.topic + topicLen + 1;
+    if(len > 0) memcpy(submission.payload, payload, len);
+    submission.client = client;
+    submission.len = len;
+    submission.qos = qos;
+    submission.callback = pc;
+    submission.context = context;
+    if(MQTTSubmitPush(&client->submit, &submission) != 0) {
+        free(submission.topic);
+        return MQTTASYNC_MAX_MESSAGES_INFLIGHT;
+    }
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief publish binary message in this thread(no submission queue or the dispatcher)
+ * @param[in] client session handle
+ * @param[in] topic publish topic
+ * @param[in] payload A pointer to the payload of the MQTT message. It may contain zero bytes.
+ * @param[in] len The length of the payload in bytes.
+ * @param[in] qos The quality of service of the message(0, 1 or 2).
+ * @param[in] pc completion callback(may be NULL). not called when the publish is stored in the offline queue.
+ * @param[in] context completion callback context
+ * @param[out] queued 1 if the publish is stored in the offline queue
+ * @return MQTTASYNC_SUCCESS if the message is accepted for publication.
+ */
+static int MQTTAsyncPublishNow(tpClient* client, char* topic, const void* payload, size_t len, int qos,
+        tpMQTTPublishCallback* pc, void* context, int* queued) {
+    *queued = 0;
+    if(client->offline.enabled) {
+        // keep order behind publishes which are not drained yet
+        if(!client->offline.connected || MQTTOfflineCount(&client->offline) > 0) {
+            int rc = MQTTOfflinePut(&client->offline, topic, payload, len, qos);
+            *queued = (rc == MQTTASYNC_SUCCESS);
+            return rc;
+        }
+    }
+    if(client->handle == NULL) {
+        return MQTTASYNC_FAILURE;
+    }
+    int rc;
+    if(client->maxPending > 0) {
+        // keep order behind publishes which are already waiting
+        pthread_mutex_lock(&client->pendingLock);
+        int waiting = client->pending.count > 0 || client->draining;
+        pthread_mutex_unlock(&client->pendingLock);
+        if(waiting) {
+            return MQTTPendingAdd(client, topic, payload, len, qos, pc, context);
+        }
+    }
+    rc = MQTTAsyncSend(client, topic, payload, len, qos, pc, context);
+    if(rc == MQTTASYNC_MAX_MESSAGES_INFLIGHT && client->maxPending > 0) {
+        rc = MQTTPendingAdd(client, topic, payload, len, qos, pc, context);
+        // a slot may have been freed before the message was queued
+        MQTTPendingDrain(client);
+    }
     return rc;
 }
 
+/**
+ * @brief get publish latency of the topic class
+ * @param[in] client session handle
+ * @param[in] topicClass topic class
+ * @param[out] stats latency statistics(usec)
+ * @return MQTTASYNC_SUCCESS if the statistics are set.
+ */
+int MQTTGetPublishStatsEx(tpClient* client, TOPIC_CLASS topicClass, tpPublishStats* stats) {
+    MQTTHistogram* histogram;
+    if(client == NULL || stats == NULL || topicClass < 0 || topicClass >= TOPIC_CLASS_MAX) {
+        return MQTTASYNC_FAILURE;
+    }
+    pthread_mutex_lock(&client->statsLock);
+    histogram = &client->latency[topicClass];
+    stats->count = histogram->total;
+    stats->failed = client->publishFailed[topicClass];
+    stats->min = histogram->min;
+    stats->max = histogram->max;
+    stats->mean = histogram->total ? (unsigned long)(histogram->sum / histogram->total) : 0;
+    stats->p50 = MQTTHistogramPercentile(histogram, 50);
+    stats->p90 = MQTTHistogramPercentile(histogram, 90);
+    stats->p99 = MQTTHistogramPercentile(histogram, 99);
+    stats->p999 = MQTTHistogramPercentile(histogram, 99.9);
+    pthread_mutex_unlock(&client->statsLock);
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief get PUBLISH bytes of the topic class
+ * @param[in] client session handle
+ * @param[in] topicClass topic class
+ * @param[out] stats PUBLISH bytes
+ * @return MQTTASYNC_SUCCESS if the statistics are set.
+ */
+int MQTTGetWireStatsEx(tpClient* client, TOPIC_CLASS topicClass, tpWireStats* stats) {
+    if(client == NULL || stats == NULL || topicClass < 0 || topicClass >= TOPIC_CLASS_MAX) {
+        return MQTTASYNC_FAILURE;
+    }
+    pthread_mutex_lock(&client->statsLock);
+    *stats = client->wire[topicClass];
+    pthread_mutex_unlock(&client->statsLock);
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief clear publish latency of every topic class
+ * @param[in] client session handle
+ */
+void MQTTResetPublishStatsEx(tpClient* client) {
+    int i;
+    if(client == NULL) return;
+    pthread_mutex_lock(&client->statsLock);
+    for(i = 0; i < TOPIC_CLASS_MAX; i++) {
+        MQTTHistogramReset(&client->latency[i]);
+        client->publishFailed[i] = 0;
+        memset(&client->wire[i], 0, sizeof(tpWireStats));
+    }
+    pthread_mutex_unlock(&client->statsLock);
+}
+
+/**
+ * @brief set QoS policy of the topic class
+ * @param[in] client session handle
+ * @param[in] topicClass topic class
+ * @param[in] qos The quality of service of the topic class(0, 1 or 2).
+ * @return MQTTASYNC_SUCCESS if the policy is set.
+ */
+int MQTTSetQosEx(tpClient* client, TOPIC_CLASS topicClass, int qos) {
+    if(client == NULL || topicClass < 0 || topicClass >= TOPIC_CLASS_MAX) {
+        return MQTTASYNC_FAILURE;
+    }
+    if(qos < 0 || qos > 2) {
+        return MQTTASYNC_BAD_QOS;
+    }
+    client->qos[topicClass] = qos;
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief get QoS policy of the topic class
+ * @param[in] client session handle
+ * @param[in] topicClass topic class
+ * @return The quality of service of the topic class.
+ */
+int MQTTGetQosEx(tpClient* client, TOPIC_CLASS topicClass) {
+    if(client == NULL || topicClass < 0 || topicClass >= TOPIC_CLASS_MAX) {
+        return MQTT_DEFAULT_QOS;
+    }
+    return client->qos[topicClass];
+}
+
 /**
  * @brief disconnect mqtt
  */
 int MQTTAsyncDisconnect() {
+    return MQTTAsyncDisconnectEx(&mDefaultClient);
+}
+
+/**
+ * @brief disconnect mqtt of the session
+ * @param[in] client session handle
+ */
+int MQTTAsyncDisconnectEx(tpClient* client) {
 #ifdef SPT_DEBUG_ENABLE
 	SKTtpDebugLog(LOG_LEVEL_INFO, "MQTTAsyncDisconnect()");
 #else
@@ -324,9 +2171,18 @@ int MQTTAsyncDisconnect() {
 #endif
     MQTTAsync_disconnectOptions disc_opts = MQTTAsync_disconnectOptions_initializer;
     disc_opts.onSuccess = OnDisconnect;
+    disc_opts.context = client;
     int rc = MQTTASYNC_FAILURE;
-	if(mClient != NULL) {
-		rc = MQTTAsync_disconnect(mClient, &disc_opts);
+	if(client != NULL && client->handle != NULL) {
+        // collected telemetry and submitted publishes go out before the DISCONNECT
+        MQTTCoalesceFlush(client);
+        MQTTSubmitFlush(&client->submit);
+        // an application disconnect is not reconnected
+        pthread_mutex_lock(&client->reconnectLock);
+        client->reconnectDue = 0;
+        client->reconnectAttempt = 0;
+        pthread_mutex_unlock(&client->reconnectLock);
+		rc = MQTTAsync_disconnect(client->handle, &disc_opts);
 	}
     return rc;
 }
@@ -335,27 +2191,57 @@ int MQTTAsyncDisconnect() {
  * @brief destroy mqtt
  */
 void MQTTAsyncDestroy() {
+    MQTTAsyncDestroyEx(&mDefaultClient);
+}
+
+/**
+ * @brief destroy mqtt of the session
+ * @param[in] client session handle
+ */
+void MQTTAsyncDestroyEx(tpClient* client) {
+    MQTTQueue dropped;
+    int resume;
+
 #ifdef SPT_DEBUG_ENABLE
 	SKTtpDebugLog(LOG_LEVEL_INFO, "MQTTAsyncDestroy()");
 #else
     SKTDebugPrint(LOG_LEVEL_INFO, "MQTTAsyncDestroy()");
 #endif
-	if(gContent) {
-		if(gContent->data) {
-			free(gContent->data);
-			gContent->data = NULL;
-		}
-		free(gContent);
-		gContent = NULL;
+    if(client == NULL) return;
+    // collected telemetry and submitted publishes go out while still connected
+    if(client->handle != NULL) {
+        MQTTCoalesceFlush(client);
+        MQTTSubmitFlush(&client->submit);
+    }
+	if(client->content.data) {
+		free(client->content.data);
+		client->content.data = NULL;
 	}
-	if(mClient != NULL) {
+	client->content.len = 0;
+	client->content.capacity = 0;
+    // the offline queue outlives the connection, stop draining into this handle
+    MQTTOfflineSetConnected(&client->offline, 0);
+    MQTTOfflineWaitIdle(&client->offline);
+    MQTTReconnectStop(client);
+    MQTTTimingUnwatch(client);
+	if(client->handle != NULL) {
         // disconnect when connected.
-        if(MQTTAsync_isConnected(mClient)) {
-            MQTTAsyncDisconnect();
+        if(MQTTAsync_isConnected(client->handle)) {
+            MQTTAsyncDisconnectEx(client);
         }
-        MQTTAsync_destroy(&mClient);
-		mClient = NULL;
+        MQTTAsync_destroy(&client->handle);
+		client->handle = NULL;
 	}
+    MQTTReconnectResume(client);
+    // the unsent publishes are reported outside the lock, their callbacks may publish again
+    pthread_mutex_lock(&client->pendingLock);
+    dropped = client->pending;
+    memset(&client->pending, 0, sizeof(client->pending));
+    resume = client->paused;
+    client->paused = 0;
+    pthread_mutex_unlock(&client->pendingLock);
+    MQTTQueueClearResult(&dropped, MQTTASYNC_OPERATION_INCOMPLETE);
+    if(resume) MQTTFlowControlNotify(client, FLOW_CONTROL_RESUME, 0);
 }
 
 /**
@@ -363,9 +2249,18 @@ void MQTTAsyncDestroy() {
  * @return true : connected <-> false
  */
 int MQTTAsyncIsConnected() {
+    return MQTTAsyncIsConnectedEx(&mDefaultClient);
+}
+
+/**
+ * @brief is connected of the session
+ * @param[in] client session handle
+ * @return true : connected <-> false
+ */
+int MQTTAsyncIsConnectedEx(tpClient* client) {
     int rc = 0;
-    if(mClient) {
-        rc = MQTTAsync_isConnected(mClient);
+    if(client && client->handle) {
+        rc = MQTTAsync_isConnected(client->handle);
     }
     return rc;
 }
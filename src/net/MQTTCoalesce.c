@@ -0,0 +1,221 @@
+/**
+ * @file MQTTCoalesce.c
+ *
+ * @brief telemetry coalescing
+ *
+ * JSON telemetry samples are collected for a time window or up to a size and sent
+ * as one JSON array payload, so the topic, MQTT header, QoS handshake and TLS record
+ * are paid once per batch instead of once per sample. a batch over the compression
+ * threshold is sent compressed(MQTTDeflate.c).
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "MQTT.h"
+#include "MQTTCoalesce.h"
+#ifdef SPT_DEBUG_ENABLE
+#include "SKTDebug.h"
+#else
+#include "SKTtpDebug.h"
+#endif
+
+/**
+ * @brief publish the collected batch. call with the coalesce lock.
+ * @param[in] client session handle
+ * @return the publish result, MQTTASYNC_SUCCESS if nothing is collected
+ */
+static int MQTTCoalesceFlushLocked(tpClient* client) {
+    MQTTCoalesce* coalesce = &client->coalesce;
+    int rc;
+
+    if(coalesce->count == 0) return MQTTASYNC_SUCCESS;
+    if(coalesce->count == 1) {
+        // a lone sample is sent as it is
+        rc = MQTTDeflatePublish(client, coalesce->topic, coalesce->buffer + 1, coalesce->len - 1, coalesce->qos);
+    } else {
+        // the capacity keeps room for the closing bracket
+        coalesce->buffer[coalesce->len] = ']';
+        rc = MQTTDeflatePublish(client, coalesce->topic, coalesce->buffer, coalesce->len + 1, coalesce->qos);
+    }
+    if(rc != MQTTASYNC_SUCCESS) {
+#ifdef SPT_DEBUG_ENABLE
+        SKTtpDebugLog(LOG_LEVEL_ERROR, "coalesced telemetry dropped : %d samples, rc : %d", coalesce->count, rc);
+#else
+        SKTDebugPrint(LOG_LEVEL_ERROR, "coalesced telemetry dropped : %d samples, rc : %d", coalesce->count, rc);
+#endif
+    }
+    coalesce->len = 0;
+    coalesce->count = 0;
+    return rc;
+}
+
+/**
+ * @brief flush thread. publishes a batch when its window ends.
+ * @param[in] arg session handle
+ */
+static void* MQTTCoalesceRun(void* arg) {
+    tpClient* client = (tpClient *)arg;
+    MQTTCoalesce* coalesce = &client->coalesce;
+    struct timespec at;
+
+    pthread_mutex_lock(&coalesce->lock);
+    while(!coalesce->stop) {
+        if(coalesce->count == 0) {
+            pthread_cond_wait(&coalesce->cond, &coalesce->lock);
+            continue;
+        }
+        at = coalesce->deadline;
+        // woken before the time : new batch, stopped or spurious
+        if(pthread_cond_timedwait(&coalesce->cond, &coalesce->lock, &at) != ETIMEDOUT) continue;
+        if(coalesce->stop || coalesce->count == 0) continue;
+        // flushed by size and started again while waiting
+        if(coalesce->deadline.tv_sec != at.tv_sec || coalesce->deadline.tv_nsec != at.tv_nsec) continue;
+        MQTTCoalesceFlushLocked(client);
+    }
+    pthread_mutex_unlock(&coalesce->lock);
+    return NULL;
+}
+
+/**
+ * @brief set telemetry coalescing. the collected batch is sent with the previous setting first.
+ * @param[in] client session handle
+ * @param[in] window collect window in msec(0 : disabled)
+ * @param[in] maxBytes batch size limit in bytes(0 : MQTT_COALESCE_MAX_BYTES)
+ * @return MQTTASYNC_SUCCESS, MQTTASYNC_FAILURE if the flush thread cannot start
+ */
+int MQTTCoalesceSet(tpClient* client, int window, size_t maxBytes) {
+    MQTTCoalesce* coalesce;
+    int rc = MQTTASYNC_SUCCESS;
+
+    if(client == NULL || window < 0) return MQTTASYNC_FAILURE;
+    if(window == 0) {
+        MQTTCoalesceStop(client);
+        return MQTTASYNC_SUCCESS;
+    }
+    coalesce = &client->coalesce;
+    pthread_mutex_lock(&coalesce->lock);
+    MQTTCoalesceFlushLocked(client);
+    __atomic_store_n(&coalesce->window, window, __ATOMIC_RELEASE);
+    coalesce->maxBytes = maxBytes > 0 ? maxBytes : MQTT_COALESCE_MAX_BYTES;
+    if(!coalesce->running) {
+        coalesce->stop = 0;
+        if(pthread_create(&coalesce->thread, NULL, MQTTCoalesceRun, client) == 0) {
+            coalesce->running = 1;
+        } else {
+            __atomic_store_n(&coalesce->window, 0, __ATOMIC_RELEASE);
+            rc = MQTTASYNC_FAILURE;
+        }
+    }
+    pthread_mutex_unlock(&coalesce->lock);
+    return rc;
+}
+
+/**
+ * @brief add a JSON object telemetry sample. published at once when coalescing is disabled.
+ * a batch is flushed first when the topic or QoS changes or the sample does not fit.
+ * @param[in] client session handle
+ * @param[in] topic telemetry topic
+ * @param[in] sample JSON object
+ * @param[in] len sample length
+ * @param[in] qos QoS
+ * @return the result of the publish made by the call, MQTTASYNC_SUCCESS if only collected
+ */
+int MQTTCoalesceAdd(tpClient* client, char* topic, const char* sample, size_t len, int qos) {
+    MQTTCoalesce* coalesce;
+    size_t need;
+    char* buffer;
+    int rc = MQTTASYNC_SUCCESS;
+
+    if(client == NULL || topic == NULL || sample == NULL) return MQTTASYNC_FAILURE;
+    coalesce = &client->coalesce;
+    // disabled : concurrent producers do not serialize on the lock, a batch is flushed when disabling
+    if(__atomic_load_n(&coalesce->window, __ATOMIC_ACQUIRE) == 0) {
+        return MQTTDeflatePublish(client, topic, sample, len, qos);
+    }
+    pthread_mutex_lock(&coalesce->lock);
+    if(coalesce->count > 0 && (coalesce->qos != qos || strcmp(coalesce->topic, topic) != 0
+            || coalesce->len + 1 + len + 1 > coalesce->maxBytes)) {
+        rc = MQTTCoalesceFlushLocked(client);
+    }
+    // disabled, or a sample larger than a batch
+    if(coalesce->window == 0 || 1 + len + 1 > coalesce->maxBytes || strlen(topic) >= sizeof(coalesce->topic)) {
+        rc = MQTTDeflatePublish(client, topic, sample, len, qos);
+        pthread_mutex_unlock(&coalesce->lock);
+        return rc;
+    }
+    // separator or '[', the sample and the closing bracket
+    need = coalesce->len + 1 + len + 1;
+    if(need > coalesce->capacity) {
+        buffer = (char *)realloc(coalesce->buffer, need > coalesce->maxBytes ? need : coalesce->maxBytes);
+        if(buffer == NULL) {
+            pthread_mutex_unlock(&coalesce->lock);
+            return MQTTASYNC_FAILURE;
+        }
+        coalesce->buffer = buffer;
+        coalesce->capacity = need > coalesce->maxBytes ? need : coalesce->maxBytes;
+    }
+    if(coalesce->count == 0) {
+        coalesce->buffer[coalesce->len++] = '[';
+        strcpy(coalesce->topic, topic);
+        coalesce->qos = qos;
+        clock_gettime(CLOCK_REALTIME, &coalesce->deadline);
+        coalesce->deadline.tv_sec += coalesce->window / 1000;
+        coalesce->deadline.tv_nsec += (coalesce->window % 1000) * 1000000L;
+        if(coalesce->deadline.tv_nsec >= 1000000000L) {
+            coalesce->deadline.tv_sec++;
+            coalesce->deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_signal(&coalesce->cond);
+    } else {
+        coalesce->buffer[coalesce->len++] = ',';
+    }
+    memcpy(coalesce->buffer + coalesce->len, sample, len);
+    coalesce->len += len;
+    coalesce->count++;
+    pthread_mutex_unlock(&coalesce->lock);
+    return rc;
+}
+
+/**
+ * @brief publish the collected batch now(control results, disconnect, destroy)
+ * @param[in] client session handle
+ * @return the publish result, MQTTASYNC_SUCCESS if nothing is collected
+ */
+int MQTTCoalesceFlush(tpClient* client) {
+    int rc;
+    if(client == NULL) return MQTTASYNC_FAILURE;
+    pthread_mutex_lock(&client->coalesce.lock);
+    rc = MQTTCoalesceFlushLocked(client);
+    pthread_mutex_unlock(&client->coalesce.lock);
+    return rc;
+}
+
+/**
+ * @brief disable coalescing, publish the collected batch and stop the flush thread
+ * @param[in] client session handle
+ */
+void MQTTCoalesceStop(tpClient* client) {
+    MQTTCoalesce* coalesce = &client->coalesce;
+    int running;
+
+    pthread_mutex_lock(&coalesce->lock);
+    MQTTCoalesceFlushLocked(client);
+    __atomic_store_n(&coalesce->window, 0, __ATOMIC_RELEASE);
+    coalesce->stop = 1;
+    running = coalesce->running;
+    coalesce->running = 0;
+    pthread_cond_broadcast(&coalesce->cond);
+    pthread_mutex_unlock(&coalesce->lock);
+    if(running) pthread_join(coalesce->thread, NULL);
+
+    pthread_mutex_lock(&coalesce->lock);
+    free(coalesce->buffer);
+    coalesce->buffer = NULL;
+    coalesce->capacity = 0;
+    pthread_mutex_unlock(&coalesce->lock);
+}
@@ -0,0 +1,209 @@
+/**
+ * @file MQTTDeflate.c
+ *
+ * @brief JSON payload compression
+ *
+ * JSON payloads over a size threshold are sent as zlib streams to the topic with
+ * TOPIC_DEFLATE_SUFFIX. the stream is primed with a preset dictionary of the ThingPlug
+ * key names in the cJSON_Print layout, so even a single small payload compresses.
+ * the receiver inflates with the same dictionary(inflateSetDictionary on Z_NEED_DICT);
+ * the dictionary is part of the topic contract and is never changed in place.
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Define.h"
+#include "MQTT.h"
+#include "MQTTDeflate.h"
+#ifdef SPT_DEBUG_ENABLE
+#include "SKTDebug.h"
+#else
+#include "SKTtpDebug.h"
+#endif
+
+/**
+ * preset dictionary. zlib matches the end of the dictionary with the shortest distances,
+ * so the most frequent strings are at the end.
+ */
+static const char mDictionary[] =
+    // control results and subscribe requests(Define.h)
+    "\"jsonrpc\":\t\"2.0\",\n\t\"id\":\t\"error\":\t{\n\t\t\"code\":\t\"message\":\t\""
+    "\"status\":\t\"fail\"\"success\"\"rpcRsp\":\t{\n\t\"sensorNodeId\":\t\"isTargetAll\":\t"
+    "\"cmdId\":\t\"cmd\":\t\"telemetry\":\t[\"attribute\":\t[\"result\":\t"
+    // attributes of the device management agent
+    "\"sysLocationLatitude\":\t\"sysLocationLongitude\":\t\"act7colorLed\":\t"
+    "\"sysHardwareVersion\":\t\"sysFirmwareVersion\":\t\"sysSerialNumber\":\t\"sysErrorCode\":\t"
+    "\"sysNetworkType\":\t\"ethernet\",\n\t\"sysThingPlugIpAddress\":\t\"sysDeviceIpAddress\":\t\""
+    "\"sysAvailableMemory\":\t"
+    // telemetry samples and coalesced batches
+    "\"light1\":\t\"humi1\":\t\"temp1\":\t"
+    "\n},{\n\t\"\n}]\",\n\t\"[{\n\t\"\n}{\n\t\",\n\t\"";
+
+/**
+ * @brief get the preset dictionary
+ * @param[out] len dictionary length
+ * @return dictionary
+ */
+const unsigned char* MQTTDeflateDictionary(size_t* len) {
+    if(len) *len = sizeof(mDictionary) - 1;
+    return (const unsigned char *)mDictionary;
+}
+
+/**
+ * @brief thread CPU time
+ * @return usec
+ */
+static unsigned long long MQTTDeflateCpuNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (unsigned long long)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+/**
+ * @brief compress a payload into the compression buffer. call with the deflate lock.
+ * @param[in] deflater compression state
+ * @param[in] payload payload
+ * @param[in] len payload length
+ * @return compressed length, 0 if failed or not smaller than the payload
+ */
+static size_t MQTTDeflateCompress(MQTTDeflate* deflater, const void* payload, size_t len) {
+    uLong bound;
+    unsigned char* buffer;
+
+    if(!deflater->ready) {
+        memset(&deflater->stream, 0, sizeof(z_stream));
+        if(deflateInit2(&deflater->stream, deflater->level, Z_DEFLATED, MQTT_DEFLATE_WINDOW_BITS,
+                MQTT_DEFLATE_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) return 0;
+        deflater->ready = 1;
+    } else if(deflateReset(&deflater->stream) != Z_OK) {
+        return 0;
+    }
+    if(deflateSetDictionary(&deflater->stream, (const Bytef *)mDictionary, sizeof(mDictionary) - 1) != Z_OK) return 0;
+
+    bound = deflateBound(&deflater->stream, len);
+    if(bound > deflater->capacity) {
+        buffer = (unsigned char *)realloc(deflater->buffer, bound);
+        if(buffer == NULL) return 0;
+        deflater->buffer = buffer;
+        deflater->capacity = bound;
+    }
+    deflater->stream.next_in = (Bytef *)payload;
+    deflater->stream.avail_in = len;
+    deflater->stream.next_out = deflater->buffer;
+    deflater->stream.avail_out = deflater->capacity;
+    if(deflate(&deflater->stream, Z_FINISH) != Z_STREAM_END) return 0;
+    if(deflater->stream.total_out >= len) return 0;
+    return deflater->stream.total_out;
+}
+
+/**
+ * @brief set JSON payload compression. payloads of threshold bytes or more are compressed.
+ * @param[in] client session handle
+ * @param[in] threshold smallest payload compressed in bytes(0 : disabled)
+ * @param[in] level zlib level(1 ~ 9, Z_DEFAULT_COMPRESSION)
+ * @return MQTTASYNC_SUCCESS, MQTTASYNC_FAILURE if the level is invalid
+ */
+int MQTTDeflateSet(tpClient* client, size_t threshold, int level) {
+    MQTTDeflate* deflater;
+
+    if(client == NULL || (level != Z_DEFAULT_COMPRESSION && (level < 1 || level > 9))) return MQTTASYNC_FAILURE;
+    deflater = &client->deflate;
+    pthread_mutex_lock(&deflater->lock);
+    if(deflater->ready && deflater->level != level) {
+        deflateEnd(&deflater->stream);
+        deflater->ready = 0;
+    }
+    __atomic_store_n(&deflater->threshold, threshold, __ATOMIC_RELEASE);
+    deflater->level = level;
+    pthread_mutex_unlock(&deflater->lock);
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief publish a JSON payload, compressed to the deflate topic when it reaches the threshold
+ * and the compression saves bytes
+ * @param[in] client session handle
+ * @param[in] topic topic
+ * @param[in] payload JSON payload
+ * @param[in] len payload length
+ * @param[in] qos QoS
+ * @return the publish result
+ */
+int MQTTDeflatePublish(tpClient* client, char* topic, const void* payload, size_t len, int qos) {
+    MQTTDeflate* deflater;
+    char deflateTopic[SIZE_MQTT_TOPIC + sizeof(TOPIC_DEFLATE_SUFFIX)];
+    unsigned long long start;
+    size_t compressed;
+    int rc;
+
+    if(client == NULL || topic == NULL) return MQTTASYNC_FAILURE;
+    deflater = &client->deflate;
+    // disabled : concurrent producers do not serialize on the lock
+    if(__atomic_load_n(&deflater->threshold, __ATOMIC_ACQUIRE) == 0) {
+        return MQTTAsyncPublishBufferEx(client, topic, payload, len, qos);
+    }
+    pthread_mutex_lock(&deflater->lock);
+    if(deflater->threshold == 0 || len < deflater->threshold
+            || strlen(topic) >= SIZE_MQTT_TOPIC) {
+        pthread_mutex_unlock(&deflater->lock);
+        return MQTTAsyncPublishBufferEx(client, topic, payload, len, qos);
+    }
+    start = MQTTDeflateCpuNow();
+    compressed = MQTTDeflateCompress(deflater, payload, len);
+    deflater->stats.cpuUsec += MQTTDeflateCpuNow() - start;
+    if(compressed == 0) {
+        deflater->stats.skipped++;
+        pthread_mutex_unlock(&deflater->lock);
+        return MQTTAsyncPublishBufferEx(client, topic, payload, len, qos);
+    }
+    deflater->stats.compressed++;
+    deflater->stats.inputBytes += len;
+    deflater->stats.outputBytes += compressed;
+    snprintf(deflateTopic, sizeof(deflateTopic), "%s%s", topic, TOPIC_DEFLATE_SUFFIX);
+    // paho copies the payload, the buffer is reused after the publish
+    rc = MQTTAsyncPublishBufferEx(client, deflateTopic, deflater->buffer, compressed, qos);
+    pthread_mutex_unlock(&deflater->lock);
+#ifdef SPT_DEBUG_ENABLE
+    SKTtpDebugLog(LOG_LEVEL_INFO, "deflate : %s, %d -> %d bytes", deflateTopic, (int)len, (int)compressed);
+#else
+    SKTDebugPrint(LOG_LEVEL_INFO, "deflate : %s, %d -> %d bytes", deflateTopic, (int)len, (int)compressed);
+#endif
+    return rc;
+}
+
+/**
+ * @brief get the compression statistics
+ * @param[in] client session handle
+ * @param[out] stats statistics
+ * @return MQTTASYNC_SUCCESS
+ */
+int MQTTDeflateGetStats(tpClient* client, tpCompressionStats* stats) {
+    if(client == NULL || stats == NULL) return MQTTASYNC_FAILURE;
+    pthread_mutex_lock(&client->deflate.lock);
+    *stats = client->deflate.stats;
+    pthread_mutex_unlock(&client->deflate.lock);
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief disable compression and release the stream
+ * @param[in] client session handle
+ */
+void MQTTDeflateStop(tpClient* client) {
+    MQTTDeflate* deflater = &client->deflate;
+
+    pthread_mutex_lock(&deflater->lock);
+    if(deflater->ready) deflateEnd(&deflater->stream);
+    deflater->ready = 0;
+    __atomic_store_n(&deflater->threshold, 0, __ATOMIC_RELEASE);
+    free(deflater->buffer);
+    deflater->buffer = NULL;
+    deflater->capacity = 0;
+    pthread_mutex_unlock(&deflater->lock);
+}
@@ -0,0 +1,119 @@
+/**
+ * @file MQTTDispatch.c
+ *
+ * @brief callback worker pool
+ *
+ * paho calls the application callbacks in its receive thread, so a slow callback delays keepalives
+ * and every other message. the events are handed to workers through bounded rings(MQTTRing.c) instead.
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <stdlib.h>
+
+#include "MQTTDispatch.h"
+
+/**
+ * @brief handle an event in the worker thread(MQTTRingHandler)
+ * @param[in] item event
+ * @param[in] context worker
+ */
+static void MQTTDispatchRun(void* item, void* context) {
+    MQTTDispatchWorker* worker = (MQTTDispatchWorker *)context;
+    worker->handler((MQTTDispatchEvent *)item);
+}
+
+/**
+ * @brief start workers
+ * @param[in] dispatcher stopped dispatcher
+ * @param[in] workers worker count
+ * @param[in] queueSize events queued per worker(0 : MQTT_DISPATCH_QUEUE_SIZE), rounded up to a power of two
+ * @param[in] handler event handler called in the workers
+ * @return 0 if started, -1 otherwise
+ */
+int MQTTDispatchStart(MQTTDispatcher* dispatcher, int workers, int queueSize, MQTTDispatchHandler* handler) {
+    int started;
+
+    if(dispatcher == NULL || dispatcher->count > 0 || workers <= 0 || queueSize < 0 || handler == NULL) return -1;
+    if(queueSize == 0) queueSize = MQTT_DISPATCH_QUEUE_SIZE;
+
+    dispatcher->workers = (MQTTDispatchWorker *)calloc(workers, sizeof(MQTTDispatchWorker));
+    if(dispatcher->workers == NULL) return -1;
+    for(started = 0; started < workers; started++) {
+        MQTTDispatchWorker* worker = &dispatcher->workers[started];
+        worker->handler = handler;
+        if(MQTTRingStart(&worker->ring, sizeof(MQTTDispatchEvent), queueSize, MQTTDispatchRun, worker) != 0) break;
+    }
+    dispatcher->count = started;
+    dispatcher->overflow = 0;
+    if(started < workers) {
+        MQTTDispatchStop(dispatcher);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief stop workers after they handle the queued events. no event may be pushed during the stop.
+ * @param[in] dispatcher dispatcher
+ * @return 0 if stopped, -1 if called in a worker
+ */
+int MQTTDispatchStop(MQTTDispatcher* dispatcher) {
+    int i;
+    if(dispatcher == NULL || dispatcher->workers == NULL) return 0;
+    for(i = 0; i < dispatcher->count; i++) {
+        if(MQTTRingConsumer(&dispatcher->workers[i].ring)) return -1;
+    }
+    for(i = 0; i < dispatcher->count; i++) {
+        MQTTRingStop(&dispatcher->workers[i].ring);
+    }
+    free(dispatcher->workers);
+    dispatcher->workers = NULL;
+    dispatcher->count = 0;
+    return 0;
+}
+
+/**
+ * @brief queue an event to the worker of a key
+ * @param[in] dispatcher started dispatcher
+ * @param[in] key ordering key(MQTTDispatchKey), events of a key are handled in push order
+ * @param[in] event event, copied
+ * @return 0 if queued, -1 if the ring is full
+ */
+int MQTTDispatchPush(MQTTDispatcher* dispatcher, unsigned int key, const MQTTDispatchEvent* event) {
+    if(MQTTRingPush(&dispatcher->workers[key % dispatcher->count].ring, event) == 0) return 0;
+    __atomic_add_fetch(&dispatcher->overflow, 1, __ATOMIC_RELAXED);
+    return -1;
+}
+
+/**
+ * @brief queue an event to the worker of a key, waiting while the ring is full.
+ * used for events which cannot be refused or handled out of order.
+ * @param[in] dispatcher started dispatcher
+ * @param[in] key ordering key(MQTTDispatchKey)
+ * @param[in] event event, copied
+ * @return 0 if queued, -1 if the ring is full and called in the worker of the key
+ */
+int MQTTDispatchPushWait(MQTTDispatcher* dispatcher, unsigned int key, const MQTTDispatchEvent* event) {
+    if(MQTTRingPushWait(&dispatcher->workers[key % dispatcher->count].ring, event) == 0) return 0;
+    __atomic_add_fetch(&dispatcher->overflow, 1, __ATOMIC_RELAXED);
+    return -1;
+}
+
+/**
+ * @brief ordering key of a topic(FNV-1a)
+ * @param[in] topic topic(NULL : session events)
+ * @param[in] topicLen topic length(0 if NUL terminated)
+ * @return key
+ */
+unsigned int MQTTDispatchKey(const char* topic, int topicLen) {
+    unsigned int hash = 2166136261U;
+    int i;
+    if(topic == NULL) return 0;
+    for(i = 0; topicLen > 0 ? i < topicLen : topic[i] != '\0'; i++) {
+        hash ^= (unsigned char)topic[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
@@ -0,0 +1,223 @@
+/**
+ * @file MQTTFuture.c
+ *
+ * @brief completion handle of publish and subscribe
+ *
+ * a future is completed once from the paho callback thread(or at once when the request
+ * is rejected or stored offline) and is shared with the application until both release it.
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+
+#include "MQTTFuture.h"
+#include "Define.h"
+
+/**
+ * @brief absolute monotonic deadline
+ * @param[in] timeout timeout in msec
+ * @param[out] deadline deadline
+ */
+static void MQTTFutureDeadline(int timeout, struct timespec* deadline) {
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeout / 1000;
+    deadline->tv_nsec += (long)(timeout % 1000) * 1000000L;
+    if(deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+/**
+ * @brief wait for a future until a deadline
+ * @param[in] future future
+ * @param[in] deadline deadline(NULL : no timeout)
+ * @return 1 if completed
+ */
+static int MQTTFutureWaitUntil(tpFuture* future, const struct timespec* deadline) {
+    int done, rc = 0;
+    pthread_mutex_lock(&future->lock);
+    while(!future->done && rc != ETIMEDOUT) {
+        if(deadline) rc = pthread_cond_timedwait(&future->cond, &future->lock, deadline);
+        else pthread_cond_wait(&future->cond, &future->lock);
+    }
+    done = future->done;
+    pthread_mutex_unlock(&future->lock);
+    return done;
+}
+
+/**
+ * @brief create a future referenced by the SDK and the application
+ * @return future, NULL if allocation failed
+ */
+tpFuture* MQTTFutureNew() {
+    pthread_condattr_t attr;
+    tpFuture* future = (tpFuture *)calloc(1, sizeof(tpFuture));
+    if(future == NULL) return NULL;
+    pthread_mutex_init(&future->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&future->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    future->refs = 2;
+    return future;
+}
+
+/**
+ * @brief complete a future, wake the waiters, call its callback and drop the SDK reference
+ * @param[in] future future
+ * @param[in] token message token
+ * @param[in] result result code
+ * @param[in] latency latency(usec)
+ */
+void MQTTFutureComplete(tpFuture* future, int token, int result, unsigned long latency) {
+    tpFutureCallback* callback;
+    void* context;
+
+    pthread_mutex_lock(&future->lock);
+    if(future->done) {
+        pthread_mutex_unlock(&future->lock);
+        return;
+    }
+    future->done = 1;
+    future->token = token;
+    future->result = result;
+    future->latency = latency;
+    callback = future->callback;
+    context = future->context;
+    pthread_cond_broadcast(&future->cond);
+    pthread_mutex_unlock(&future->lock);
+
+    if(callback) callback(future, context);
+    MQTTFutureRelease(future);
+}
+
+/**
+ * @brief publish completion callback of a future(tpMQTTPublishCallback)
+ * @param[in] context future
+ * @param[in] token message token
+ * @param[in] result result code
+ * @param[in] latency latency(usec)
+ */
+void MQTTFuturePublished(void* context, int token, int result, unsigned long latency) {
+    MQTTFutureComplete((tpFuture *)context, token, result, latency);
+}
+
+/**
+ * @brief wait for a future
+ * @param[in] future future
+ * @param[in] timeout timeout in msec(negative : no timeout, 0 : poll)
+ * @return the result of the operation, TP_SDK_TIMEOUT if not completed in time
+ */
+int MQTTFutureWait(tpFuture* future, int timeout) {
+    struct timespec deadline;
+    if(future == NULL) return TP_SDK_INVALID_PARAMETER;
+    if(timeout >= 0) MQTTFutureDeadline(timeout, &deadline);
+    if(!MQTTFutureWaitUntil(future, timeout >= 0 ? &deadline : NULL)) return TP_SDK_TIMEOUT;
+    return MQTTFutureResult(future);
+}
+
+/**
+ * @brief wait for every future within one timeout
+ * @param[in] futures futures(NULL entries are skipped)
+ * @param[in] count future count
+ * @param[in] timeout timeout in msec for all of them(negative : no timeout)
+ * @return TP_SDK_SUCCESS if all are completed, TP_SDK_TIMEOUT otherwise. results are read by MQTTFutureResult.
+ */
+int MQTTFutureWaitAll(tpFuture* futures[], int count, int timeout) {
+    struct timespec deadline;
+    int i, rc = TP_SDK_SUCCESS;
+    if(futures == NULL || count < 0) return TP_SDK_INVALID_PARAMETER;
+    if(timeout >= 0) MQTTFutureDeadline(timeout, &deadline);
+    for(i = 0; i < count; i++) {
+        if(futures[i] == NULL) continue;
+        if(!MQTTFutureWaitUntil(futures[i], timeout >= 0 ? &deadline : NULL)) rc = TP_SDK_TIMEOUT;
+    }
+    return rc;
+}
+
+/**
+ * @brief check completion without waiting
+ * @param[in] future future
+ * @return 1 if completed
+ */
+int MQTTFuturePoll(tpFuture* future) {
+    int done;
+    if(future == NULL) return 0;
+    pthread_mutex_lock(&future->lock);
+    done = future->done;
+    pthread_mutex_unlock(&future->lock);
+    return done;
+}
+
+/**
+ * @brief result of a completed future
+ * @param[in] future future
+ * @return the result of the operation, TP_SDK_TIMEOUT if not completed yet
+ */
+int MQTTFutureResult(tpFuture* future) {
+    int result;
+    if(future == NULL) return TP_SDK_INVALID_PARAMETER;
+    pthread_mutex_lock(&future->lock);
+    result = future->done ? future->result : TP_SDK_TIMEOUT;
+    pthread_mutex_unlock(&future->lock);
+    return result;
+}
+
+/**
+ * @brief message token of a completed publish future
+ * @param[in] future future
+ * @return token, 0 if not completed or not sent
+ */
+int MQTTFutureToken(tpFuture* future) {
+    int token;
+    if(future == NULL) return 0;
+    pthread_mutex_lock(&future->lock);
+    token = future->done ? future->token : 0;
+    pthread_mutex_unlock(&future->lock);
+    return token;
+}
+
+/**
+ * @brief set the completion callback. it is called in the paho callback thread,
+ * or at once in the calling thread when the future is already completed.
+ * @param[in] future future
+ * @param[in] callback completion callback
+ * @param[in] context callback context
+ * @return TP_SDK_SUCCESS, TP_SDK_FAILURE if a callback is already set
+ */
+int MQTTFutureThen(tpFuture* future, tpFutureCallback* callback, void* context) {
+    int done;
+    if(future == NULL || callback == NULL) return TP_SDK_INVALID_PARAMETER;
+    pthread_mutex_lock(&future->lock);
+    if(future->callback) {
+        pthread_mutex_unlock(&future->lock);
+        return TP_SDK_FAILURE;
+    }
+    done = future->done;
+    future->callback = callback;
+    future->context = context;
+    pthread_mutex_unlock(&future->lock);
+    if(done) callback(future, context);
+    return TP_SDK_SUCCESS;
+}
+
+/**
+ * @brief drop a reference, the future is freed with the last one
+ * @param[in] future future
+ */
+void MQTTFutureRelease(tpFuture* future) {
+    int refs;
+    if(future == NULL) return;
+    pthread_mutex_lock(&future->lock);
+    refs = --future->refs;
+    pthread_mutex_unlock(&future->lock);
+    if(refs > 0) return;
+    pthread_mutex_destroy(&future->lock);
+    pthread_cond_destroy(&future->cond);
+    free(future);
+}
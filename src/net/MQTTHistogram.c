@@ -0,0 +1,90 @@
+/**
+ * @file MQTTHistogram.c
+ *
+ * @brief MQTT latency histogram
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <string.h>
+
+#include "MQTTHistogram.h"
+
+/** bits of the sub bucket index **/
+#define MQTT_HISTOGRAM_SUB_BITS     4
+/** largest value kept exactly in its bucket range **/
+#define MQTT_HISTOGRAM_MAX_VALUE    ((1ULL << 37) - 1)
+
+/**
+ * @brief bucket of a value. values below 16 have their own bucket,
+ * larger ones are split into 16 buckets per power of two.
+ * @param[in] value value
+ * @return bucket index
+ */
+static int MQTTHistogramIndex(unsigned long long value) {
+    int exponent;
+    if(value < MQTT_HISTOGRAM_SUB_BUCKETS) return (int)value;
+    exponent = 63 - __builtin_clzll(value);
+    return (exponent - MQTT_HISTOGRAM_SUB_BITS + 1) * MQTT_HISTOGRAM_SUB_BUCKETS
+        + (int)(value >> (exponent - MQTT_HISTOGRAM_SUB_BITS)) - MQTT_HISTOGRAM_SUB_BUCKETS;
+}
+
+/**
+ * @brief highest value of a bucket
+ * @param[in] index bucket index
+ * @return highest value
+ */
+static unsigned long long MQTTHistogramValue(int index) {
+    int shift;
+    if(index < MQTT_HISTOGRAM_SUB_BUCKETS) return (unsigned long long)index;
+    shift = index / MQTT_HISTOGRAM_SUB_BUCKETS - 1;
+    return ((unsigned long long)(MQTT_HISTOGRAM_SUB_BUCKETS + index % MQTT_HISTOGRAM_SUB_BUCKETS + 1) << shift) - 1;
+}
+
+/**
+ * @brief record a value
+ * @param[in] histogram histogram
+ * @param[in] value value(usec)
+ */
+void MQTTHistogramRecord(MQTTHistogram* histogram, unsigned long value) {
+    unsigned long long clamped = value > MQTT_HISTOGRAM_MAX_VALUE ? MQTT_HISTOGRAM_MAX_VALUE : value;
+    histogram->counts[MQTTHistogramIndex(clamped)]++;
+    if(histogram->total == 0 || value < histogram->min) histogram->min = value;
+    if(value > histogram->max) histogram->max = value;
+    histogram->total++;
+    histogram->sum += value;
+}
+
+/**
+ * @brief value at a percentile
+ * @param[in] histogram histogram
+ * @param[in] percentile percentile(0 ~ 100)
+ * @return highest value of the bucket which holds the percentile, capped at the maximum value
+ */
+unsigned long MQTTHistogramPercentile(MQTTHistogram* histogram, double percentile) {
+    unsigned long long rank, seen = 0, value;
+    int i;
+
+    if(histogram->total == 0) return 0;
+    if(percentile < 0) percentile = 0;
+    if(percentile > 100) percentile = 100;
+    rank = (unsigned long long)(percentile / 100.0 * histogram->total + 0.5);
+    if(rank < 1) rank = 1;
+    for(i = 0; i < MQTT_HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if(seen >= rank) {
+            value = MQTTHistogramValue(i);
+            return value > histogram->max ? histogram->max : (unsigned long)value;
+        }
+    }
+    return histogram->max;
+}
+
+/**
+ * @brief clear every value
+ * @param[in] histogram histogram
+ */
+void MQTTHistogramReset(MQTTHistogram* histogram) {
+    memset(histogram, 0, sizeof(MQTTHistogram));
+}
@@ -0,0 +1,740 @@
+/**
+ * @file MQTTOffline.c
+ *
+ * @brief MQTT offline queue
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "MQTTAsync.h"
+#include "MQTTOffline.h"
+#ifdef SPT_DEBUG_ENABLE
+#include "SKTDebug.h"
+#else
+#include "SKTtpDebug.h"
+#endif
+
+/** id of the first segment file. segments spilled on close are numbered below it **/
+#define MQTT_OFFLINE_FIRST_SEGMENT      0x10000000
+/** segment file size when not set **/
+#define MQTT_OFFLINE_SEGMENT_SIZE       (1024 * 1024)
+/** retry interval(usec) when a drained message could not be sent **/
+#define MQTT_OFFLINE_RETRY_INTERVAL     100000L
+/** maximum topic length of a record **/
+#define MQTT_OFFLINE_MAX_TOPIC_LENGTH   65535
+/** maximum payload length of a record(remaining length limit) **/
+#define MQTT_OFFLINE_MAX_PAYLOAD_LENGTH 268435455
+
+/** record header. topic(without terminator) and payload follow it **/
+typedef struct
+{
+    /** topic length **/
+    uint32_t topicLen;
+    /** payload length **/
+    uint32_t len;
+    /** QoS **/
+    uint32_t qos;
+} MQTTOfflineRecord;
+
+#ifdef SPT_DEBUG_ENABLE
+#define MQTTOfflineLog(level, ...)  SKTtpDebugLog(level, __VA_ARGS__)
+#else
+#define MQTTOfflineLog(level, ...)  SKTDebugPrint(level, __VA_ARGS__)
+#endif
+
+/**
+ * @brief check a record header read from the ring or a segment
+ * @param[in] record record header
+ * @return 1 if valid
+ */
+static int MQTTOfflineRecordValid(MQTTOfflineRecord* record) {
+    return record->topicLen > 0 && record->topicLen <= MQTT_OFFLINE_MAX_TOPIC_LENGTH
+        && record->len <= MQTT_OFFLINE_MAX_PAYLOAD_LENGTH && record->qos <= 2;
+}
+
+/**
+ * @brief size of a record including its header
+ * @param[in] record record header
+ * @return record size
+ */
+static size_t MQTTOfflineRecordSize(MQTTOfflineRecord* record) {
+    return sizeof(MQTTOfflineRecord) + record->topicLen + record->len;
+}
+
+/*
+ ****************************************
+ * Memory Ring
+ ****************************************
+ */
+/**
+ * @brief append bytes at the end of the ring. the caller checks the free space.
+ * @param[in] offline offline queue
+ * @param[in] data bytes
+ * @param[in] size byte count
+ */
+static void MQTTOfflineRingWrite(MQTTOffline* offline, const void* data, size_t size) {
+    size_t tail = (offline->ringHead + offline->ringUsed) % offline->ringSize;
+    size_t first = offline->ringSize - tail;
+    if(first > size) first = size;
+    memcpy(offline->ring + tail, data, first);
+    if(size > first) {
+        memcpy(offline->ring, (const unsigned char *)data + first, size - first);
+    }
+    offline->ringUsed += size;
+}
+
+/**
+ * @brief copy bytes from the ring without removing them
+ * @param[in] offline offline queue
+ * @param[in] offset offset from the oldest record
+ * @param[out] data buffer
+ * @param[in] size byte count
+ */
+static void MQTTOfflineRingCopy(MQTTOffline* offline, size_t offset, void* data, size_t size) {
+    size_t start = (offline->ringHead + offset) % offline->ringSize;
+    size_t first = offline->ringSize - start;
+    if(first > size) first = size;
+    memcpy(data, offline->ring + start, first);
+    if(size > first) {
+        memcpy((unsigned char *)data + first, offline->ring, size - first);
+    }
+}
+
+/**
+ * @brief remove the oldest record of the ring
+ * @param[in] offline offline queue
+ * @return message, NULL if allocation failed(the record is kept)
+ */
+static MQTTQueueMessage* MQTTOfflineRingTake(MQTTOffline* offline) {
+    MQTTOfflineRecord record;
+    MQTTQueueMessage* message;
+    size_t size;
+
+    MQTTOfflineRingCopy(offline, 0, &record, sizeof(record));
+    message = MQTTQueueMessageAlloc(record.topicLen, record.len, record.qos);
+    if(message == NULL) return NULL;
+    MQTTOfflineRingCopy(offline, sizeof(record), message->topic, record.topicLen);
+    MQTTOfflineRingCopy(offline, sizeof(record) + record.topicLen, message->payload, record.len);
+
+    size = MQTTOfflineRecordSize(&record);
+    offline->ringHead = (offline->ringHead + size) % offline->ringSize;
+    offline->ringUsed -= size;
+    offline->ringCount--;
+    return message;
+}
+
+/*
+ ****************************************
+ * Segment Log
+ ****************************************
+ */
+/**
+ * @brief make the path of a segment file
+ * @param[in] offline offline queue
+ * @param[in] id segment id
+ * @param[in] suffix file suffix
+ * @param[out] path path buffer
+ * @param[in] size path buffer size
+ */
+static void MQTTOfflineSegmentPath(MQTTOffline* offline, unsigned int id, const char* suffix, char* path, size_t size) {
+    snprintf(path, size, "%s/%08x.%s", offline->directory, id, suffix);
+}
+
+/**
+ * @brief close segment files and delete every segment
+ * @param[in] offline offline queue
+ */
+static void MQTTOfflineDiskReset(MQTTOffline* offline) {
+    char path[300];
+    unsigned int id;
+
+    if(offline->reader) {
+        fclose(offline->reader);
+        offline->reader = NULL;
+    }
+    if(offline->writer) {
+        fclose(offline->writer);
+        offline->writer = NULL;
+    }
+    if(offline->directory[0]) {
+        for(id = offline->firstSegment; id <= offline->lastSegment; id++) {
+            MQTTOfflineSegmentPath(offline, id, "seg", path, sizeof(path));
+            unlink(path);
+        }
+    }
+    offline->firstSegment = MQTT_OFFLINE_FIRST_SEGMENT;
+    offline->lastSegment = MQTT_OFFLINE_FIRST_SEGMENT;
+    offline->writerBytes = 0;
+    offline->diskBytes = 0;
+    offline->diskCount = 0;
+}
+
+/**
+ * @brief write a record to a segment file
+ * @param[in] file segment file
+ * @param[in] record record header
+ * @param[in] topic topic
+ * @param[in] payload payload
+ * @return 1 if written
+ */
+static int MQTTOfflineSegmentWrite(FILE* file, MQTTOfflineRecord* record, const char* topic, const void* payload) {
+    if(fwrite(record, sizeof(MQTTOfflineRecord), 1, file) != 1) return 0;
+    if(fwrite(topic, 1, record->topicLen, file) != record->topicLen) return 0;
+    if(record->len > 0 && fwrite(payload, 1, record->len, file) != record->len) return 0;
+    return 1;
+}
+
+/**
+ * @brief append a record to the last segment
+ * @param[in] offline offline queue
+ * @param[in] record record header
+ * @param[in] topic topic
+ * @param[in] payload payload
+ * @return MQTTASYNC_SUCCESS if appended
+ */
+static int MQTTOfflineDiskAppend(MQTTOffline* offline, MQTTOfflineRecord* record, const char* topic, const void* payload) {
+    char path[300];
+    size_t size = MQTTOfflineRecordSize(record);
+
+    if(offline->maxDiskSize > 0 && offline->diskBytes + size > offline->maxDiskSize) {
+        return MQTTASYNC_MAX_BUFFERED_MESSAGES;
+    }
+    if(offline->writerBytes > 0 && offline->writerBytes + size > offline->segmentSize) {
+        if(offline->writer) {
+            fclose(offline->writer);
+            offline->writer = NULL;
+        }
+        offline->lastSegment++;
+        offline->writerBytes = 0;
+    }
+    if(offline->writer == NULL) {
+        MQTTOfflineSegmentPath(offline, offline->lastSegment, "seg", path, sizeof(path));
+        offline->writer = fopen(path, "ab");
+        if(offline->writer == NULL) {
+            MQTTOfflineLog(LOG_LEVEL_ERROR, "offline segment open failed : %s, errno : %d", path, errno);
+            return MQTTASYNC_PERSISTENCE_ERROR;
+        }
+        fseek(offline->writer, 0, SEEK_END);
+        offline->writerBytes = (size_t)ftell(offline->writer);
+    }
+    if(!MQTTOfflineSegmentWrite(offline->writer, record, topic, payload) || fflush(offline->writer) != 0) {
+        // drop the torn record so the segment stays readable
+        clearerr(offline->writer);
+        if(ftruncate(fileno(offline->writer), offline->writerBytes) != 0) {
+            MQTTOfflineLog(LOG_LEVEL_ERROR, "offline segment truncate failed, errno : %d", errno);
+        }
+        return MQTTASYNC_PERSISTENCE_ERROR;
+    }
+    offline->writerBytes += size;
+    offline->diskBytes += size;
+    offline->diskCount++;
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief remove the oldest record of the segment log
+ * @param[in] offline offline queue
+ * @return message, NULL if allocation failed or the log is broken
+ */
+static MQTTQueueMessage* MQTTOfflineDiskTake(MQTTOffline* offline) {
+    char path[300];
+    MQTTOfflineRecord record;
+    MQTTQueueMessage* message;
+
+    while(1) {
+        if(offline->reader == NULL) {
+            if(offline->firstSegment > offline->lastSegment) break;
+            MQTTOfflineSegmentPath(offline, offline->firstSegment, "seg", path, sizeof(path));
+            offline->reader = fopen(path, "rb");
+            if(offline->reader == NULL) {
+                offline->firstSegment++;
+                continue;
+            }
+        }
+        // the writer may have appended since the last end of file
+        clearerr(offline->reader);
+        if(fread(&record, sizeof(record), 1, offline->reader) == 1) break;
+        if(offline->firstSegment >= offline->lastSegment) {
+            record.topicLen = 0;
+            break;
+        }
+        // segment consumed
+        fclose(offline->reader);
+        offline->reader = NULL;
+        MQTTOfflineSegmentPath(offline, offline->firstSegment, "seg", path, sizeof(path));
+        unlink(path);
+        offline->firstSegment++;
+    }
+
+    if(offline->reader == NULL || !MQTTOfflineRecordValid(&record)) {
+        MQTTOfflineLog(LOG_LEVEL_ERROR, "offline segment broken, %d records dropped", offline->diskCount);
+        MQTTOfflineDiskReset(offline);
+        return NULL;
+    }
+    message = MQTTQueueMessageAlloc(record.topicLen, record.len, record.qos);
+    if(message == NULL) {
+        fseek(offline->reader, -(long)sizeof(record), SEEK_CUR);
+        return NULL;
+    }
+    if(fread(message->topic, 1, record.topicLen, offline->reader) != record.topicLen
+        || (record.len > 0 && fread(message->payload, 1, record.len, offline->reader) != record.len)) {
+        MQTTQueueMessageFree(message);
+        MQTTOfflineLog(LOG_LEVEL_ERROR, "offline segment broken, %d records dropped", offline->diskCount);
+        MQTTOfflineDiskReset(offline);
+        return NULL;
+    }
+
+    offline->diskBytes -= MQTTOfflineRecordSize(&record);
+    offline->diskCount--;
+    if(offline->diskCount == 0) {
+        // every segment is consumed
+        MQTTOfflineDiskReset(offline);
+    }
+    return message;
+}
+
+/**
+ * @brief count the records of a segment file and cut a torn record at its end
+ * @param[in] path segment path
+ * @param[out] bytes bytes of the complete records
+ * @return record count
+ */
+static int MQTTOfflineSegmentScan(const char* path, size_t* bytes) {
+    MQTTOfflineRecord record;
+    struct stat st;
+    size_t offset = 0, size;
+    int count = 0;
+    FILE* file = fopen(path, "rb");
+
+    *bytes = 0;
+    if(file == NULL) return 0;
+    if(fstat(fileno(file), &st) != 0) {
+        fclose(file);
+        return 0;
+    }
+    while(fread(&record, sizeof(record), 1, file) == 1) {
+        if(!MQTTOfflineRecordValid(&record)) break;
+        size = MQTTOfflineRecordSize(&record);
+        if(offset + size > (size_t)st.st_size) break;
+        offset += size;
+        count++;
+        if(fseek(file, (long)offset, SEEK_SET) != 0) break;
+    }
+    fclose(file);
+    if(offset < (size_t)st.st_size) {
+        MQTTOfflineLog(LOG_LEVEL_ERROR, "offline segment truncated : %s, %ld bytes", path, (long)st.st_size - (long)offset);
+        if(truncate(path, (off_t)offset) != 0) {
+            MQTTOfflineLog(LOG_LEVEL_ERROR, "offline segment truncate failed, errno : %d", errno);
+        }
+    }
+    *bytes = offset;
+    return count;
+}
+
+/**
+ * @brief recover segments left by a previous session
+ * @param[in] offline offline queue
+ * @return MQTTASYNC_SUCCESS if the directory is usable
+ */
+static int MQTTOfflineDiskOpen(MQTTOffline* offline) {
+    char path[300];
+    DIR* dir;
+    struct dirent* entry;
+    unsigned int id, first = 0, last = 0;
+    int found = 0, length, count;
+    size_t bytes;
+
+    if(mkdir(offline->directory, 0755) != 0 && errno != EEXIST) {
+        MQTTOfflineLog(LOG_LEVEL_ERROR, "offline directory create failed : %s, errno : %d", offline->directory, errno);
+        return MQTTASYNC_PERSISTENCE_ERROR;
+    }
+    dir = opendir(offline->directory);
+    if(dir == NULL) {
+        return MQTTASYNC_PERSISTENCE_ERROR;
+    }
+    while((entry = readdir(dir)) != NULL) {
+        length = 0;
+        if(sscanf(entry->d_name, "%8x.seg%n", &id, &length) != 1 || length != 12 || entry->d_name[length] != '\0') continue;
+        if(!found || id < first) first = id;
+        if(!found || id > last) last = id;
+        found = 1;
+    }
+    closedir(dir);
+
+    offline->firstSegment = MQTT_OFFLINE_FIRST_SEGMENT;
+    offline->lastSegment = MQTT_OFFLINE_FIRST_SEGMENT;
+    if(!found) return MQTTASYNC_SUCCESS;
+
+    offline->firstSegment = first;
+    offline->lastSegment = last;
+    for(id = first; id <= last; id++) {
+        MQTTOfflineSegmentPath(offline, id, "seg", path, sizeof(path));
+        count = MQTTOfflineSegmentScan(path, &bytes);
+        offline->diskCount += count;
+        offline->diskBytes += bytes;
+        if(id == last) offline->writerBytes = bytes;
+    }
+    if(offline->diskCount == 0) {
+        MQTTOfflineDiskReset(offline);
+    } else {
+        MQTTOfflineLog(LOG_LEVEL_INFO, "offline records recovered : %d", offline->diskCount);
+    }
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief drop the consumed part of the first segment so it is not sent again after a restart
+ * @param[in] offline offline queue
+ */
+static void MQTTOfflineDiskCompact(MQTTOffline* offline) {
+    char path[300], temp[300], buffer[4096];
+    size_t bytes;
+    FILE* file;
+
+    if(offline->reader == NULL) return;
+    if(ftell(offline->reader) > 0) {
+        if(offline->writer && offline->firstSegment == offline->lastSegment) {
+            fclose(offline->writer);
+            offline->writer = NULL;
+        }
+        MQTTOfflineSegmentPath(offline, offline->firstSegment, "seg", path, sizeof(path));
+        MQTTOfflineSegmentPath(offline, offline->firstSegment, "tmp", temp, sizeof(temp));
+        file = fopen(temp, "wb");
+        if(file) {
+            clearerr(offline->reader);
+            while((bytes = fread(buffer, 1, sizeof(buffer), offline->reader)) > 0) {
+                if(fwrite(buffer, 1, bytes, file) != bytes) break;
+            }
+            if(fclose(file) == 0 && bytes == 0) {
+                rename(temp, path);
+            } else {
+                unlink(temp);
+            }
+        }
+    }
+    fclose(offline->reader);
+    offline->reader = NULL;
+}
+
+/**
+ * @brief write the held message and the ring to a segment in front of the log
+ * @param[in] offline offline queue
+ */
+static void MQTTOfflineDiskSpill(MQTTOffline* offline) {
+    char path[300];
+    MQTTOfflineRecord record;
+    MQTTQueueMessage* message = offline->held;
+    unsigned int id;
+    int count = 0;
+    FILE* file;
+
+    if(offline->diskCount > 0) {
+        MQTTOfflineDiskCompact(offline);
+        id = offline->firstSegment - 1;
+    } else {
+        MQTTOfflineDiskReset(offline);
+        id = offline->lastSegment;
+    }
+    MQTTOfflineSegmentPath(offline, id, "seg", path, sizeof(path));
+    file = fopen(path, "wb");
+    if(file == NULL) return;
+
+    offline->held = NULL;
+    if(message == NULL && offline->ringCount > 0) {
+        message = MQTTOfflineRingTake(offline);
+    }
+    while(message != NULL) {
+        record.topicLen = (uint32_t)strlen(message->topic);
+        record.len = (uint32_t)message->len;
+        record.qos = (uint32_t)message->qos;
+        if(!MQTTOfflineSegmentWrite(file, &record, message->topic, message->payload)) {
+            MQTTQueueMessageFree(message);
+            break;
+        }
+        MQTTQueueMessageFree(message);
+        count++;
+        message = offline->ringCount > 0 ? MQTTOfflineRingTake(offline) : NULL;
+    }
+    fclose(file);
+    MQTTOfflineLog(LOG_LEVEL_INFO, "offline records spilled : %d", count);
+}
+
+/*
+ ****************************************
+ * Drain
+ ****************************************
+ */
+/**
+ * @brief wait until the interval elapsed or the queue is closed. called with the lock held.
+ * @param[in] offline offline queue
+ * @param[in] usec interval
+ */
+static void MQTTOfflineWait(MQTTOffline* offline, long usec) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += usec / 1000000L;
+    deadline.tv_nsec += (usec % 1000000L) * 1000L;
+    if(deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    while(offline->enabled) {
+        if(pthread_cond_timedwait(&offline->cond, &offline->lock, &deadline) == ETIMEDOUT) break;
+    }
+}
+
+/**
+ * @brief drain thread. sends the oldest record while connected.
+ * @param[in] arg offline queue
+ */
+static void* MQTTOfflineDrain(void* arg) {
+    MQTTOffline* offline = (MQTTOffline *)arg;
+    MQTTQueueMessage* message;
+    int rc;
+
+    pthread_mutex_lock(&offline->lock);
+    while(offline->enabled) {
+        if(!offline->connected || (offline->held == NULL && offline->ringCount == 0 && offline->diskCount == 0)) {
+            pthread_cond_wait(&offline->cond, &offline->lock);
+            continue;
+        }
+        if(offline->held == NULL) {
+            offline->held = offline->ringCount > 0 ? MQTTOfflineRingTake(offline) : MQTTOfflineDiskTake(offline);
+            if(offline->held == NULL) {
+                MQTTOfflineWait(offline, MQTT_OFFLINE_RETRY_INTERVAL);
+                continue;
+            }
+        }
+        message = offline->held;
+        offline->sending = 1;
+        pthread_mutex_unlock(&offline->lock);
+        rc = offline->send(offline->sendContext, message);
+        pthread_mutex_lock(&offline->lock);
+        offline->sending = 0;
+        pthread_cond_broadcast(&offline->cond);
+
+        if(rc == MQTTASYNC_MAX_MESSAGES_INFLIGHT || rc == MQTTASYNC_DISCONNECTED) {
+            MQTTOfflineWait(offline, MQTT_OFFLINE_RETRY_INTERVAL);
+            continue;
+        }
+        if(rc != MQTTASYNC_SUCCESS) {
+            MQTTOfflineLog(LOG_LEVEL_ERROR, "offline publish dropped : %s, rc : %d", message->topic, rc);
+        }
+        offline->held = NULL;
+        MQTTQueueMessageFree(message);
+        if(offline->drainRate > 0) {
+            MQTTOfflineWait(offline, 1000000L / offline->drainRate);
+        }
+    }
+    pthread_mutex_unlock(&offline->lock);
+    return NULL;
+}
+
+/*
+ ****************************************
+ * Major Function
+ ****************************************
+ */
+/**
+ * @brief open the offline queue and start its drain thread
+ * @param[in] offline offline queue
+ * @param[in] memorySize memory ring size in bytes(0 : disk only)
+ * @param[in] directory segment directory(NULL or empty : memory only). segments left by a previous session are recovered.
+ * @param[in] segmentSize maximum bytes of a segment file(0 : 1MB)
+ * @param[in] maxDiskSize maximum bytes of all segment files(0 : no limit)
+ * @param[in] drainRate drained messages per second after connected(0 : unlimited)
+ * @param[in] send drain send function
+ * @param[in] sendContext drain send context
+ * @return MQTTASYNC_SUCCESS if opened
+ */
+int MQTTOfflineOpen(MQTTOffline* offline, size_t memorySize, const char* directory, size_t segmentSize, size_t maxDiskSize,
+        int drainRate, MQTTOfflineSend* send, void* sendContext) {
+    int useDisk = (directory && directory[0]);
+
+    if(offline == NULL || send == NULL || drainRate < 0 || (memorySize == 0 && !useDisk)) {
+        return MQTTASYNC_FAILURE;
+    }
+    if(useDisk && strlen(directory) >= sizeof(offline->directory)) {
+        return MQTTASYNC_FAILURE;
+    }
+    memset(offline, 0, sizeof(MQTTOffline));
+    if(memorySize > 0) {
+        offline->ring = (unsigned char *)malloc(memorySize);
+        if(offline->ring == NULL) return MQTTASYNC_FAILURE;
+        offline->ringSize = memorySize;
+    }
+    if(useDisk) {
+        strcpy(offline->directory, directory);
+        offline->segmentSize = segmentSize > 0 ? segmentSize : MQTT_OFFLINE_SEGMENT_SIZE;
+        offline->maxDiskSize = maxDiskSize;
+        if(MQTTOfflineDiskOpen(offline) != MQTTASYNC_SUCCESS) {
+            free(offline->ring);
+            offline->ring = NULL;
+            return MQTTASYNC_PERSISTENCE_ERROR;
+        }
+    }
+    offline->drainRate = drainRate;
+    offline->send = send;
+    offline->sendContext = sendContext;
+    pthread_mutex_init(&offline->lock, NULL);
+    pthread_cond_init(&offline->cond, NULL);
+
+    offline->enabled = 1;
+    if(pthread_create(&offline->drainThread, NULL, MQTTOfflineDrain, offline) != 0) {
+        offline->enabled = 0;
+        if(offline->writer) fclose(offline->writer);
+        if(offline->reader) fclose(offline->reader);
+        pthread_cond_destroy(&offline->cond);
+        pthread_mutex_destroy(&offline->lock);
+        free(offline->ring);
+        offline->ring = NULL;
+        return MQTTASYNC_FAILURE;
+    }
+    offline->drainRunning = 1;
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief stop the drain thread and close the queue.
+ * with a segment directory, records still in memory are written to disk for the next session.
+ * @param[in] offline offline queue
+ */
+void MQTTOfflineClose(MQTTOffline* offline) {
+    if(offline == NULL || !offline->enabled) return;
+
+    pthread_mutex_lock(&offline->lock);
+    offline->enabled = 0;
+    pthread_cond_broadcast(&offline->cond);
+    pthread_mutex_unlock(&offline->lock);
+    if(offline->drainRunning) {
+        pthread_join(offline->drainThread, NULL);
+        offline->drainRunning = 0;
+    }
+
+    if(offline->directory[0] && (offline->held || offline->ringCount > 0)) {
+        MQTTOfflineDiskSpill(offline);
+    } else if(offline->reader) {
+        MQTTOfflineDiskCompact(offline);
+    }
+    if(offline->held) {
+        MQTTQueueMessageFree(offline->held);
+        offline->held = NULL;
+    }
+    if(offline->reader) {
+        fclose(offline->reader);
+        offline->reader = NULL;
+    }
+    if(offline->writer) {
+        fclose(offline->writer);
+        offline->writer = NULL;
+    }
+    free(offline->ring);
+    offline->ring = NULL;
+    offline->ringCount = 0;
+    offline->diskCount = 0;
+    pthread_cond_destroy(&offline->cond);
+    pthread_mutex_destroy(&offline->lock);
+}
+
+/**
+ * @brief queue a publish. it goes to the memory ring while no segment is pending and it fits,
+ * otherwise it is appended to the segment log.
+ * @param[in] offline offline queue
+ * @param[in] topic publish topic
+ * @param[in] payload payload
+ * @param[in] len payload length
+ * @param[in] qos QoS
+ * @return MQTTASYNC_SUCCESS if queued, MQTTASYNC_MAX_BUFFERED_MESSAGES if the queue is full
+ */
+int MQTTOfflinePut(MQTTOffline* offline, const char* topic, const void* payload, size_t len, int qos) {
+    MQTTOfflineRecord record;
+    size_t topicLen, size;
+    int rc;
+
+    if(offline == NULL || !offline->enabled || topic == NULL || (payload == NULL && len > 0)) {
+        return MQTTASYNC_FAILURE;
+    }
+    topicLen = strlen(topic);
+    if(topicLen == 0 || topicLen > MQTT_OFFLINE_MAX_TOPIC_LENGTH || len > MQTT_OFFLINE_MAX_PAYLOAD_LENGTH) {
+        return MQTTASYNC_FAILURE;
+    }
+    if(qos < 0 || qos > 2) {
+        return MQTTASYNC_BAD_QOS;
+    }
+    record.topicLen = (uint32_t)topicLen;
+    record.len = (uint32_t)len;
+    record.qos = (uint32_t)qos;
+    size = MQTTOfflineRecordSize(&record);
+
+    pthread_mutex_lock(&offline->lock);
+    if(!offline->enabled) {
+        rc = MQTTASYNC_FAILURE;
+    } else if(offline->diskCount == 0 && size <= offline->ringSize - offline->ringUsed) {
+        // segments hold newer records than the ring, so keep to the ring only while none exist
+        MQTTOfflineRingWrite(offline, &record, sizeof(record));
+        MQTTOfflineRingWrite(offline, topic, topicLen);
+        if(len > 0) MQTTOfflineRingWrite(offline, payload, len);
+        offline->ringCount++;
+        rc = MQTTASYNC_SUCCESS;
+    } else if(offline->directory[0]) {
+        rc = MQTTOfflineDiskAppend(offline, &record, topic, payload);
+    } else {
+        rc = MQTTASYNC_MAX_BUFFERED_MESSAGES;
+    }
+    if(rc == MQTTASYNC_SUCCESS) {
+        pthread_cond_broadcast(&offline->cond);
+    }
+    pthread_mutex_unlock(&offline->lock);
+    return rc;
+}
+
+/**
+ * @brief get count of queued publishes including the one being sent
+ * @param[in] offline offline queue
+ * @return queued count
+ */
+int MQTTOfflineCount(MQTTOffline* offline) {
+    int count;
+    if(offline == NULL || !offline->enabled) return 0;
+    pthread_mutex_lock(&offline->lock);
+    count = offline->ringCount + offline->diskCount + (offline->held ? 1 : 0);
+    pthread_mutex_unlock(&offline->lock);
+    return count;
+}
+
+/**
+ * @brief set connection state. the drain thread sends only while connected.
+ * @param[in] offline offline queue
+ * @param[in] connected true : connected <-> false
+ */
+void MQTTOfflineSetConnected(MQTTOffline* offline, int connected) {
+    if(offline == NULL || !offline->enabled) return;
+    pthread_mutex_lock(&offline->lock);
+    offline->connected = connected;
+    pthread_cond_broadcast(&offline->cond);
+    pthread_mutex_unlock(&offline->lock);
+}
+
+/**
+ * @brief wait until the drain thread is not calling send(e.g. before the paho handle is destroyed)
+ * @param[in] offline offline queue
+ */
+void MQTTOfflineWaitIdle(MQTTOffline* offline) {
+    if(offline == NULL || !offline->enabled) return;
+    pthread_mutex_lock(&offline->lock);
+    while(offline->sending) {
+        pthread_cond_wait(&offline->cond, &offline->lock);
+    }
+    pthread_mutex_unlock(&offline->lock);
+}
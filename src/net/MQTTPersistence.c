@@ -0,0 +1,579 @@
+/**
+ * @file MQTTPersistence.c
+ *
+ * @brief MQTT persistence(memory-mapped log)
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "MQTTPersistence.h"
+#ifdef SPT_DEBUG_ENABLE
+#include "SKTDebug.h"
+#else
+#include "SKTtpDebug.h"
+#endif
+
+/** log file magic 'TPPL' **/
+#define MQTT_PERSISTENCE_MAGIC          0x4c505054
+/** log format version **/
+#define MQTT_PERSISTENCE_VERSION        1
+/** state of a live record 'LIVE' **/
+#define MQTT_PERSISTENCE_LIVE           0x4556494c
+/** state of a removed record **/
+#define MQTT_PERSISTENCE_DEAD           0
+/** log file size when not set **/
+#define MQTT_PERSISTENCE_SIZE           (64 * 1024)
+/** index bucket count **/
+#define MQTT_PERSISTENCE_BUCKETS        64
+/** record alignment **/
+#define MQTT_PERSISTENCE_ALIGN(x)       (((x) + 7) & ~(size_t)7)
+
+#ifdef SPT_DEBUG_ENABLE
+#define MQTTPersistenceLog(level, ...)  SKTtpDebugLog(level, __VA_ARGS__)
+#else
+#define MQTTPersistenceLog(level, ...)  SKTDebugPrint(level, __VA_ARGS__)
+#endif
+
+/** log file header **/
+typedef struct
+{
+    /** MQTT_PERSISTENCE_MAGIC **/
+    uint32_t magic;
+    /** MQTT_PERSISTENCE_VERSION **/
+    uint32_t version;
+    /** end of the last committed record **/
+    uint64_t used;
+} MQTTPersistenceHeader;
+
+/** record header. key(NUL terminated) and data follow it, padded to 8 bytes **/
+typedef struct
+{
+    /** MQTT_PERSISTENCE_LIVE or MQTT_PERSISTENCE_DEAD **/
+    uint32_t state;
+    /** key length including terminator **/
+    uint32_t keyLen;
+    /** data length **/
+    uint32_t dataLen;
+    /** reserved **/
+    uint32_t reserved;
+} MQTTPersistenceRecord;
+
+/** index entry of a live record **/
+typedef struct MQTTPersistenceEntry
+{
+    /** next entry of the bucket **/
+    struct MQTTPersistenceEntry* next;
+    /** record offset **/
+    size_t offset;
+    /** key **/
+    char key[1];
+} MQTTPersistenceEntry;
+
+/** opened log **/
+typedef struct
+{
+    /** log path **/
+    char path[520];
+    /** log file **/
+    int fd;
+    /** mapped log **/
+    unsigned char* base;
+    /** mapped size **/
+    size_t size;
+    /** initial size **/
+    size_t initialSize;
+    /** bytes of removed records **/
+    size_t deadBytes;
+    /** live record count **/
+    int count;
+    /** key index **/
+    MQTTPersistenceEntry* buckets[MQTT_PERSISTENCE_BUCKETS];
+} MQTTPersistenceStore;
+
+/**
+ * @brief hash of a key
+ * @param[in] key key
+ * @return bucket index
+ */
+static unsigned int MQTTPersistenceHash(const char* key) {
+    unsigned int hash = 5381;
+    while(*key) {
+        hash = hash * 33 + (unsigned char)*key++;
+    }
+    return hash % MQTT_PERSISTENCE_BUCKETS;
+}
+
+/**
+ * @brief header of the log
+ * @param[in] store opened log
+ * @return log header
+ */
+static MQTTPersistenceHeader* MQTTPersistenceGetHeader(MQTTPersistenceStore* store) {
+    return (MQTTPersistenceHeader *)store->base;
+}
+
+/**
+ * @brief record at an offset
+ * @param[in] store opened log
+ * @param[in] offset record offset
+ * @return record header
+ */
+static MQTTPersistenceRecord* MQTTPersistenceGetRecord(MQTTPersistenceStore* store, size_t offset) {
+    return (MQTTPersistenceRecord *)(store->base + offset);
+}
+
+/**
+ * @brief size of a record including header and padding
+ * @param[in] keyLen key length including terminator
+ * @param[in] dataLen data length
+ * @return record size
+ */
+static size_t MQTTPersistenceRecordSize(size_t keyLen, size_t dataLen) {
+    return MQTT_PERSISTENCE_ALIGN(sizeof(MQTTPersistenceRecord) + keyLen + dataLen);
+}
+
+/**
+ * @brief find the index entry of a key
+ * @param[in] store opened log
+ * @param[in] key key
+ * @param[out] prev previous entry of the bucket(may be NULL)
+ * @return index entry, NULL if not found
+ */
+static MQTTPersistenceEntry* MQTTPersistenceFind(MQTTPersistenceStore* store, const char* key, MQTTPersistenceEntry** prev) {
+    MQTTPersistenceEntry* entry = store->buckets[MQTTPersistenceHash(key)];
+    if(prev) *prev = NULL;
+    while(entry) {
+        if(strcmp(entry->key, key) == 0) return entry;
+        if(prev) *prev = entry;
+        entry = entry->next;
+    }
+    return NULL;
+}
+
+/**
+ * @brief mark the record of an index entry removed and drop the entry
+ * @param[in] store opened log
+ * @param[in] key key
+ * @return 0 if removed
+ */
+static int MQTTPersistenceDrop(MQTTPersistenceStore* store, const char* key) {
+    MQTTPersistenceEntry* prev;
+    MQTTPersistenceEntry* entry = MQTTPersistenceFind(store, key, &prev);
+    MQTTPersistenceRecord* record;
+
+    if(entry == NULL) return MQTTCLIENT_PERSISTENCE_ERROR;
+    record = MQTTPersistenceGetRecord(store, entry->offset);
+    record->state = MQTT_PERSISTENCE_DEAD;
+    store->deadBytes += MQTTPersistenceRecordSize(record->keyLen, record->dataLen);
+    store->count--;
+    if(prev) prev->next = entry->next;
+    else store->buckets[MQTTPersistenceHash(key)] = entry->next;
+    free(entry);
+    return 0;
+}
+
+/**
+ * @brief add an index entry
+ * @param[in] store opened log
+ * @param[in] key key
+ * @param[in] offset record offset
+ * @return 0 if added
+ */
+static int MQTTPersistenceIndex(MQTTPersistenceStore* store, const char* key, size_t offset) {
+    size_t keyLen = strlen(key);
+    unsigned int bucket = MQTTPersistenceHash(key);
+    MQTTPersistenceEntry* entry = (MQTTPersistenceEntry *)malloc(sizeof(MQTTPersistenceEntry) + keyLen);
+    if(entry == NULL) return MQTTCLIENT_PERSISTENCE_ERROR;
+    memcpy(entry->key, key, keyLen + 1);
+    entry->offset = offset;
+    entry->next = store->buckets[bucket];
+    store->buckets[bucket] = entry;
+    store->count++;
+    return 0;
+}
+
+/**
+ * @brief free every index entry
+ * @param[in] store opened log
+ */
+static void MQTTPersistenceIndexClear(MQTTPersistenceStore* store) {
+    MQTTPersistenceEntry* entry;
+    int i;
+    for(i = 0; i < MQTT_PERSISTENCE_BUCKETS; i++) {
+        while((entry = store->buckets[i]) != NULL) {
+            store->buckets[i] = entry->next;
+            free(entry);
+        }
+    }
+    store->count = 0;
+    store->deadBytes = 0;
+}
+
+/**
+ * @brief open and map a log file
+ * @param[in] path log path
+ * @param[in] size minimum file size
+ * @param[out] fd log file
+ * @param[out] mapped mapped size
+ * @return mapped log, NULL if failed
+ */
+static unsigned char* MQTTPersistenceMap(const char* path, size_t size, int* fd, size_t* mapped) {
+    struct stat st;
+    void* base;
+
+    *fd = open(path, O_RDWR | O_CREAT, 0644);
+    if(*fd < 0) return NULL;
+    if(fstat(*fd, &st) != 0) {
+        close(*fd);
+        return NULL;
+    }
+    if((size_t)st.st_size < size) {
+        // preallocate once, records are written in place afterwards
+        if(ftruncate(*fd, (off_t)size) != 0) {
+            close(*fd);
+            return NULL;
+        }
+    } else {
+        size = (size_t)st.st_size;
+    }
+    base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+    if(base == MAP_FAILED) {
+        close(*fd);
+        return NULL;
+    }
+    *mapped = size;
+    return (unsigned char *)base;
+}
+
+/**
+ * @brief rebuild the index from the log. records after a torn write are dropped.
+ * @param[in] store opened log
+ */
+static void MQTTPersistenceLoad(MQTTPersistenceStore* store) {
+    MQTTPersistenceHeader* header = MQTTPersistenceGetHeader(store);
+    MQTTPersistenceRecord* record;
+    size_t offset = sizeof(MQTTPersistenceHeader), size;
+    char* key;
+
+    if(header->magic != MQTT_PERSISTENCE_MAGIC || header->version != MQTT_PERSISTENCE_VERSION
+        || header->used < sizeof(MQTTPersistenceHeader) || header->used > store->size) {
+        header->magic = MQTT_PERSISTENCE_MAGIC;
+        header->version = MQTT_PERSISTENCE_VERSION;
+        header->used = sizeof(MQTTPersistenceHeader);
+        return;
+    }
+    while(offset + sizeof(MQTTPersistenceRecord) <= header->used) {
+        record = MQTTPersistenceGetRecord(store, offset);
+        if(record->keyLen == 0 || record->keyLen > header->used || record->dataLen > header->used) break;
+        size = MQTTPersistenceRecordSize(record->keyLen, record->dataLen);
+        if(offset + size > header->used) break;
+        key = (char *)(record + 1);
+        if(key[record->keyLen - 1] != '\0') break;
+        if(record->state == MQTT_PERSISTENCE_LIVE) {
+            // a key put again is live only in its latest record
+            MQTTPersistenceDrop(store, key);
+            MQTTPersistenceIndex(store, key, offset);
+        } else {
+            store->deadBytes += size;
+        }
+        offset += size;
+    }
+    if(offset != header->used) {
+        MQTTPersistenceLog(LOG_LEVEL_ERROR, "persistence log truncated : %s", store->path);
+        header->used = offset;
+    }
+}
+
+/**
+ * @brief copy live records to a new log of the given size and replace the current one.
+ * the new log is renamed over the current one, so a crash leaves either of them intact.
+ * @param[in] store opened log
+ * @param[in] size new log size
+ * @return 0 if replaced
+ */
+static int MQTTPersistenceCompact(MQTTPersistenceStore* store, size_t size) {
+    char temp[528];
+    unsigned char* base;
+    size_t mapped, offset = sizeof(MQTTPersistenceHeader), recordSize;
+    MQTTPersistenceHeader* header;
+    MQTTPersistenceRecord* record;
+    MQTTPersistenceEntry* entry;
+    int fd, i;
+
+    snprintf(temp, sizeof(temp), "%s.tmp", store->path);
+    unlink(temp);
+    base = MQTTPersistenceMap(temp, size, &fd, &mapped);
+    if(base == NULL) return MQTTCLIENT_PERSISTENCE_ERROR;
+
+    // paho restores by key, so the record order does not matter
+    for(i = 0; i < MQTT_PERSISTENCE_BUCKETS; i++) {
+        for(entry = store->buckets[i]; entry; entry = entry->next) {
+            record = MQTTPersistenceGetRecord(store, entry->offset);
+            recordSize = MQTTPersistenceRecordSize(record->keyLen, record->dataLen);
+            memcpy(base + offset, record, recordSize);
+            offset += recordSize;
+        }
+    }
+    header = (MQTTPersistenceHeader *)base;
+    header->magic = MQTT_PERSISTENCE_MAGIC;
+    header->version = MQTT_PERSISTENCE_VERSION;
+    header->used = offset;
+
+    if(msync(base, offset, MS_SYNC) != 0 || rename(temp, store->path) != 0) {
+        MQTTPersistenceLog(LOG_LEVEL_ERROR, "persistence compact failed : %s, errno : %d", store->path, errno);
+        munmap(base, mapped);
+        close(fd);
+        unlink(temp);
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+
+    // same walk as the copy above
+    offset = sizeof(MQTTPersistenceHeader);
+    for(i = 0; i < MQTT_PERSISTENCE_BUCKETS; i++) {
+        for(entry = store->buckets[i]; entry; entry = entry->next) {
+            record = MQTTPersistenceGetRecord(store, entry->offset);
+            entry->offset = offset;
+            offset += MQTTPersistenceRecordSize(record->keyLen, record->dataLen);
+        }
+    }
+    munmap(store->base, store->size);
+    close(store->fd);
+    store->base = base;
+    store->size = mapped;
+    store->fd = fd;
+    store->deadBytes = 0;
+    return 0;
+}
+
+/**
+ * @brief open the persistent store of a client
+ * @param[out] handle opened log
+ * @param[in] clientID client identifier
+ * @param[in] serverURI server URI
+ * @param[in] context MQTTPersistenceConfig
+ * @return 0 if opened, otherwise MQTTCLIENT_PERSISTENCE_ERROR
+ */
+static int MQTTPersistenceOpen(void** handle, const char* clientID, const char* serverURI, void* context) {
+    MQTTPersistenceConfig* config = (MQTTPersistenceConfig *)context;
+    MQTTPersistenceStore* store;
+    char name[256];
+    size_t size;
+    char* p;
+
+    if(config == NULL || config->directory[0] == '\0') return MQTTCLIENT_PERSISTENCE_ERROR;
+    if(mkdir(config->directory, 0755) != 0 && errno != EEXIST) return MQTTCLIENT_PERSISTENCE_ERROR;
+    store = (MQTTPersistenceStore *)calloc(1, sizeof(MQTTPersistenceStore));
+    if(store == NULL) return MQTTCLIENT_PERSISTENCE_ERROR;
+
+    // one log per client ID and server, as the paho file persistence does
+    snprintf(name, sizeof(name), "%s-%s", clientID, serverURI);
+    for(p = name; *p; p++) {
+        if(*p == '/' || *p == ':') *p = '-';
+    }
+    snprintf(store->path, sizeof(store->path), "%s/%s.plog", config->directory, name);
+
+    size = config->size > 0 ? config->size : MQTT_PERSISTENCE_SIZE;
+    if(size < sizeof(MQTTPersistenceHeader) * 2) size = sizeof(MQTTPersistenceHeader) * 2;
+    store->initialSize = size;
+    store->base = MQTTPersistenceMap(store->path, size, &store->fd, &store->size);
+    if(store->base == NULL) {
+        MQTTPersistenceLog(LOG_LEVEL_ERROR, "persistence open failed : %s, errno : %d", store->path, errno);
+        free(store);
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+    MQTTPersistenceLoad(store);
+    *handle = store;
+    return 0;
+}
+
+/**
+ * @brief close the persistent store
+ * @param[in] handle opened log
+ * @return 0
+ */
+static int MQTTPersistenceClose(void* handle) {
+    MQTTPersistenceStore* store = (MQTTPersistenceStore *)handle;
+    if(store == NULL) return MQTTCLIENT_PERSISTENCE_ERROR;
+    MQTTPersistenceIndexClear(store);
+    munmap(store->base, store->size);
+    close(store->fd);
+    free(store);
+    return 0;
+}
+
+/**
+ * @brief append a record. a previous record of the key is removed after the new one is committed.
+ * @param[in] handle opened log
+ * @param[in] key key
+ * @param[in] bufcount buffer count
+ * @param[in] buffers buffers
+ * @param[in] buflens buffer lengths
+ * @return 0 if stored, otherwise MQTTCLIENT_PERSISTENCE_ERROR
+ */
+static int MQTTPersistencePut(void* handle, char* key, int bufcount, char* buffers[], int buflens[]) {
+    MQTTPersistenceStore* store = (MQTTPersistenceStore *)handle;
+    MQTTPersistenceHeader* header;
+    MQTTPersistenceRecord* record;
+    size_t keyLen = strlen(key) + 1, dataLen = 0, size, live, offset;
+    unsigned char* data;
+    int i;
+
+    for(i = 0; i < bufcount; i++) {
+        dataLen += buflens[i];
+    }
+    size = MQTTPersistenceRecordSize(keyLen, dataLen);
+    header = MQTTPersistenceGetHeader(store);
+    if(header->used + size > store->size) {
+        // drop removed records, grow only when live records need it
+        live = header->used - sizeof(MQTTPersistenceHeader) - store->deadBytes;
+        offset = store->size;
+        while(sizeof(MQTTPersistenceHeader) + live + size > offset / 2 && offset < store->initialSize * 1024) {
+            offset *= 2;
+        }
+        if(sizeof(MQTTPersistenceHeader) + live + size > offset || MQTTPersistenceCompact(store, offset) != 0) {
+            return MQTTCLIENT_PERSISTENCE_ERROR;
+        }
+        header = MQTTPersistenceGetHeader(store);
+    }
+
+    offset = (size_t)header->used;
+    record = MQTTPersistenceGetRecord(store, offset);
+    record->state = MQTT_PERSISTENCE_LIVE;
+    record->keyLen = (uint32_t)keyLen;
+    record->dataLen = (uint32_t)dataLen;
+    record->reserved = 0;
+    memcpy(record + 1, key, keyLen);
+    data = (unsigned char *)(record + 1) + keyLen;
+    for(i = 0; i < bufcount; i++) {
+        memcpy(data, buffers[i], buflens[i]);
+        data += buflens[i];
+    }
+    // the record is committed when used covers it
+    header->used = offset + size;
+
+    MQTTPersistenceDrop(store, key);
+    return MQTTPersistenceIndex(store, key, offset);
+}
+
+/**
+ * @brief get a copy of the data of a key
+ * @param[in] handle opened log
+ * @param[in] key key
+ * @param[out] buffer data allocated with malloc
+ * @param[out] buflen data length
+ * @return 0 if found, otherwise MQTTCLIENT_PERSISTENCE_ERROR
+ */
+static int MQTTPersistenceGet(void* handle, char* key, char** buffer, int* buflen) {
+    MQTTPersistenceStore* store = (MQTTPersistenceStore *)handle;
+    MQTTPersistenceEntry* entry = MQTTPersistenceFind(store, key, NULL);
+    MQTTPersistenceRecord* record;
+
+    if(entry == NULL) return MQTTCLIENT_PERSISTENCE_ERROR;
+    record = MQTTPersistenceGetRecord(store, entry->offset);
+    *buffer = (char *)malloc(record->dataLen > 0 ? record->dataLen : 1);
+    if(*buffer == NULL) return MQTTCLIENT_PERSISTENCE_ERROR;
+    memcpy(*buffer, (char *)(record + 1) + record->keyLen, record->dataLen);
+    *buflen = (int)record->dataLen;
+    return 0;
+}
+
+/**
+ * @brief remove a key
+ * @param[in] handle opened log
+ * @param[in] key key
+ * @return 0 if removed, otherwise MQTTCLIENT_PERSISTENCE_ERROR
+ */
+static int MQTTPersistenceRemove(void* handle, char* key) {
+    MQTTPersistenceStore* store = (MQTTPersistenceStore *)handle;
+    int rc = MQTTPersistenceDrop(store, key);
+    if(store->count == 0) {
+        // nothing live, restart the log from the beginning
+        MQTTPersistenceGetHeader(store)->used = sizeof(MQTTPersistenceHeader);
+        store->deadBytes = 0;
+    }
+    return rc;
+}
+
+/**
+ * @brief get every key
+ * @param[in] handle opened log
+ * @param[out] keys key array allocated with malloc
+ * @param[out] nkeys key count
+ * @return 0 if succeeded, otherwise MQTTCLIENT_PERSISTENCE_ERROR
+ */
+static int MQTTPersistenceKeys(void* handle, char*** keys, int* nkeys) {
+    MQTTPersistenceStore* store = (MQTTPersistenceStore *)handle;
+    MQTTPersistenceEntry* entry;
+    int i, n = 0;
+
+    *keys = NULL;
+    *nkeys = 0;
+    if(store->count == 0) return 0;
+    *keys = (char **)malloc(sizeof(char *) * store->count);
+    if(*keys == NULL) return MQTTCLIENT_PERSISTENCE_ERROR;
+    for(i = 0; i < MQTT_PERSISTENCE_BUCKETS; i++) {
+        for(entry = store->buckets[i]; entry; entry = entry->next) {
+            (*keys)[n] = strdup(entry->key);
+            if((*keys)[n] == NULL) {
+                while(n > 0) free((*keys)[--n]);
+                free(*keys);
+                *keys = NULL;
+                return MQTTCLIENT_PERSISTENCE_ERROR;
+            }
+            n++;
+        }
+    }
+    *nkeys = n;
+    return 0;
+}
+
+/**
+ * @brief remove every key
+ * @param[in] handle opened log
+ * @return 0
+ */
+static int MQTTPersistenceClear(void* handle) {
+    MQTTPersistenceStore* store = (MQTTPersistenceStore *)handle;
+    MQTTPersistenceIndexClear(store);
+    MQTTPersistenceGetHeader(store)->used = sizeof(MQTTPersistenceHeader);
+    return 0;
+}
+
+/**
+ * @brief check a key
+ * @param[in] handle opened log
+ * @param[in] key key
+ * @return 0 if found, otherwise MQTTCLIENT_PERSISTENCE_ERROR
+ */
+static int MQTTPersistenceContainsKey(void* handle, char* key) {
+    MQTTPersistenceStore* store = (MQTTPersistenceStore *)handle;
+    return MQTTPersistenceFind(store, key, NULL) ? 0 : MQTTCLIENT_PERSISTENCE_ERROR;
+}
+
+/**
+ * @brief fill a paho persistence interface with the memory-mapped log
+ * @param[out] persistence paho persistence interface(MQTTCLIENT_PERSISTENCE_USER)
+ * @param[in] config configuration, kept while the client exists
+ */
+void MQTTPersistenceInit(MQTTClient_persistence* persistence, MQTTPersistenceConfig* config) {
+    persistence->context = config;
+    persistence->popen = MQTTPersistenceOpen;
+    persistence->pclose = MQTTPersistenceClose;
+    persistence->pput = MQTTPersistencePut;
+    persistence->pget = MQTTPersistenceGet;
+    persistence->premove = MQTTPersistenceRemove;
+    persistence->pkeys = MQTTPersistenceKeys;
+    persistence->pclear = MQTTPersistenceClear;
+    persistence->pcontainskey = MQTTPersistenceContainsKey;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file MQTTQueue.c
+ *
+ * @brief MQTT publish queue
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MQTTQueue.h"
+
+/**
+ * @brief allocate a queue message. the caller fills topic and payload.
+ * @param[in] topicLen topic length without terminator
+ * @param[in] len payload length
+ * @param[in] qos QoS
+ * @return queue message, NULL if allocation failed
+ */
+MQTTQueueMessage* MQTTQueueMessageAlloc(size_t topicLen, size_t len, int qos) {
+    MQTTQueueMessage* message = (MQTTQueueMessage *)malloc(sizeof(MQTTQueueMessage) + topicLen + 1 + len);
+    if(message == NULL) return NULL;
+    message->next = NULL;
+    message->topic = (char *)(message + 1);
+    message->topic[topicLen] = '\0';
+    message->payload = message->topic + topicLen + 1;
+    message->len = len;
+    message->qos = qos;
+    message->callback = NULL;
+    message->context = NULL;
+    return message;
+}
+
+/**
+ * @brief copy a publish into a new queue message
+ * @param[in] topic publish topic
+ * @param[in] payload payload
+ * @param[in] len payload length
+ * @param[in] qos QoS
+ * @return queue message, NULL if allocation failed
+ */
+MQTTQueueMessage* MQTTQueueMessageNew(const char* topic, const void* payload, size_t len, int qos) {
+    size_t topicLen = strlen(topic);
+    MQTTQueueMessage* message = MQTTQueueMessageAlloc(topicLen, len, qos);
+    if(message == NULL) return NULL;
+    memcpy(message->topic, topic, topicLen);
+    if(len > 0) {
+        memcpy(message->payload, payload, len);
+    }
+    return message;
+}
+
+/**
+ * @brief free a queue message
+ * @param[in] message queue message
+ */
+void MQTTQueueMessageFree(MQTTQueueMessage* message) {
+    free(message);
+}
+
+/**
+ * @brief append a message
+ * @param[in] queue queue
+ * @param[in] message message to append
+ */
+void MQTTQueuePush(MQTTQueue* queue, MQTTQueueMessage* message) {
+    message->next = NULL;
+    if(queue->tail) {
+        queue->tail->next = message;
+    } else {
+        queue->head = message;
+    }
+    queue->tail = message;
+    queue->count++;
+    queue->bytes += message->len;
+}
+
+/**
+ * @brief put a message back in front(e.g. when it could not be sent)
+ * @param[in] queue queue
+ * @param[in] message message to insert
+ */
+void MQTTQueuePushFront(MQTTQueue* queue, MQTTQueueMessage* message) {
+    message->next = queue->head;
+    queue->head = message;
+    if(queue->tail == NULL) {
+        queue->tail = message;
+    }
+    queue->count++;
+    queue->bytes += message->len;
+}
+
+/**
+ * @brief remove the first message
+ * @param[in] queue queue
+ * @return first message, NULL if the queue is empty
+ */
+MQTTQueueMessage* MQTTQueuePop(MQTTQueue* queue) {
+    MQTTQueueMessage* message = queue->head;
+    if(message == NULL) return NULL;
+    queue->head = message->next;
+    if(queue->head == NULL) {
+        queue->tail = NULL;
+    }
+    message->next = NULL;
+    queue->count--;
+    queue->bytes -= message->len;
+    return message;
+}
+
+/**
+ * @brief free every message
+ * @param[in] queue queue
+ */
+void MQTTQueueClear(MQTTQueue* queue) {
+    MQTTQueueMessage* message;
+    while((message = MQTTQueuePop(queue)) != NULL) {
+        MQTTQueueMessageFree(message);
+    }
+}
+
+/**
+ * @brief free every message after reporting a result to its completion callback
+ * @param[in] queue queue, not locked by the caller while the callbacks run
+ * @param[in] result result passed to the callbacks(e.g. MQTTASYNC_OPERATION_INCOMPLETE)
+ */
+void MQTTQueueClearResult(MQTTQueue* queue, int result) {
+    MQTTQueueMessage* message;
+    while((message = MQTTQueuePop(queue)) != NULL) {
+        if(message->callback) message->callback(message->context, 0, result, 0);
+        MQTTQueueMessageFree(message);
+    }
+}
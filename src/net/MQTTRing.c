@@ -0,0 +1,263 @@
+/**
+ * @file MQTTRing.c
+ *
+ * @brief bounded multi-producer ring with one consumer thread
+ *
+ * producers reserve a cell with a compare and swap and publish it with its sequence, so they never
+ * take a lock, and the consumer thread is woken by a semaphore post per item. the callback workers
+ * and the publish submission queue are built on it.
+ * producers which must not drop an item and threads waiting for the consumer to catch up block
+ * on a semaphore or a condition, which the consumer signals only while someone waits.
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+
+#include "MQTTRing.h"
+
+/** cell header. the item follows it with the strictest alignment **/
+typedef union
+{
+    unsigned long sequence;
+    long double align;
+    void* pointer;
+} MQTTRingHeader;
+
+/**
+ * @brief sequence of a cell
+ * @param[in] ring ring
+ * @param[in] pos ring position
+ * @return sequence of the cell of the position
+ */
+static unsigned long* MQTTRingSequence(MQTTRing* ring, unsigned long pos) {
+    return &((MQTTRingHeader *)(ring->cells + (pos & ring->mask) * ring->cellSize))->sequence;
+}
+
+/**
+ * @brief take the next published item
+ * @param[in] ring ring
+ * @param[out] item item copy
+ * @return 1 if taken, 0 if the next cell is not published
+ */
+static int MQTTRingPop(MQTTRing* ring, void* item) {
+    unsigned long pos = ring->tail;
+    unsigned long* sequence = MQTTRingSequence(ring, pos);
+    if(__atomic_load_n(sequence, __ATOMIC_ACQUIRE) != pos + 1) return 0;
+    memcpy(item, (unsigned char *)sequence + sizeof(MQTTRingHeader), ring->itemSize);
+    // free for the producers of the next lap
+    __atomic_store_n(sequence, pos + ring->mask + 1, __ATOMIC_RELEASE);
+    ring->tail = pos + 1;
+    // the waiting count is read after the cell is freed, a waiter counted before its last try is woken
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&ring->waiting, __ATOMIC_RELAXED) > 0) sem_post(&ring->room);
+    return 1;
+}
+
+/**
+ * @brief consumer thread. handles items in ring order until stopped and drained.
+ * @param[in] arg ring
+ */
+static void* MQTTRingRun(void* arg) {
+    MQTTRing* ring = (MQTTRing *)arg;
+
+    for(;;) {
+        while(sem_wait(&ring->ready) != 0 && errno == EINTR);
+        while(!MQTTRingPop(ring, ring->item)) {
+            // nothing reserved : the post of MQTTRingStop
+            if(__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == ring->tail) return NULL;
+            // a producer reserved the cell and is still writing it
+            sched_yield();
+        }
+        ring->handler(ring->item, ring->context);
+        __atomic_store_n(&ring->done, ring->tail, __ATOMIC_RELEASE);
+        // the flushing count is read after the progress is stored, as in MQTTRingPop
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if(__atomic_load_n(&ring->flushing, __ATOMIC_RELAXED) > 0) {
+            pthread_mutex_lock(&ring->lock);
+            pthread_cond_broadcast(&ring->progress);
+            pthread_mutex_unlock(&ring->lock);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief start the consumer
+ * @param[in] ring stopped ring
+ * @param[in] itemSize item size
+ * @param[in] size queued items, rounded up to a power of two
+ * @param[in] handler item handler called in the consumer
+ * @param[in] context handler context
+ * @return 0 if started, -1 otherwise
+ */
+int MQTTRingStart(MQTTRing* ring, size_t itemSize, int size, MQTTRingHandler* handler, void* context) {
+    unsigned long count = 2, i;
+    unsigned char* cells;
+
+    if(ring == NULL || ring->cells != NULL || itemSize == 0 || size <= 0 || handler == NULL) return -1;
+    while(count < (unsigned long)size) count <<= 1;
+
+    ring->itemSize = itemSize;
+    ring->cellSize = sizeof(MQTTRingHeader) + (itemSize + sizeof(MQTTRingHeader) - 1) / sizeof(MQTTRingHeader) * sizeof(MQTTRingHeader);
+    ring->item = malloc(itemSize);
+    cells = (unsigned char *)malloc(ring->cellSize * count);
+    if(ring->item == NULL || cells == NULL) {
+        free(ring->item);
+        free(cells);
+        ring->item = NULL;
+        return -1;
+    }
+    ring->cells = cells;
+    ring->mask = count - 1;
+    for(i = 0; i < count; i++) *MQTTRingSequence(ring, i) = i;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->done = 0;
+    ring->waiting = 0;
+    ring->flushing = 0;
+    ring->rejected = 0;
+    ring->handler = handler;
+    ring->context = context;
+    sem_init(&ring->ready, 0, 0);
+    sem_init(&ring->room, 0, 0);
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->progress, NULL);
+    if(pthread_create(&ring->thread, NULL, MQTTRingRun, ring) != 0) {
+        sem_destroy(&ring->ready);
+        sem_destroy(&ring->room);
+        pthread_mutex_destroy(&ring->lock);
+        pthread_cond_destroy(&ring->progress);
+        free(ring->item);
+        free(ring->cells);
+        ring->item = NULL;
+        __atomic_store_n(&ring->cells, NULL, __ATOMIC_RELEASE);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief stop the consumer after it handles the queued items. no item may be pushed during the stop.
+ * @param[in] ring ring
+ * @return 0 if stopped, -1 if called in the consumer
+ */
+int MQTTRingStop(MQTTRing* ring) {
+    if(ring == NULL || ring->cells == NULL) return 0;
+    if(MQTTRingConsumer(ring)) return -1;
+    sem_post(&ring->ready);
+    pthread_join(ring->thread, NULL);
+    sem_destroy(&ring->ready);
+    sem_destroy(&ring->room);
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->progress);
+    free(ring->item);
+    free(ring->cells);
+    ring->item = NULL;
+    __atomic_store_n(&ring->cells, NULL, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * @brief whether the consumer is running
+ * @param[in] ring ring
+ * @return 1 if running
+ */
+int MQTTRingRunning(MQTTRing* ring) {
+    return __atomic_load_n(&ring->cells, __ATOMIC_ACQUIRE) != NULL;
+}
+
+/**
+ * @brief whether the calling thread is the consumer
+ * @param[in] ring running ring
+ * @return 1 if called in the consumer
+ */
+int MQTTRingConsumer(MQTTRing* ring) {
+    return pthread_equal(pthread_self(), ring->thread);
+}
+
+/**
+ * @brief reserve and publish a cell
+ * @param[in] ring started ring
+ * @param[in] item item, copied
+ * @return 0 if queued, -1 if the ring is full
+ */
+static int MQTTRingTryPush(MQTTRing* ring, const void* item) {
+    unsigned long pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    unsigned long* sequence;
+    long diff;
+
+    for(;;) {
+        sequence = MQTTRingSequence(ring, pos);
+        diff = (long)(__atomic_load_n(sequence, __ATOMIC_ACQUIRE) - pos);
+        if(diff == 0) {
+            if(__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if(diff < 0) {
+            // the consumer has not taken the cell of the previous lap
+            return -1;
+        } else {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+    memcpy((unsigned char *)sequence + sizeof(MQTTRingHeader), item, ring->itemSize);
+    __atomic_store_n(sequence, pos + 1, __ATOMIC_RELEASE);
+    sem_post(&ring->ready);
+    return 0;
+}
+
+/**
+ * @brief queue an item to the consumer
+ * @param[in] ring started ring
+ * @param[in] item item, copied
+ * @return 0 if queued, -1 if the ring is full
+ */
+int MQTTRingPush(MQTTRing* ring, const void* item) {
+    if(MQTTRingTryPush(ring, item) == 0) return 0;
+    __atomic_add_fetch(&ring->rejected, 1, __ATOMIC_RELAXED);
+    return -1;
+}
+
+/**
+ * @brief queue an item to the consumer, waiting while the ring is full
+ * @param[in] ring started ring
+ * @param[in] item item, copied
+ * @return 0 if queued, -1 if the ring is full and called in the consumer
+ */
+int MQTTRingPushWait(MQTTRing* ring, const void* item) {
+    if(MQTTRingTryPush(ring, item) == 0) return 0;
+    // the consumer would wait for itself
+    if(MQTTRingConsumer(ring)) {
+        __atomic_add_fetch(&ring->rejected, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    __atomic_add_fetch(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+    while(MQTTRingTryPush(ring, item) != 0) {
+        while(sem_wait(&ring->room) != 0 && errno == EINTR);
+    }
+    __atomic_sub_fetch(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+    return 0;
+}
+
+/**
+ * @brief wait until the consumer has handled the items queued before the call
+ * @param[in] ring ring
+ * @return 0 if handled or not running, -1 if called in the consumer
+ */
+int MQTTRingFlush(MQTTRing* ring) {
+    unsigned long head;
+    if(ring == NULL || !MQTTRingRunning(ring)) return 0;
+    if(MQTTRingConsumer(ring)) return -1;
+    head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    pthread_mutex_lock(&ring->lock);
+    __atomic_add_fetch(&ring->flushing, 1, __ATOMIC_SEQ_CST);
+    while((long)(__atomic_load_n(&ring->done, __ATOMIC_ACQUIRE) - head) < 0) {
+        pthread_cond_wait(&ring->progress, &ring->lock);
+    }
+    __atomic_sub_fetch(&ring->flushing, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&ring->lock);
+    return 0;
+}
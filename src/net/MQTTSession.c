@@ -0,0 +1,359 @@
+/**
+ * @file MQTTSession.c
+ *
+ * @brief TLS session resumption cache
+ *
+ * paho creates a new SSL context for every MQTTAsync handle, so a session is lost
+ * with the handle at tpSDKDestroy. the sessions(or tickets) of each server are kept here,
+ * in DER form in memory and optionally on disk, and set on the next handshake to the same
+ * server so that it is abbreviated. the SSL_connect calls of paho reach this cache through
+ * MQTTSessionHook.c(link with -Wl,--wrap=SSL_connect).
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "MQTTSession.h"
+#include "MQTTAsync.h"
+#ifdef SPT_DEBUG_ENABLE
+#include "SKTDebug.h"
+#else
+#include "SKTtpDebug.h"
+#endif
+
+/** cached servers **/
+#define MQTT_SESSION_CACHE_SIZE     8
+/** server key length **/
+#define MQTT_SESSION_KEY_LENGTH     128
+/** maximum DER session length **/
+#define MQTT_SESSION_MAX_LENGTH     8192
+
+/** cached session of a server **/
+typedef struct
+{
+    /** server key(SNI host name or peer address, and port) **/
+    char key[MQTT_SESSION_KEY_LENGTH];
+    /** DER session **/
+    unsigned char* data;
+    /** DER length **/
+    int len;
+    /** last use stamp **/
+    unsigned long used;
+} MQTTSessionEntry;
+
+/** process wide cache. the paho SSL contexts are not tied to a tpClient **/
+static struct
+{
+    /** cache enabled **/
+    int enabled;
+    /** session directory(empty : memory only) **/
+    char directory[256];
+    /** sessions **/
+    MQTTSessionEntry entries[MQTT_SESSION_CACHE_SIZE];
+    /** use clock **/
+    unsigned long clock;
+    /** handshake statistics **/
+    tpTLSSessionStats stats;
+} mSessionCache;
+
+static pthread_mutex_t mSessionLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief make the server key of a connection. the key is also the session file name.
+ * @param[in] ssl connection
+ * @param[out] key server key
+ * @param[in] size key buffer size
+ * @return 1 if made, 0 if the peer is unknown
+ */
+static int MQTTSessionKey(SSL* ssl, char* key, size_t size) {
+    struct sockaddr_storage address;
+    socklen_t addressLen = sizeof(address);
+    char host[INET6_ADDRSTRLEN] = "";
+    const char* serverName = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    int port = 0;
+    char* p;
+
+    if(getpeername(SSL_get_fd(ssl), (struct sockaddr *)&address, &addressLen) != 0) return 0;
+    if(address.ss_family == AF_INET) {
+        struct sockaddr_in* in = (struct sockaddr_in *)&address;
+        inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+        port = ntohs(in->sin_port);
+    } else if(address.ss_family == AF_INET6) {
+        struct sockaddr_in6* in6 = (struct sockaddr_in6 *)&address;
+        inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+        port = ntohs(in6->sin6_port);
+    } else {
+        return 0;
+    }
+    // a server cluster behind one name shares the ticket keys, prefer the name to the address
+    snprintf(key, size, "%s_%d", serverName && serverName[0] ? serverName : host, port);
+    for(p = key; *p; p++) {
+        if(!(*p >= 'a' && *p <= 'z') && !(*p >= 'A' && *p <= 'Z') && !(*p >= '0' && *p <= '9') && *p != '.' && *p != '-') *p = '_';
+    }
+    return 1;
+}
+
+/**
+ * @brief find the entry of a server key. call with the lock.
+ * @param[in] key server key
+ * @return entry, NULL if not cached
+ */
+static MQTTSessionEntry* MQTTSessionFind(const char* key) {
+    int i;
+    for(i = 0; i < MQTT_SESSION_CACHE_SIZE; i++) {
+        if(mSessionCache.entries[i].data && strcmp(mSessionCache.entries[i].key, key) == 0) {
+            mSessionCache.entries[i].used = ++mSessionCache.clock;
+            return &mSessionCache.entries[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief keep a DER session in memory. call with the lock.
+ * @param[in] key server key
+ * @param[in] data DER session, owned by the cache from now
+ * @param[in] len DER length
+ */
+static void MQTTSessionKeep(const char* key, unsigned char* data, int len) {
+    MQTTSessionEntry* entry = MQTTSessionFind(key);
+    int i;
+    if(entry == NULL) {
+        // least recently used server
+        entry = &mSessionCache.entries[0];
+        for(i = 1; i < MQTT_SESSION_CACHE_SIZE; i++) {
+            if(mSessionCache.entries[i].used < entry->used) entry = &mSessionCache.entries[i];
+        }
+        snprintf(entry->key, sizeof(entry->key), "%s", key);
+    }
+    free(entry->data);
+    entry->data = data;
+    entry->len = len;
+    entry->used = ++mSessionCache.clock;
+}
+
+/**
+ * @brief drop the session of a server from memory and disk. call with the lock.
+ * @param[in] key server key
+ */
+static void MQTTSessionDrop(const char* key) {
+    MQTTSessionEntry* entry = MQTTSessionFind(key);
+    char path[400];
+    if(entry) {
+        free(entry->data);
+        memset(entry, 0, sizeof(MQTTSessionEntry));
+    }
+    if(mSessionCache.directory[0]) {
+        snprintf(path, sizeof(path), "%s/%s.tls", mSessionCache.directory, key);
+        unlink(path);
+    }
+}
+
+/**
+ * @brief load the session of a server from disk. call with the lock.
+ * @param[in] key server key
+ * @return entry, NULL if not stored
+ */
+static MQTTSessionEntry* MQTTSessionLoad(const char* key) {
+    char path[400];
+    unsigned char* data;
+    FILE* file;
+    int len;
+
+    if(mSessionCache.directory[0] == '\0') return NULL;
+    snprintf(path, sizeof(path), "%s/%s.tls", mSessionCache.directory, key);
+    file = fopen(path, "rb");
+    if(file == NULL) return NULL;
+    data = (unsigned char *)malloc(MQTT_SESSION_MAX_LENGTH);
+    len = data ? (int)fread(data, 1, MQTT_SESSION_MAX_LENGTH, file) : 0;
+    fclose(file);
+    if(len <= 0) {
+        free(data);
+        return NULL;
+    }
+    MQTTSessionKeep(key, data, len);
+    return MQTTSessionFind(key);
+}
+
+/**
+ * @brief write the session of a server to disk. call with the lock.
+ * @param[in] key server key
+ * @param[in] data DER session
+ * @param[in] len DER length
+ */
+static void MQTTSessionStore(const char* key, const unsigned char* data, int len) {
+    char path[400], temp[408];
+    FILE* file;
+    int written;
+
+    if(mSessionCache.directory[0] == '\0') return;
+    snprintf(path, sizeof(path), "%s/%s.tls", mSessionCache.directory, key);
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    file = fopen(temp, "wb");
+    if(file == NULL) return;
+    written = (int)fwrite(data, 1, len, file);
+    if(fclose(file) != 0 || written != len || rename(temp, path) != 0) {
+        unlink(temp);
+    }
+}
+
+/**
+ * @brief new session callback of the SSL context. called after a full handshake
+ * and for every ticket sent by the server(TLS 1.3 sends them after the handshake).
+ * @param[in] ssl connection
+ * @param[in] session new session
+ * @return 0, the session reference is not kept
+ */
+static int MQTTSessionNew(SSL* ssl, SSL_SESSION* session) {
+    char key[MQTT_SESSION_KEY_LENGTH];
+    MQTTSessionEntry* entry;
+    unsigned char* data;
+    unsigned char* p;
+    int len;
+
+    if(!MQTTSessionKey(ssl, key, sizeof(key))) return 0;
+    len = i2d_SSL_SESSION(session, NULL);
+    if(len <= 0 || len > MQTT_SESSION_MAX_LENGTH) return 0;
+    data = (unsigned char *)malloc(len);
+    if(data == NULL) return 0;
+    p = data;
+    i2d_SSL_SESSION(session, &p);
+
+    pthread_mutex_lock(&mSessionLock);
+    if(!mSessionCache.enabled) {
+        free(data);
+    } else {
+        entry = MQTTSessionFind(key);
+        // a resumed TLS 1.2 session is the same one, skip the disk write
+        if(entry && entry->len == len && memcmp(entry->data, data, len) == 0) {
+            free(data);
+        } else {
+            MQTTSessionStore(key, data, len);
+            MQTTSessionKeep(key, data, len);
+        }
+    }
+    pthread_mutex_unlock(&mSessionLock);
+    return 0;
+}
+
+/**
+ * @brief enable or disable the TLS session cache
+ * @param[in] enable 1 : keep sessions for resumption, 0 : forget the sessions in memory
+ * @param[in] directory session directory(NULL : memory only)
+ * @return MQTTASYNC_SUCCESS, MQTTASYNC_FAILURE if the directory is too long
+ */
+int MQTTSessionSetCache(int enable, char* directory) {
+    int i;
+    if(enable && directory && strlen(directory) >= sizeof(mSessionCache.directory)) {
+        return MQTTASYNC_FAILURE;
+    }
+    pthread_mutex_lock(&mSessionLock);
+    for(i = 0; i < MQTT_SESSION_CACHE_SIZE; i++) {
+        free(mSessionCache.entries[i].data);
+    }
+    memset(mSessionCache.entries, 0, sizeof(mSessionCache.entries));
+    mSessionCache.enabled = enable;
+    memset(mSessionCache.directory, 0, sizeof(mSessionCache.directory));
+    if(enable && directory) {
+        snprintf(mSessionCache.directory, sizeof(mSessionCache.directory), "%s", directory);
+        if(mkdir(directory, 0755) != 0 && errno != EEXIST) {
+            // keep the sessions in memory only
+            mSessionCache.directory[0] = '\0';
+        }
+    }
+    pthread_mutex_unlock(&mSessionLock);
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief get handshake statistics
+ * @param[out] stats resumed and full handshake counts
+ * @return MQTTASYNC_SUCCESS, MQTTASYNC_FAILURE if stats is NULL
+ */
+int MQTTSessionGetStats(tpTLSSessionStats* stats) {
+    if(stats == NULL) return MQTTASYNC_FAILURE;
+    pthread_mutex_lock(&mSessionLock);
+    *stats = mSessionCache.stats;
+    pthread_mutex_unlock(&mSessionLock);
+    return MQTTASYNC_SUCCESS;
+}
+
+/**
+ * @brief set the cached session of the server before a handshake starts
+ * @param[in] ssl connection
+ */
+void MQTTSessionPrepare(SSL* ssl) {
+    char key[MQTT_SESSION_KEY_LENGTH];
+    MQTTSessionEntry* entry;
+    SSL_SESSION* session = NULL;
+    const unsigned char* p;
+    SSL_CTX* context = SSL_get_SSL_CTX(ssl);
+
+    // the handshake is in progress(non-blocking connect) or a session is set already
+    if(SSL_get_session(ssl) != NULL) return;
+    pthread_mutex_lock(&mSessionLock);
+    if(!mSessionCache.enabled || !MQTTSessionKey(ssl, key, sizeof(key))) {
+        pthread_mutex_unlock(&mSessionLock);
+        return;
+    }
+    // the context is created by paho per handle, collect its new sessions
+    SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(context, MQTTSessionNew);
+
+    entry = MQTTSessionFind(key);
+    if(entry == NULL) entry = MQTTSessionLoad(key);
+    if(entry) {
+        p = entry->data;
+        session = d2i_SSL_SESSION(NULL, &p, entry->len);
+        if(session == NULL || (long)SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session) < (long)time(NULL)) {
+            MQTTSessionDrop(key);
+        } else {
+            SSL_set_session(ssl, session);
+        }
+    }
+    pthread_mutex_unlock(&mSessionLock);
+    if(session) SSL_SESSION_free(session);
+}
+
+/**
+ * @brief count a finished handshake. a failed resumption drops the session of the server.
+ * @param[in] ssl connection
+ * @param[in] rc SSL_connect result
+ */
+void MQTTSessionComplete(SSL* ssl, int rc) {
+    char key[MQTT_SESSION_KEY_LENGTH];
+    int error;
+
+    if(rc == 1) {
+        pthread_mutex_lock(&mSessionLock);
+        if(SSL_session_reused(ssl)) mSessionCache.stats.resumed++;
+        else mSessionCache.stats.full++;
+        pthread_mutex_unlock(&mSessionLock);
+#ifdef SPT_DEBUG_ENABLE
+        SKTtpDebugLog(LOG_LEVEL_INFO, "TLS handshake : %s", SSL_session_reused(ssl) ? "resumed" : "full");
+#else
+        SKTDebugPrint(LOG_LEVEL_INFO, "TLS handshake : %s", SSL_session_reused(ssl) ? "resumed" : "full");
+#endif
+        return;
+    }
+    error = SSL_get_error(ssl, rc);
+    if(error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) return;
+    pthread_mutex_lock(&mSessionLock);
+    mSessionCache.stats.failed++;
+    if(mSessionCache.enabled && MQTTSessionKey(ssl, key, sizeof(key))) {
+        MQTTSessionDrop(key);
+    }
+    pthread_mutex_unlock(&mSessionLock);
+}
@@ -0,0 +1,40 @@
+/**
+ * @file MQTTSessionHook.c
+ *
+ * @brief SSL_connect hook of the TLS session cache
+ *
+ * linked only when the application is linked with -Wl,--wrap=SSL_connect,
+ * which routes every SSL_connect call of the program here. handshakes are touched only
+ * while a session is connecting to the server named in the SNI(MQTTTimingWatch).
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <errno.h>
+
+#include "MQTTSession.h"
+#include "MQTTTiming.h"
+
+int __real_SSL_connect(SSL* ssl);
+
+/**
+ * @brief SSL_connect with session resumption and handshake timing
+ * @param[in] ssl connection
+ * @return SSL_connect result
+ */
+int __wrap_SSL_connect(SSL* ssl) {
+    int rc, error;
+    const char* serverName = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    // connections of the application
+    if(!MQTTTimingWatched(serverName)) return __real_SSL_connect(ssl);
+    MQTTSessionPrepare(ssl);
+    MQTTTimingHandshake(SSL_get_fd(ssl), 0, 0);
+    rc = __real_SSL_connect(ssl);
+    // paho reads errno of SSL_ERROR_SYSCALL
+    error = errno;
+    MQTTSessionComplete(ssl, rc);
+    if(rc == 1) MQTTTimingHandshake(SSL_get_fd(ssl), 1, (int)SSL_session_reused(ssl));
+    errno = error;
+    return rc;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file MQTTSubmit.c
+ *
+ * @brief publish submission queue
+ *
+ * producer threads copy a publish into a bounded ring(MQTTRing.c) and return, and one dispatcher thread
+ * per session runs the send path(offline queue, pending queue, paho) in submission order,
+ * so concurrent publishes never take a session lock on the producer side.
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#include "MQTTSubmit.h"
+
+/** in-flight slot wait limit(msec), a slot freed without a completion callback is found by a retry **/
+#define MQTT_SUBMIT_SLOT_TIMEOUT    100
+
+/**
+ * @brief handle a submission in the dispatcher thread(MQTTRingHandler)
+ * @param[in] item submission
+ * @param[in] context queue
+ */
+static void MQTTSubmitRun(void* item, void* context) {
+    MQTTSubmitQueue* queue = (MQTTSubmitQueue *)context;
+    queue->handler((MQTTSubmission *)item);
+}
+
+/**
+ * @brief start the dispatcher
+ * @param[in] queue stopped queue
+ * @param[in] queueSize queued publishes(0 : MQTT_SUBMIT_QUEUE_SIZE), rounded up to a power of two
+ * @param[in] handler submission handler called in the dispatcher. it frees the submission.
+ * @return 0 if started, -1 otherwise
+ */
+int MQTTSubmitStart(MQTTSubmitQueue* queue, int queueSize, MQTTSubmitHandler* handler) {
+    if(queue == NULL || MQTTRingRunning(&queue->ring) || queueSize < 0 || handler == NULL) return -1;
+    if(queueSize == 0) queueSize = MQTT_SUBMIT_QUEUE_SIZE;
+
+    queue->handler = handler;
+    queue->stopping = 0;
+    queue->slots = 0;
+    pthread_mutex_init(&queue->slotLock, NULL);
+    pthread_cond_init(&queue->slotCond, NULL);
+    if(MQTTRingStart(&queue->ring, sizeof(MQTTSubmission), queueSize, MQTTSubmitRun, queue) != 0) {
+        pthread_mutex_destroy(&queue->slotLock);
+        pthread_cond_destroy(&queue->slotCond);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief stop the dispatcher after it handles the queued submissions. no publish may be submitted during the stop.
+ * @param[in] queue queue
+ * @return 0 if stopped, -1 if called in the dispatcher
+ */
+int MQTTSubmitStop(MQTTSubmitQueue* queue) {
+    if(queue == NULL || !MQTTRingRunning(&queue->ring)) return 0;
+    if(MQTTRingConsumer(&queue->ring)) return -1;
+    // a dispatcher waiting for an in-flight slot gives up
+    pthread_mutex_lock(&queue->slotLock);
+    __atomic_store_n(&queue->stopping, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&queue->slotCond);
+    pthread_mutex_unlock(&queue->slotLock);
+    MQTTRingStop(&queue->ring);
+    pthread_mutex_destroy(&queue->slotLock);
+    pthread_cond_destroy(&queue->slotCond);
+    return 0;
+}
+
+/**
+ * @brief whether publishes are submitted to the dispatcher
+ * @param[in] queue queue
+ * @return 1 if the dispatcher is running
+ */
+int MQTTSubmitRunning(MQTTSubmitQueue* queue) {
+    return MQTTRingRunning(&queue->ring);
+}
+
+/**
+ * @brief whether the dispatcher is stopping, so a handler does not wait for in-flight slots
+ * @param[in] queue queue
+ * @return 1 if stopping
+ */
+int MQTTSubmitStopping(MQTTSubmitQueue* queue) {
+    return __atomic_load_n(&queue->stopping, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief queue a publish to the dispatcher
+ * @param[in] queue started queue
+ * @param[in] submission submission, copied. its allocation is owned by the queue when queued.
+ * @return 0 if queued, -1 if the ring is full
+ */
+int MQTTSubmitPush(MQTTSubmitQueue* queue, const MQTTSubmission* submission) {
+    return MQTTRingPush(&queue->ring, submission);
+}
+
+/**
+ * @brief wait until the dispatcher has handled the publishes submitted before the call
+ * @param[in] queue queue
+ * @return 0 if handled or not running, -1 if called in the dispatcher
+ */
+int MQTTSubmitFlush(MQTTSubmitQueue* queue) {
+    if(queue == NULL) return 0;
+    return MQTTRingFlush(&queue->ring);
+}
+
+/**
+ * @brief freed in-flight slot count, taken before a publish which may be refused
+ * @param[in] queue running queue
+ * @return slot count for MQTTSubmitSlotWait
+ */
+unsigned long MQTTSubmitSlots(MQTTSubmitQueue* queue) {
+    return __atomic_load_n(&queue->slots, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief wait in the dispatcher until an in-flight slot is freed after MQTTSubmitSlots, the stop or the time limit
+ * @param[in] queue running queue
+ * @param[in] slots MQTTSubmitSlots before the refused publish
+ */
+void MQTTSubmitSlotWait(MQTTSubmitQueue* queue, unsigned long slots) {
+    struct timespec at;
+
+    clock_gettime(CLOCK_REALTIME, &at);
+    at.tv_sec += MQTT_SUBMIT_SLOT_TIMEOUT / 1000;
+    at.tv_nsec += (MQTT_SUBMIT_SLOT_TIMEOUT % 1000) * 1000000L;
+    if(at.tv_nsec >= 1000000000L) {
+        at.tv_sec++;
+        at.tv_nsec -= 1000000000L;
+    }
+    pthread_mutex_lock(&queue->slotLock);
+    while(queue->slots == slots && !queue->stopping) {
+        if(pthread_cond_timedwait(&queue->slotCond, &queue->slotLock, &at) == ETIMEDOUT) break;
+    }
+    pthread_mutex_unlock(&queue->slotLock);
+}
+
+/**
+ * @brief wake the dispatcher waiting for an in-flight slot. called when a publish completes.
+ * @param[in] queue queue
+ */
+void MQTTSubmitSlotFreed(MQTTSubmitQueue* queue) {
+    if(!MQTTSubmitRunning(queue)) return;
+    pthread_mutex_lock(&queue->slotLock);
+    __atomic_add_fetch(&queue->slots, 1, __ATOMIC_RELEASE);
+    pthread_cond_signal(&queue->slotCond);
+    pthread_mutex_unlock(&queue->slotLock);
+}
@@ -0,0 +1,216 @@
+/**
+ * @file MQTTTiming.c
+ *
+ * @brief connection establishment timing
+ *
+ * paho resolves, connects and runs the TLS handshake in its own threads without reporting them.
+ * the socket phases are recorded per socket through MQTTTimingHook.c and MQTTSessionHook.c
+ * (link with -Wl,--wrap=getaddrinfo,--wrap=connect,--wrap=SSL_connect), and a session claims
+ * the record of its server when the CONNACK arrives.
+ * the wraps see every call of the program, only the servers of sessions waiting for a CONNACK
+ * are recorded(MQTTTimingWatch), other calls pass through after an atomic load.
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <netinet/in.h>
+
+#include "MQTTTiming.h"
+
+/** recent connections kept for claiming **/
+#define MQTT_TIMING_RECORD_SIZE     16
+/** servers watched at once **/
+#define MQTT_TIMING_WATCH_SIZE      16
+
+/** name resolved last in this thread. paho connects right after resolving in the same thread **/
+static __thread struct
+{
+    char host[128];
+    unsigned long dns;
+    int valid;
+} mLastResolve;
+
+static MQTTConnectRecord mRecords[MQTT_TIMING_RECORD_SIZE];
+static int mRecordNext;
+static pthread_mutex_t mTimingLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** servers of the sessions waiting for a CONNACK **/
+static struct
+{
+    char host[128];
+    int count;
+} mWatches[MQTT_TIMING_WATCH_SIZE];
+/** watched servers, read without the lock by the hooks **/
+static int mWatching;
+
+/**
+ * @brief monotonic time
+ * @return usec
+ */
+unsigned long long MQTTTimingNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+/**
+ * @brief find a watched server. call with the timing lock.
+ * @param[in] host host name
+ * @return index, -1 if not watched
+ */
+static int MQTTTimingFind(const char* host) {
+    int i;
+    for(i = 0; i < MQTT_TIMING_WATCH_SIZE; i++) {
+        if(mWatches[i].count > 0 && strcmp(mWatches[i].host, host) == 0) return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief start or stop recording the connections to a server.
+ * a session watches its server from the connect request to the CONNACK or the failure.
+ * @param[in] host host name
+ * @param[in] watch 1 : start, 0 : stop
+ */
+void MQTTTimingWatch(const char* host, int watch) {
+    int i;
+
+    if(host == NULL || host[0] == '\0') return;
+    pthread_mutex_lock(&mTimingLock);
+    i = MQTTTimingFind(host);
+    if(watch) {
+        if(i < 0) {
+            for(i = 0; i < MQTT_TIMING_WATCH_SIZE && mWatches[i].count > 0; i++);
+            if(i < MQTT_TIMING_WATCH_SIZE) {
+                snprintf(mWatches[i].host, sizeof(mWatches[i].host), "%s", host);
+                __atomic_add_fetch(&mWatching, 1, __ATOMIC_RELEASE);
+            }
+        }
+        // more servers than slots are not timed
+        if(i < MQTT_TIMING_WATCH_SIZE) mWatches[i].count++;
+    } else if(i >= 0 && --mWatches[i].count == 0) {
+        __atomic_sub_fetch(&mWatching, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&mTimingLock);
+}
+
+/**
+ * @brief check a server is watched
+ * @param[in] host host name(NULL : any server)
+ * @return 1 if a session is connecting to the server
+ */
+int MQTTTimingWatched(const char* host) {
+    int watched;
+
+    if(__atomic_load_n(&mWatching, __ATOMIC_ACQUIRE) == 0) return 0;
+    if(host == NULL) return 1;
+    pthread_mutex_lock(&mTimingLock);
+    watched = MQTTTimingFind(host) >= 0;
+    pthread_mutex_unlock(&mTimingLock);
+    return watched;
+}
+
+/**
+ * @brief record a name resolution of this thread when the host is watched
+ * @param[in] host host name
+ * @param[in] dns resolution time(usec)
+ */
+void MQTTTimingResolved(const char* host, unsigned long dns) {
+    mLastResolve.valid = 0;
+    if(host == NULL || !MQTTTimingWatched(host)) return;
+    snprintf(mLastResolve.host, sizeof(mLastResolve.host), "%s", host);
+    mLastResolve.dns = dns;
+    mLastResolve.valid = 1;
+}
+
+/**
+ * @brief record a TCP connect. the connection takes the watched name resolved last in this thread.
+ * @param[in] fd socket
+ * @param[in] address peer address
+ * @param[in] start connect() call time
+ */
+void MQTTTimingConnect(int fd, const struct sockaddr* address, unsigned long long start) {
+    MQTTConnectRecord* record;
+    int port;
+
+    if(address == NULL || !mLastResolve.valid) return;
+    if(address->sa_family == AF_INET) port = ntohs(((const struct sockaddr_in *)address)->sin_port);
+    else if(address->sa_family == AF_INET6) port = ntohs(((const struct sockaddr_in6 *)address)->sin6_port);
+    else return;
+
+    pthread_mutex_lock(&mTimingLock);
+    record = &mRecords[mRecordNext];
+    mRecordNext = (mRecordNext + 1) % MQTT_TIMING_RECORD_SIZE;
+    memset(record, 0, sizeof(MQTTConnectRecord));
+    snprintf(record->host, sizeof(record->host), "%s", mLastResolve.host);
+    record->port = port;
+    record->fd = fd;
+    record->dns = mLastResolve.dns;
+    record->connectAt = start;
+    pthread_mutex_unlock(&mTimingLock);
+    mLastResolve.valid = 0;
+}
+
+/**
+ * @brief record the TLS handshake of a socket
+ * @param[in] fd socket
+ * @param[in] done 0 : SSL_connect is called, 1 : handshake finished
+ * @param[in] resumed TLS session was resumed(done only)
+ */
+void MQTTTimingHandshake(int fd, int done, int resumed) {
+    MQTTConnectRecord* record = NULL;
+    unsigned long long now = MQTTTimingNow();
+    int i, index;
+
+    if(__atomic_load_n(&mWatching, __ATOMIC_ACQUIRE) == 0) return;
+    pthread_mutex_lock(&mTimingLock);
+    // the latest connection of the socket
+    for(i = 1; i <= MQTT_TIMING_RECORD_SIZE; i++) {
+        index = (mRecordNext - i + MQTT_TIMING_RECORD_SIZE) % MQTT_TIMING_RECORD_SIZE;
+        if(mRecords[index].connectAt && mRecords[index].fd == fd) {
+            record = &mRecords[index];
+            break;
+        }
+    }
+    if(record && !record->claimed) {
+        if(!done && record->tlsStart == 0) {
+            record->tlsStart = now;
+        } else if(done && record->tlsEnd == 0) {
+            record->tlsEnd = now;
+            record->resumed = resumed;
+        }
+    }
+    pthread_mutex_unlock(&mTimingLock);
+}
+
+/**
+ * @brief take the oldest unclaimed connection to a server made after a time
+ * @param[in] host host name
+ * @param[in] port port(0 : any)
+ * @param[in] since connect request time
+ * @param[out] record connection phases
+ * @return 1 if found
+ */
+int MQTTTimingClaim(const char* host, int port, unsigned long long since, MQTTConnectRecord* record) {
+    MQTTConnectRecord* found = NULL;
+    int i;
+
+    pthread_mutex_lock(&mTimingLock);
+    for(i = 0; i < MQTT_TIMING_RECORD_SIZE; i++) {
+        MQTTConnectRecord* r = &mRecords[i];
+        if(r->connectAt == 0 || r->claimed || r->connectAt < since) continue;
+        if(strcmp(r->host, host) != 0 || (port > 0 && r->port != port)) continue;
+        if(found == NULL || r->connectAt < found->connectAt) found = r;
+    }
+    if(found) {
+        found->claimed = 1;
+        *record = *found;
+    }
+    pthread_mutex_unlock(&mTimingLock);
+    return found != NULL;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file MQTTTimingHook.c
+ *
+ * @brief getaddrinfo and connect hooks of the connection timing
+ *
+ * linked only when the application is linked with -Wl,--wrap=getaddrinfo,--wrap=connect,
+ * which routes every call of the program here. only the servers of connecting sessions are recorded.
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <errno.h>
+#include <netdb.h>
+
+#include "MQTTTiming.h"
+
+int __real_getaddrinfo(const char* node, const char* service, const struct addrinfo* hints, struct addrinfo** res);
+
+int __real_connect(int fd, const struct sockaddr* address, socklen_t len);
+
+/**
+ * @brief getaddrinfo with resolution time
+ */
+int __wrap_getaddrinfo(const char* node, const char* service, const struct addrinfo* hints, struct addrinfo** res) {
+    unsigned long long start = MQTTTimingNow();
+    int rc = __real_getaddrinfo(node, service, hints, res);
+    if(rc == 0) MQTTTimingResolved(node, (unsigned long)(MQTTTimingNow() - start));
+    return rc;
+}
+
+/**
+ * @brief connect with connect time
+ */
+int __wrap_connect(int fd, const struct sockaddr* address, socklen_t len) {
+    unsigned long long start = MQTTTimingNow();
+    int rc = __real_connect(fd, address, len);
+    // paho checks EINPROGRESS of the non-blocking connect
+    int error = errno;
+    MQTTTimingConnect(fd, address, start);
+    errno = error;
+    return rc;
+}
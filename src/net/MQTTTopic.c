@@ -0,0 +1,373 @@
+/**
+ * @file MQTTTopic.c
+ *
+ * @brief MQTT subscription table(topic filter trie)
+ *
+ * Copyright (C) 2017. SK Telecom, All Rights Reserved.
+ * Written 2017, by SK Telecom
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MQTTTopic.h"
+
+/** maximum topic filter length **/
+#define MQTT_TOPIC_MAX_LENGTH       65535
+
+/**
+ * @brief compare a node level with a topic level
+ * @param[in] level node level
+ * @param[in] topic topic level(not terminated)
+ * @param[in] len topic level length
+ * @return <0, 0, >0 like strcmp
+ */
+static int MQTTTopicCompare(const char* level, const char* topic, size_t len) {
+    int rc = strncmp(level, topic, len);
+    if(rc == 0 && level[len] != '\0') rc = 1;
+    return rc;
+}
+
+/**
+ * @brief find the child of a plain level
+ * @param[in] node parent node
+ * @param[in] topic topic level(not terminated)
+ * @param[in] len topic level length
+ * @param[out] position insert position when not found(may be NULL)
+ * @return child node, NULL if not found
+ */
+static MQTTTopicNode* MQTTTopicFindChild(MQTTTopicNode* node, const char* topic, size_t len, int* position) {
+    int low = 0, high = node->childCount - 1, middle, rc;
+    while(low <= high) {
+        middle = (low + high) / 2;
+        rc = MQTTTopicCompare(node->children[middle]->level, topic, len);
+        if(rc == 0) return node->children[middle];
+        if(rc < 0) low = middle + 1;
+        else high = middle - 1;
+    }
+    if(position) *position = low;
+    return NULL;
+}
+
+/**
+ * @brief allocate a node
+ * @param[in] topic topic level(not terminated)
+ * @param[in] len topic level length
+ * @return node, NULL if allocation failed
+ */
+static MQTTTopicNode* MQTTTopicNodeNew(const char* topic, size_t len) {
+    MQTTTopicNode* node = (MQTTTopicNode *)calloc(1, sizeof(MQTTTopicNode) + len + 1);
+    if(node == NULL) return NULL;
+    node->level = (char *)(node + 1);
+    memcpy(node->level, topic, len);
+    return node;
+}
+
+/**
+ * @brief get or create the child of a level
+ * @param[in] node parent node
+ * @param[in] topic topic level(not terminated)
+ * @param[in] len topic level length
+ * @return child node, NULL if allocation failed
+ */
+static MQTTTopicNode* MQTTTopicChild(MQTTTopicNode* node, const char* topic, size_t len) {
+    MQTTTopicNode** slot = NULL;
+    MQTTTopicNode** children;
+    MQTTTopicNode* child;
+    int position = 0, capacity;
+
+    if(len == 1 && topic[0] == '+') slot = &node->plus;
+    else if(len == 1 && topic[0] == '#') slot = &node->hash;
+    if(slot) {
+        if(*slot == NULL) *slot = MQTTTopicNodeNew(topic, len);
+        return *slot;
+    }
+
+    child = MQTTTopicFindChild(node, topic, len, &position);
+    if(child) return child;
+    if(node->childCount == node->childCapacity) {
+        capacity = node->childCapacity ? node->childCapacity * 2 : 4;
+        children = (MQTTTopicNode **)realloc(node->children, sizeof(MQTTTopicNode *) * capacity);
+        if(children == NULL) return NULL;
+        node->children = children;
+        node->childCapacity = capacity;
+    }
+    child = MQTTTopicNodeNew(topic, len);
+    if(child == NULL) return NULL;
+    memmove(node->children + position + 1, node->children + position, sizeof(MQTTTopicNode *) * (node->childCount - position));
+    node->children[position] = child;
+    node->childCount++;
+    return child;
+}
+
+/**
+ * @brief free a subscription
+ * @param[in] subscription subscription
+ */
+static void MQTTSubscriptionFree(MQTTSubscription* subscription) {
+    free(subscription);
+}
+
+/**
+ * @brief free the children and the subscription of a node
+ * @param[in] node node
+ */
+static void MQTTTopicNodeClear(MQTTTopicNode* node) {
+    int i;
+    for(i = 0; i < node->childCount; i++) {
+        MQTTTopicNodeClear(node->children[i]);
+        free(node->children[i]);
+    }
+    free(node->children);
+    node->children = NULL;
+    node->childCount = node->childCapacity = 0;
+    if(node->plus) {
+        MQTTTopicNodeClear(node->plus);
+        free(node->plus);
+        node->plus = NULL;
+    }
+    if(node->hash) {
+        MQTTTopicNodeClear(node->hash);
+        free(node->hash);
+        node->hash = NULL;
+    }
+    if(node->subscription) {
+        MQTTSubscriptionFree(node->subscription);
+        node->subscription = NULL;
+    }
+}
+
+/**
+ * @brief check a topic filter. '+' must fill a level, '#' must be the last level.
+ * @param[in] filter topic filter
+ * @return 1 if valid
+ */
+int MQTTTopicValidFilter(const char* filter) {
+    const char* p;
+    size_t len;
+    if(filter == NULL || filter[0] == '\0') return 0;
+    len = strlen(filter);
+    if(len > MQTT_TOPIC_MAX_LENGTH) return 0;
+    for(p = filter; *p; p++) {
+        if(*p == '+' || *p == '#') {
+            if(p != filter && p[-1] != '/') return 0;
+            if(p[1] != '\0' && p[1] != '/') return 0;
+            if(*p == '#' && p[1] != '\0') return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief get or add the subscription of a topic filter
+ * @param[in] tree subscription table
+ * @param[in] filter valid topic filter(see MQTTTopicValidFilter)
+ * @return subscription, NULL if allocation failed
+ */
+MQTTSubscription* MQTTTopicAdd(MQTTTopicTree* tree, const char* filter) {
+    MQTTTopicNode* node = &tree->root;
+    const char* level = filter;
+    const char* end;
+    size_t filterLen = strlen(filter);
+
+    while(1) {
+        end = strchr(level, '/');
+        node = MQTTTopicChild(node, level, end ? (size_t)(end - level) : strlen(level));
+        if(node == NULL) return NULL;
+        if(end == NULL) break;
+        level = end + 1;
+    }
+    if(node->subscription == NULL) {
+        node->subscription = (MQTTSubscription *)calloc(1, sizeof(MQTTSubscription) + filterLen + 1);
+        if(node->subscription == NULL) return NULL;
+        node->subscription->filter = (char *)(node->subscription + 1);
+        memcpy(node->subscription->filter, filter, filterLen + 1);
+        tree->count++;
+    }
+    return node->subscription;
+}
+
+/**
+ * @brief get the subscription of a topic filter
+ * @param[in] tree subscription table
+ * @param[in] filter topic filter
+ * @return subscription, NULL if not subscribed
+ */
+MQTTSubscription* MQTTTopicGet(MQTTTopicTree* tree, const char* filter) {
+    MQTTTopicNode* node = &tree->root;
+    const char* level = filter;
+    const char* end;
+    size_t len;
+
+    if(filter == NULL || filter[0] == '\0') return NULL;
+    while(node) {
+        end = strchr(level, '/');
+        len = end ? (size_t)(end - level) : strlen(level);
+        if(len == 1 && level[0] == '+') node = node->plus;
+        else if(len == 1 && level[0] == '#') node = node->hash;
+        else node = MQTTTopicFindChild(node, level, len, NULL);
+        if(end == NULL) break;
+        level = end + 1;
+    }
+    return node ? node->subscription : NULL;
+}
+
+/**
+ * @brief remove the subscription below a node and prune empty nodes
+ * @param[in] tree subscription table
+ * @param[in] node node of the previous level
+ * @param[in] level current filter level
+ * @return 1 if removed
+ */
+static int MQTTTopicRemoveLevel(MQTTTopicTree* tree, MQTTTopicNode* node, const char* level) {
+    const char* end = strchr(level, '/');
+    size_t len = end ? (size_t)(end - level) : strlen(level);
+    MQTTTopicNode** slot = NULL;
+    MQTTTopicNode* child;
+    int position, removed;
+
+    if(len == 1 && level[0] == '+') slot = &node->plus;
+    else if(len == 1 && level[0] == '#') slot = &node->hash;
+    if(slot) {
+        child = *slot;
+    } else {
+        child = MQTTTopicFindChild(node, level, len, NULL);
+    }
+    if(child == NULL) return 0;
+
+    if(end) {
+        removed = MQTTTopicRemoveLevel(tree, child, end + 1);
+    } else {
+        removed = child->subscription != NULL;
+        if(removed) {
+            MQTTSubscriptionFree(child->subscription);
+            child->subscription = NULL;
+            tree->count--;
+        }
+    }
+    if(removed && child->subscription == NULL && child->childCount == 0 && child->plus == NULL && child->hash == NULL) {
+        if(slot) {
+            *slot = NULL;
+        } else {
+            // position of the child itself
+            for(position = 0; node->children[position] != child; position++);
+            memmove(node->children + position, node->children + position + 1,
+                sizeof(MQTTTopicNode *) * (node->childCount - position - 1));
+            node->childCount--;
+        }
+        free(child->children);
+        free(child);
+    }
+    return removed;
+}
+
+/**
+ * @brief remove the subscription of a topic filter
+ * @param[in] tree subscription table
+ * @param[in] filter topic filter
+ * @return 1 if removed, 0 if not subscribed
+ */
+int MQTTTopicRemove(MQTTTopicTree* tree, const char* filter) {
+    if(filter == NULL || filter[0] == '\0') return 0;
+    return MQTTTopicRemoveLevel(tree, &tree->root, filter);
+}
+
+/**
+ * @brief visit the subscriptions which end at a node, including its '#' child
+ * @param[in] node matched node
+ * @param[in] visitor visitor
+ * @param[in] arg visitor argument
+ * @return visited count
+ */
+static int MQTTTopicVisitEnd(MQTTTopicNode* node, MQTTTopicVisitor* visitor, void* arg) {
+    int count = 0;
+    if(node->subscription) {
+        visitor(node->subscription, arg);
+        count++;
+    }
+    // "a/#" matches "a" too
+    if(node->hash && node->hash->subscription) {
+        visitor(node->hash->subscription, arg);
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief visit the subscriptions matching the rest of a topic
+ * @param[in] node node of the previous level
+ * @param[in] topic current topic level
+ * @param[in] root the node is the root(wildcards do not match '$' topics)
+ * @param[in] visitor visitor
+ * @param[in] arg visitor argument
+ * @return visited count
+ */
+static int MQTTTopicMatchLevel(MQTTTopicNode* node, const char* topic, int root, MQTTTopicVisitor* visitor, void* arg) {
+    const char* end = strchr(topic, '/');
+    size_t len = end ? (size_t)(end - topic) : strlen(topic);
+    int wildcard = !(root && topic[0] == '$');
+    int count = 0;
+    MQTTTopicNode* child;
+
+    if(wildcard && node->hash && node->hash->subscription) {
+        visitor(node->hash->subscription, arg);
+        count++;
+    }
+    child = MQTTTopicFindChild(node, topic, len, NULL);
+    if(child) {
+        count += end ? MQTTTopicMatchLevel(child, end + 1, 0, visitor, arg) : MQTTTopicVisitEnd(child, visitor, arg);
+    }
+    if(wildcard && node->plus) {
+        count += end ? MQTTTopicMatchLevel(node->plus, end + 1, 0, visitor, arg) : MQTTTopicVisitEnd(node->plus, visitor, arg);
+    }
+    return count;
+}
+
+/**
+ * @brief visit every subscription whose filter matches a topic.
+ * the cost depends on the topic depth, not on the subscription count.
+ * @param[in] tree subscription table
+ * @param[in] topic topic name
+ * @param[in] visitor visitor
+ * @param[in] arg visitor argument
+ * @return matched count
+ */
+int MQTTTopicMatch(MQTTTopicTree* tree, const char* topic, MQTTTopicVisitor* visitor, void* arg) {
+    if(tree->count == 0 || topic == NULL) return 0;
+    return MQTTTopicMatchLevel(&tree->root, topic, 1, visitor, arg);
+}
+
+/**
+ * @brief visit the subscriptions below a node
+ * @param[in] node node
+ * @param[in] visitor visitor
+ * @param[in] arg visitor argument
+ */
+static void MQTTTopicForEachNode(MQTTTopicNode* node, MQTTTopicVisitor* visitor, void* arg) {
+    int i;
+    if(node->subscription) visitor(node->subscription, arg);
+    for(i = 0; i < node->childCount; i++) {
+        MQTTTopicForEachNode(node->children[i], visitor, arg);
+    }
+    if(node->plus) MQTTTopicForEachNode(node->plus, visitor, arg);
+    if(node->hash) MQTTTopicForEachNode(node->hash, visitor, arg);
+}
+
+/**
+ * @brief visit every subscription. the visitor must not change the table.
+ * @param[in] tree subscription table
+ * @param[in] visitor visitor
+ * @param[in] arg visitor argument
+ */
+void MQTTTopicForEach(MQTTTopicTree* tree, MQTTTopicVisitor* visitor, void* arg) {
+    MQTTTopicForEachNode(&tree->root, visitor, arg);
+}
+
+/**
+ * @brief remove every subscription
+ * @param[in] tree subscription table
+ */
+void MQTTTopicClear(MQTTTopicTree* tree) {
+    MQTTTopicNodeClear(&tree->root);
+    tree->count = 0;
+}
@@ -8,7 +8,9 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
+#include <math.h>
 
 #include "MQTT.h"
 #include "Simple.h"
@@ -19,152 +21,579 @@
 #include "SKTtpDebug.h"
 #endif
 
-/** service ID **/
-static char* mServiceID;
-/** device ID **/
-static char* mDeviceID;
-
 /**
- * @brief add Element to cJSON object
- * @param[in] jsonObject : cJSON object
+ * @brief write Element as a member of the object being written
+ * @param[in] writer : JSON writer
  * @param[in] element : adding Element
  * @return int : result code
  */
-static int addElement(cJSON* jsonObject, Element* element) {
-    if(!jsonObject || !element)  return TP_SDK_INVALID_PARAMETER;
+static int addElement(cJSON_Writer* writer, Element* element) {
+    if(!writer || !element || !element->value)  return TP_SDK_INVALID_PARAMETER;
+    cJSON_WriterKey(writer, element->name);
     if(element->type == JSON_TYPE_BOOLEAN) {
-        if(*(int *)element->value) {
-            cJSON_AddTrueToObject(jsonObject, element->name);
-        } else {
-            cJSON_AddFalseToObject(jsonObject, element->name);
-        }
+        cJSON_WriterBool(writer, *(int *)element->value != 0);
     } else if(element->type == JSON_TYPE_LONGLONG) {
-        cJSON_AddNumberToObject(jsonObject, element->name, *(long long *)element->value);
+        cJSON_WriterNumber(writer, *(long long *)element->value);
     } else if(element->type == JSON_TYPE_LONG) {
-        cJSON_AddNumberToObject(jsonObject, element->name, *(long *)element->value);
+        cJSON_WriterNumber(writer, *(long *)element->value);
     } else if(element->type == JSON_TYPE_DOUBLE) {
-        cJSON_AddNumberToObject(jsonObject, element->name, *(double *)element->value);
+        cJSON_WriterNumber(writer, *(double *)element->value);
     } else if(element->type == JSON_TYPE_RAW) {
-        cJSON_AddRawToObject(jsonObject, element->name, (char *)element->value);
+        cJSON_WriterRaw(writer, (char *)element->value);
     } else {
-        cJSON_AddStringToObject(jsonObject, element->name, (char *)element->value);
+        cJSON_WriterString(writer, (char *)element->value);
     }
     return TP_SDK_SUCCESS;
 }
 
+/**
+ * @brief write a string member, omitted when the value is not set
+ * @param[in] writer : JSON writer
+ * @param[in] name : member name
+ * @param[in] value : member value
+ */
+static void addString(cJSON_Writer* writer, const char* name, const char* value) {
+    if(!value) return;
+    cJSON_WriterKey(writer, name);
+    cJSON_WriterString(writer, value);
+}
+
+/**
+ * @brief write a string array member, omitted when the strings are not set
+ * @param[in] writer : JSON writer
+ * @param[in] name : member name
+ * @param[in] strings : array values
+ * @param[in] count : array size
+ */
+static void addStringArray(cJSON_Writer* writer, const char* name, const char** strings, int count) {
+    int i;
+    if(!strings || count < 0) return;
+    cJSON_WriterKey(writer, name);
+    cJSON_WriterBeginArray(writer);
+    for(i = 0; i < count; i++) {
+        cJSON_WriterString(writer, strings[i]);
+    }
+    cJSON_WriterEndArray(writer);
+}
+
+/**
+ * @brief write a CSV text field, quoted(RFC 4180) when it contains a separator, a quote or a line break
+ * @param[in] writer : JSON writer used as the text buffer
+ * @param[in] text : field text
+ */
+static void addCsvText(cJSON_Writer* writer, const char* text) {
+    const char* quote;
+
+    if(strpbrk(text, ",\"\r\n") == NULL) {
+        cJSON_WriterRaw(writer, text);
+        return;
+    }
+    cJSON_WriterRawLength(writer, "\"", 1);
+    while((quote = strchr(text, '"')) != NULL) {
+        // an embedded quote is doubled
+        cJSON_WriterRawLength(writer, text, quote - text + 1);
+        cJSON_WriterRawLength(writer, "\"", 1);
+        text = quote + 1;
+    }
+    cJSON_WriterRaw(writer, text);
+    cJSON_WriterRawLength(writer, "\"", 1);
+}
+
+/**
+ * @brief write a CSV field, left empty when the value is not set or is not a finite number.
+ * integers are written with every digit.
+ * @param[in] writer : JSON writer used as the text buffer
+ * @param[in] type : value type
+ * @param[in] value : value, typed as Element value
+ */
+static void addCsvValue(cJSON_Writer* writer, DATA_TYPE type, void* value) {
+    if(!value) return;
+    if(type == JSON_TYPE_BOOLEAN) {
+        cJSON_WriterRaw(writer, *(int *)value ? "1" : "0");
+    } else if(type == JSON_TYPE_LONGLONG) {
+        cJSON_WriterInteger(writer, *(long long *)value);
+    } else if(type == JSON_TYPE_LONG) {
+        cJSON_WriterInteger(writer, *(long *)value);
+    } else if(type == JSON_TYPE_DOUBLE) {
+        // print_number writes null for NaN and infinity
+        if(isfinite(*(double *)value)) cJSON_WriterNumber(writer, *(double *)value);
+    } else {
+        addCsvText(writer, (char *)value);
+    }
+}
+
+/**
+ * @brief resolve QoS of the publish
+ * @param[in] client : session handle
+ * @param[in] topicClass : topic class of the publish
+ * @param[in] qos : requested QoS or TP_QOS_DEFAULT
+ * @return int : QoS to publish with, -1 if the requested QoS is invalid
+ */
+static int resolveQos(tpClient* client, TOPIC_CLASS topicClass, int qos) {
+    if(qos == TP_QOS_DEFAULT) return MQTTGetQosEx(client, topicClass);
+    if(qos < 0 || qos > 2) return -1;
+    return qos;
+}
+
+/**
+ * @brief set QoS policy of the topic class
+ * @param[in] topicClass : topic class
+ * @param[in] qos : QoS(0, 1, 2)
+ * @return int : result code
+ */
+int tpSimpleSetQos(TOPIC_CLASS topicClass, int qos) {
+    return tpSimpleSetQosEx(MQTTDefaultClient(), topicClass, qos);
+}
+
+/**
+ * @brief set QoS policy of the topic class of the session
+ * @param[in] client : session handle
+ * @param[in] topicClass : topic class
+ * @param[in] qos : QoS(0, 1, 2)
+ * @return int : result code
+ */
+int tpSimpleSetQosEx(tpClient* client, TOPIC_CLASS topicClass, int qos) {
+    if(!client || topicClass < 0 || topicClass >= TOPIC_CLASS_MAX) return TP_SDK_INVALID_PARAMETER;
+    return MQTTSetQosEx(client, topicClass, qos);
+}
+
+/**
+ * @brief set telemetry coalescing.
+ * JSON telemetry samples are collected for up to window msec or maxBytes bytes and sent as one JSON array.
+ * the batch is sent at once before a control result, a subscribe request, a disconnect and tpSDKDestroy.
+ * @param[in] window : collect window in msec(0 : disabled, every sample is sent at once)
+ * @param[in] maxBytes : batch size limit in bytes(0 : 4096)
+ * @return int : result code
+ */
+int tpSimpleSetCoalescing(int window, size_t maxBytes) {
+    return tpSimpleSetCoalescingEx(MQTTDefaultClient(), window, maxBytes);
+}
+
+/**
+ * @brief set telemetry coalescing of the session
+ * @param[in] client : session handle
+ * @param[in] window : collect window in msec(0 : disabled, every sample is sent at once)
+ * @param[in] maxBytes : batch size limit in bytes(0 : 4096)
+ * @return int : result code
+ */
+int tpSimpleSetCoalescingEx(tpClient* client, int window, size_t maxBytes) {
+    if(!client || window < 0) return TP_SDK_INVALID_PARAMETER;
+    return MQTTCoalesceSet(client, window, maxBytes);
+}
+
+/**
+ * @brief collect raw JSON telemetry too when coalescing is set
+ * @param[in] enable : 1 if every FORMAT_JSON buffer of tpSimpleRawTelemetry is one JSON object, 0 : sent as is
+ * @return int : result code
+ */
+int tpSimpleSetCoalescingRaw(int enable) {
+    return tpSimpleSetCoalescingRawEx(MQTTDefaultClient(), enable);
+}
+
+/**
+ * @brief collect raw JSON telemetry of the session too when coalescing is set
+ * @param[in] client : session handle
+ * @param[in] enable : 1 if every FORMAT_JSON buffer of tpSimpleRawTelemetry is one JSON object, 0 : sent as is
+ * @return int : result code
+ */
+int tpSimpleSetCoalescingRawEx(tpClient* client, int enable) {
+    if(!client) return TP_SDK_INVALID_PARAMETER;
+    __atomic_store_n(&client->coalesce.raw, enable ? 1 : 0, __ATOMIC_RELEASE);
+    return TP_SDK_SUCCESS;
+}
+
+/**
+ * @brief send the collected telemetry now
+ * @return int : result code
+ */
+int tpSimpleFlushTelemetry() {
+    return tpSimpleFlushTelemetryEx(MQTTDefaultClient());
+}
+
+/**
+ * @brief send the collected telemetry of the session now
+ * @param[in] client : session handle
+ * @return int : result code
+ */
+int tpSimpleFlushTelemetryEx(tpClient* client) {
+    if(!client) return TP_SDK_INVALID_PARAMETER;
+    return MQTTCoalesceFlush(client);
+}
+
+/**
+ * @brief set JSON payload compression.
+ * JSON telemetry(batches included) and attributes of threshold bytes or more are sent as zlib streams
+ * with the ThingPlug key dictionary to the topic with TOPIC_DEFLATE_SUFFIX. a payload which does not shrink is sent as it is.
+ * @param[in] threshold : smallest payload compressed in bytes(0 : disabled)
+ * @param[in] level : zlib level(1 ~ 9, -1 : zlib default)
+ * @return int : result code
+ */
+int tpSimpleSetCompression(size_t threshold, int level) {
+    return tpSimpleSetCompressionEx(MQTTDefaultClient(), threshold, level);
+}
+
+/**
+ * @brief set JSON payload compression of the session
+ * @param[in] client : session handle
+ * @param[in] threshold : smallest payload compressed in bytes(0 : disabled)
+ * @param[in] level : zlib level(1 ~ 9, -1 : zlib default)
+ * @return int : result code
+ */
+int tpSimpleSetCompressionEx(tpClient* client, size_t threshold, int level) {
+    if(!client || (level != -1 && (level < 1 || level > 9))) return TP_SDK_INVALID_PARAMETER;
+    return MQTTDeflateSet(client, threshold, level);
+}
+
+/**
+ * @brief get JSON payload compression statistics
+ * @param[out] stats : compressed payloads, bytes before and after and CPU time
+ * @return int : result code
+ */
+int tpSimpleGetCompressionStats(tpCompressionStats* stats) {
+    return tpSimpleGetCompressionStatsEx(MQTTDefaultClient(), stats);
+}
+
+/**
+ * @brief get JSON payload compression statistics of the session
+ * @param[in] client : session handle
+ * @param[out] stats : compressed payloads, bytes before and after and CPU time
+ * @return int : result code
+ */
+int tpSimpleGetCompressionStatsEx(tpClient* client, tpCompressionStats* stats) {
+    if(!client || !stats) return TP_SDK_INVALID_PARAMETER;
+    return MQTTDeflateGetStats(client, stats);
+}
+
 /**
  * @brief add content data of contentInstance
  * @param[in] data : data
  * @param[in] length : data length
  * @return int : result code
  */
-int tpSimpleAddData(char* data, unsigned char length) {
-    if(!data || length < 1) return TP_SDK_FAILURE;
-    if(!gContent) {
-        gContent = (Content *)calloc(1, sizeof(Content));
-        gContent->data = (char *)calloc(1, length + 1);
-        memcpy(gContent->data, data, length);
-        gContent->len = length;
-    } else {
-        gContent->len = gContent->len + length;
-        gContent->data = (char *)realloc(gContent->data, gContent->len + 1);
-        gContent->data[gContent->len] = '\0';
-        strncat(gContent->data, data, length);
+int tpSimpleAddData(char* data, size_t length) {
+    return tpSimpleAddDataEx(MQTTDefaultClient(), data, length);
+}
+
+/**
+ * @brief add content data of contentInstance of the session.
+ *        the buffer grows geometrically and is reused by the next telemetry.
+ * @param[in] client : session handle
+ * @param[in] data : data
+ * @param[in] length : data length
+ * @return int : result code
+ */
+int tpSimpleAddDataEx(tpClient* client, char* data, size_t length) {
+    if(!client || !data || length < 1) return TP_SDK_FAILURE;
+    Content* content = &client->content;
+
+    if(length >= SIZE_MAX / 2 - content->len) return TP_SDK_FAILURE;
+    if(content->len + length + 1 > content->capacity) {
+        size_t capacity = content->capacity ? content->capacity : SIZE_CONTENT;
+        char* grown;
+        while(capacity < content->len + length + 1) capacity *= 2;
+        grown = (char *)realloc(content->data, capacity);
+        if(!grown) return TP_SDK_FAILURE;
+        content->data = grown;
+        content->capacity = capacity;
     }
+    memcpy(content->data + content->len, data, length);
+    content->len += length;
+    content->data[content->len] = '\0';
 #ifdef SPT_DEBUG_ENABLE
-    SKTtpDebugLog(LOG_LEVEL_INFO, "Content data : %s, length : %d", gContent->data, gContent->len);
+    SKTtpDebugLog(LOG_LEVEL_INFO, "Content data : %.*s, length : %zu", (int)length, data, content->len);
 #else
-    SKTDebugPrint(LOG_LEVEL_INFO, "Content data : %s, length : %d", gContent->data, gContent->len);
+    SKTDebugPrint(LOG_LEVEL_INFO, "Content data : %.*s, length : %zu", (int)length, data, content->len);
 #endif
     return TP_SDK_SUCCESS;
 }
 
+/**
+ * @brief discard the added content data, keeping its buffer
+ * @return int : result code
+ */
+int tpSimpleResetData() {
+    return tpSimpleResetDataEx(MQTTDefaultClient());
+}
+
+/**
+ * @brief discard the added content data of the session, keeping its buffer
+ * @param[in] client : session handle
+ * @return int : result code
+ */
+int tpSimpleResetDataEx(tpClient* client) {
+    if(!client) return TP_SDK_INVALID_PARAMETER;
+    client->content.len = 0;
+    if(client->content.data) client->content.data[0] = '\0';
+    return TP_SDK_SUCCESS;
+}
+
 /**
  * @brief device telemetry
  * @param[in] telemetry : content
  * @param[in] useAddedData : use added data flag
  * @return int : result code
  */
- int tpSimpleTelemetry(ArrayElement* telemetry, unsigned char useAddedData) {
+int tpSimpleTelemetry(ArrayElement* telemetry, unsigned char useAddedData) {
+    return tpSimpleTelemetryEx(MQTTDefaultClient(), telemetry, useAddedData);
+}
+
+/**
+ * @brief device telemetry of the session
+ * @param[in] client : session handle
+ * @param[in] telemetry : content
+ * @param[in] useAddedData : use added data flag
+ * @return int : result code
+ */
+int tpSimpleTelemetryEx(tpClient* client, ArrayElement* telemetry, unsigned char useAddedData) {
+    return tpSimpleTelemetryQosEx(client, telemetry, useAddedData, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief device telemetry with QoS
+ * @param[in] telemetry : content
+ * @param[in] useAddedData : use added data flag
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleTelemetryQos(ArrayElement* telemetry, unsigned char useAddedData, int qos) {
+    return tpSimpleTelemetryQosEx(MQTTDefaultClient(), telemetry, useAddedData, qos);
+}
+
+/**
+ * @brief device telemetry with QoS of the session
+ * @param[in] client : session handle
+ * @param[in] telemetry : content
+ * @param[in] useAddedData : use added data flag
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleTelemetryQosEx(tpClient* client, ArrayElement* telemetry, unsigned char useAddedData, int qos) {
+    if(!client) return TP_SDK_INVALID_PARAMETER;
+    qos = resolveQos(client, TOPIC_CLASS_TELEMETRY, qos);
+    if(qos < 0) return TP_SDK_MQTT_BAD_QOS;
     int rc = TP_SDK_FAILURE;
     char topic[SIZE_TOPIC] = "";
-    snprintf(topic, SIZE_TOPIC, TOPIC_TELEMETRY, mServiceID, mDeviceID);
+    snprintf(topic, SIZE_TOPIC, TOPIC_TELEMETRY, client->serviceID, client->deviceID);
 
     if(useAddedData) {
-        if(!gContent || !gContent->data) return TP_SDK_INVALID_PARAMETER;
+        if(client->content.len == 0) return TP_SDK_INVALID_PARAMETER;
         
-        rc = MQTTAsyncPublishMessageWithTopic(topic, gContent->data);
+        MQTTCoalesceFlush(client);
+        // the payload is copied by the publish, so the buffer is reused for the next content
+        rc = MQTTAsyncPublishBufferEx(client, topic, client->content.data, client->content.len, qos);
 #ifdef SPT_DEBUG_ENABLE
-    SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleTelemetry\ntopic : %s\n%s", topic, gContent->data);
+    SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleTelemetry\ntopic : %s\n%s", topic, client->content.data);
 #else
-    SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleTelemetry\ntopic : %s\n%s", topic, gContent->data);
+    SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleTelemetry\ntopic : %s\n%s", topic, client->content.data);
 #endif
-        if(gContent) {
-            if(gContent->data) {
-                free(gContent->data);
-                gContent->data = NULL;
-            }
-            free(gContent);
-            gContent = NULL;
-        }
+        tpSimpleResetDataEx(client);
     } else {
         if(!telemetry) return TP_SDK_INVALID_PARAMETER;
         int i, size;
         Element* element;
 
-        char* jsonData;
-        cJSON* jsonObject = cJSON_CreateObject();
-    
+        const char* jsonData;
+        size_t len = 0;
+        char buffer[SIZE_JSON];
+        cJSON_Writer writer;
+
+        cJSON_WriterInit(&writer, buffer, sizeof(buffer), 1);
+        cJSON_WriterBeginObject(&writer);
         size = telemetry->total;
         for(i = 0; i < size; i++) {
             element = (telemetry->element + i);
-            addElement(jsonObject, element);
+            addElement(&writer, element);
         }
-        jsonData = cJSON_Print(jsonObject);
-        cJSON_Delete(jsonObject);
+        cJSON_WriterEndObject(&writer);
+        jsonData = cJSON_WriterFinish(&writer, &len);
 
 #ifdef SPT_DEBUG_ENABLE
     SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleTelemetry\ntopic : %s\n%s", topic, jsonData);
 #else
     SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleTelemetry\ntopic : %s\n%s", topic, jsonData);
 #endif
-        rc = MQTTAsyncPublishMessageWithTopic(topic, jsonData);
-        if(jsonData) free(jsonData);
+        // collected into a batch when coalescing is set
+        rc = jsonData ? MQTTCoalesceAdd(client, topic, jsonData, len, qos) : TP_SDK_FAILURE;
+        cJSON_WriterFree(&writer);
     }
     return rc;
 }
 
+
+/**
+ * @brief device telemetry of several timestamped samples in one payload
+ * @param[in] samples : samples
+ * @param[in] n : sample count
+ * @param[in] format : FORMAT_JSON or FORMAT_CSV
+ * @return int : result code
+ */
+int tpSimpleTelemetryBatch(TelemetrySample* samples, int n, DATA_FORMAT format) {
+    return tpSimpleTelemetryBatchEx(MQTTDefaultClient(), samples, n, format);
+}
+
+/**
+ * @brief device telemetry of several timestamped samples in one payload of the session
+ * @param[in] client : session handle
+ * @param[in] samples : samples
+ * @param[in] n : sample count
+ * @param[in] format : FORMAT_JSON or FORMAT_CSV
+ * @return int : result code
+ */
+int tpSimpleTelemetryBatchEx(tpClient* client, TelemetrySample* samples, int n, DATA_FORMAT format) {
+    return tpSimpleTelemetryBatchQosEx(client, samples, n, format, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief device telemetry of several timestamped samples in one payload with QoS
+ * @param[in] samples : samples
+ * @param[in] n : sample count
+ * @param[in] format : FORMAT_JSON or FORMAT_CSV
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleTelemetryBatchQos(TelemetrySample* samples, int n, DATA_FORMAT format, int qos) {
+    return tpSimpleTelemetryBatchQosEx(MQTTDefaultClient(), samples, n, format, qos);
+}
+
+/**
+ * @brief device telemetry of several timestamped samples in one payload with QoS of the session.
+ *        JSON is an array of the sample objects with the ts member first,
+ *        CSV is a line per sample with the timestamp as the first field,
+ *        text fields with a separator, a quote or a line break are quoted as in the prepared CSV.
+ * @param[in] client : session handle
+ * @param[in] samples : samples
+ * @param[in] n : sample count
+ * @param[in] format : FORMAT_JSON or FORMAT_CSV
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleTelemetryBatchQosEx(tpClient* client, TelemetrySample* samples, int n, DATA_FORMAT format, int qos) {
+    if(!client || !samples || n <= 0) return TP_SDK_INVALID_PARAMETER;
+    if(format != FORMAT_JSON && format != FORMAT_CSV) return TP_SDK_INVALID_PARAMETER;
+    qos = resolveQos(client, TOPIC_CLASS_TELEMETRY, qos);
+    if(qos < 0) return TP_SDK_MQTT_BAD_QOS;
+    int rc, i, j;
+    char topic[SIZE_TOPIC] = "";
+    const char* data;
+    size_t len = 0;
+    char buffer[SIZE_JSON];
+    cJSON_Writer writer;
+    ArrayElement* values;
+
+    snprintf(topic, SIZE_TOPIC, format == FORMAT_JSON ? TOPIC_TELEMETRY : TOPIC_TELEMETRY_CSV, client->serviceID, client->deviceID);
+    // unformatted, the indentation of a batch would cost more than its separators
+    cJSON_WriterInit(&writer, buffer, sizeof(buffer), 0);
+    if(format == FORMAT_JSON) cJSON_WriterBeginArray(&writer);
+    for(i = 0; i < n; i++) {
+        values = samples[i].values;
+        if(format == FORMAT_JSON) {
+            cJSON_WriterBeginObject(&writer);
+            cJSON_WriterKey(&writer, TIMESTAMP);
+            cJSON_WriterNumber(&writer, samples[i].timestamp);
+            for(j = 0; values && j < values->total; j++) {
+                addElement(&writer, values->element + j);
+            }
+            cJSON_WriterEndObject(&writer);
+        } else {
+            if(i > 0) cJSON_WriterRaw(&writer, "\n");
+            cJSON_WriterNumber(&writer, samples[i].timestamp);
+            // the quoting keeps a text field with a line break inside its sample line
+            for(j = 0; values && j < values->total; j++) {
+                cJSON_WriterRaw(&writer, ",");
+                addCsvValue(&writer, values->element[j].type, values->element[j].value);
+            }
+        }
+    }
+    if(format == FORMAT_JSON) cJSON_WriterEndArray(&writer);
+    data = cJSON_WriterFinish(&writer, &len);
+
+#ifdef SPT_DEBUG_ENABLE
+    SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleTelemetryBatch\ntopic : %s\nsamples : %d\n%s", topic, n, data);
+#else
+    SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleTelemetryBatch\ntopic : %s\nsamples : %d\n%s", topic, n, data);
+#endif
+    // the samples collected before are sent first
+    MQTTCoalesceFlush(client);
+    if(!data) {
+        rc = TP_SDK_FAILURE;
+    } else if(format == FORMAT_JSON) {
+        rc = MQTTDeflatePublish(client, topic, data, len, qos);
+    } else {
+        rc = MQTTAsyncPublishBufferEx(client, topic, data, len, qos);
+    }
+    cJSON_WriterFree(&writer);
+    return rc;
+}
+
 /**
  * @brief device attribute
  * @param[in] attribute : attributes
  * @return int : result code
  */
- int tpSimpleAttribute(ArrayElement* attribute) {
-    if(!attribute) return TP_SDK_INVALID_PARAMETER;
+int tpSimpleAttribute(ArrayElement* attribute) {
+    return tpSimpleAttributeEx(MQTTDefaultClient(), attribute);
+}
+
+/**
+ * @brief device attribute of the session
+ * @param[in] client : session handle
+ * @param[in] attribute : attributes
+ * @return int : result code
+ */
+int tpSimpleAttributeEx(tpClient* client, ArrayElement* attribute) {
+    return tpSimpleAttributeQosEx(client, attribute, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief device attribute with QoS
+ * @param[in] attribute : attributes
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleAttributeQos(ArrayElement* attribute, int qos) {
+    return tpSimpleAttributeQosEx(MQTTDefaultClient(), attribute, qos);
+}
+
+/**
+ * @brief device attribute with QoS of the session
+ * @param[in] client : session handle
+ * @param[in] attribute : attributes
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleAttributeQosEx(tpClient* client, ArrayElement* attribute, int qos) {
+    if(!client || !attribute) return TP_SDK_INVALID_PARAMETER;
+    qos = resolveQos(client, TOPIC_CLASS_ATTRIBUTE, qos);
+    if(qos < 0) return TP_SDK_MQTT_BAD_QOS;
     int rc = TP_SDK_FAILURE;
     int i, size;
     char topic[SIZE_TOPIC] = "";
     Element* element;
-    snprintf(topic, SIZE_TOPIC, TOPIC_ATTRIBUTE, mServiceID, mDeviceID);
+    snprintf(topic, SIZE_TOPIC, TOPIC_ATTRIBUTE, client->serviceID, client->deviceID);
 
-    char* jsonData;
-    cJSON* jsonObject = cJSON_CreateObject();
-    
+    const char* jsonData;
+    size_t len = 0;
+    char buffer[SIZE_JSON];
+    cJSON_Writer writer;
+
+    cJSON_WriterInit(&writer, buffer, sizeof(buffer), 1);
+    cJSON_WriterBeginObject(&writer);
     size = attribute->total;
     for(i = 0; i < size; i++) {
         element = (attribute->element + i);
-        addElement(jsonObject, element);
+        addElement(&writer, element);
     }
-    jsonData = cJSON_Print(jsonObject);
-    cJSON_Delete(jsonObject);
+    cJSON_WriterEndObject(&writer);
+    jsonData = cJSON_WriterFinish(&writer, &len);
 
 #ifdef SPT_DEBUG_ENABLE
     SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleAttribute\ntopic : %s\n%s", topic,  jsonData);
 #else
     SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleAttribute\ntopic : %s\n%s", topic,  jsonData);
 #endif
-    rc = MQTTAsyncPublishMessageWithTopic(topic, jsonData);
-    if(jsonData) free(jsonData);
+    // compressed when compression is set and the payload reaches the threshold
+    rc = jsonData ? MQTTDeflatePublish(client, topic, jsonData, len, qos) : TP_SDK_FAILURE;
+    cJSON_WriterFree(&writer);
     return rc;
 }
 
@@ -174,50 +603,85 @@ int tpSimpleAddData(char* data, unsigned char length) {
  * @return int : result code
  */
 int tpSimpleResult(RPCResponse* response) {
-    if(!response) return TP_SDK_INVALID_PARAMETER;
+    return tpSimpleResultEx(MQTTDefaultClient(), response);
+}
+
+/**
+ * @brief device control result of the session
+ * @param[in] client : session handle
+ * @param[in] response : control result response
+ * @return int : result code
+ */
+int tpSimpleResultEx(tpClient* client, RPCResponse* response) {
+    return tpSimpleResultQosEx(client, response, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief device control result with QoS
+ * @param[in] response : control result response
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleResultQos(RPCResponse* response, int qos) {
+    return tpSimpleResultQosEx(MQTTDefaultClient(), response, qos);
+}
+
+/**
+ * @brief device control result with QoS of the session
+ * @param[in] client : session handle
+ * @param[in] response : control result response
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleResultQosEx(tpClient* client, RPCResponse* response, int qos) {
+    if(!client || !response) return TP_SDK_INVALID_PARAMETER;
+    qos = resolveQos(client, TOPIC_CLASS_UP, qos);
+    if(qos < 0) return TP_SDK_MQTT_BAD_QOS;
     int i, size, rc = TP_SDK_FAILURE;
     char topic[SIZE_TOPIC] = "";
-    snprintf(topic, SIZE_TOPIC, TOPIC_UP, mServiceID, mDeviceID);
+    snprintf(topic, SIZE_TOPIC, TOPIC_UP, client->serviceID, client->deviceID);
 
-    char* jsonData;
-    cJSON* jsonObject = cJSON_CreateObject();
-    cJSON* rpcRspObject = cJSON_CreateObject();
-    cJSON* resultObject = cJSON_CreateObject();
+    const char* jsonData;
+    size_t len = 0;
+    char buffer[SIZE_JSON];
+    cJSON_Writer writer;
     Element* element;
 
-    cJSON_AddStringToObject(jsonObject, CMD, response->cmd);
-    cJSON_AddNumberToObject(jsonObject, CMD_ID, response->cmdId);
-    if(response->result) {
-        cJSON_AddStringToObject(jsonObject, RESULT, "success");
-    } else {
-        cJSON_AddStringToObject(jsonObject, RESULT, "fail");
-    }
+    cJSON_WriterInit(&writer, buffer, sizeof(buffer), 1);
+    cJSON_WriterBeginObject(&writer);
+    addString(&writer, CMD, response->cmd);
+    cJSON_WriterKey(&writer, CMD_ID);
+    cJSON_WriterNumber(&writer, response->cmdId);
+    addString(&writer, RESULT, response->result ? "success" : "fail");
 
-    cJSON_AddStringToObject(rpcRspObject, JSONRPC, response->jsonrpc);
-    cJSON_AddNumberToObject(rpcRspObject, ID, response->id);
+    cJSON_WriterKey(&writer, RPC_RSP);
+    cJSON_WriterBeginObject(&writer);
+    addString(&writer, JSONRPC, response->jsonrpc);
+    cJSON_WriterKey(&writer, ID);
+    cJSON_WriterNumber(&writer, response->id);
     if( response->resultArray != NULL ) {
+        cJSON_WriterKey(&writer, response->result ? RESULT : ERROR);
+        cJSON_WriterBeginObject(&writer);
         size = response->resultArray->total;
         for(i = 0; i < size; i++) {
             element = (response->resultArray->element + i);
-            addElement(resultObject, element);
-        }
-        if(response->result) {
-            cJSON_AddItemToObject(rpcRspObject, RESULT, resultObject);
-        } else {
-            cJSON_AddItemToObject(rpcRspObject, ERROR, resultObject);        
+            addElement(&writer, element);
         }
+        cJSON_WriterEndObject(&writer);
     }
-    cJSON_AddItemToObject(jsonObject, RPC_RSP, rpcRspObject);
-    jsonData = cJSON_Print(jsonObject);
-    cJSON_Delete(jsonObject);
+    cJSON_WriterEndObject(&writer);
+    cJSON_WriterEndObject(&writer);
+    jsonData = cJSON_WriterFinish(&writer, &len);
 
 #ifdef SPT_DEBUG_ENABLE
     SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleResult\ntopic : %s\n%s", topic,  jsonData);
 #else
     SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleResult\ntopic : %s\n%s", topic,  jsonData);
 #endif
-    rc = MQTTAsyncPublishMessageWithTopic(topic, jsonData);    
-    if(jsonData) free(jsonData);
+    // the telemetry collected before the control is sent first
+    MQTTCoalesceFlush(client);
+    rc = jsonData ? MQTTAsyncPublishBufferEx(client, topic, jsonData, len, qos) : TP_SDK_FAILURE;
+    cJSON_WriterFree(&writer);
     return rc;
 }
 
@@ -227,44 +691,531 @@ int tpSimpleResult(RPCResponse* response) {
  * @return int : result code
  */
 int tpSimpleSubscribe(DeviceSubscribe* subscribe) {
-    if(!subscribe) return TP_SDK_INVALID_PARAMETER;
+    return tpSimpleSubscribeEx(MQTTDefaultClient(), subscribe);
+}
+
+/**
+ * @brief subscribe/unsubscribe request of the session
+ * @param[in] client : session handle
+ * @param[in] subscribe : information
+ * @return int : result code
+ */
+int tpSimpleSubscribeEx(tpClient* client, DeviceSubscribe* subscribe) {
+    if(!client || !subscribe) return TP_SDK_INVALID_PARAMETER;
     int rc = TP_SDK_FAILURE;
     char topic[SIZE_TOPIC] = "";
-    snprintf(topic, SIZE_TOPIC, TOPIC_UP, mServiceID, mDeviceID);
+    snprintf(topic, SIZE_TOPIC, TOPIC_UP, client->serviceID, client->deviceID);
 
-    char* jsonData;
-    cJSON* jsonObject = cJSON_CreateObject();
-    cJSON* attributeArray = cJSON_CreateStringArray(subscribe->attribute, subscribe->attribute_size);
-    cJSON* telemetryArray = cJSON_CreateStringArray(subscribe->telemetry, subscribe->telemetry_size);
-    
-    cJSON_AddStringToObject(jsonObject, CMD, subscribe->cmd);
-    cJSON_AddNumberToObject(jsonObject, CMD_ID, subscribe->cmdId);
-    cJSON_AddStringToObject(jsonObject, SERVICE_NAME, mServiceID);
-    cJSON_AddStringToObject(jsonObject, DEVICE_NAME, mDeviceID);
-    if(subscribe->sensorNodeId) {
-        cJSON_AddStringToObject(jsonObject, SENSOR_NODE_ID, subscribe->sensorNodeId);
-    }
-    if(subscribe->isTargetAll) {
-        cJSON_AddTrueToObject(jsonObject, IS_TARGET_ALL);
-    } else {
-        cJSON_AddFalseToObject(jsonObject, IS_TARGET_ALL);
-    }
-    cJSON_AddItemToObject(jsonObject, ATTRIBUTE, attributeArray);
-    cJSON_AddItemToObject(jsonObject, TELEMETRY, telemetryArray);
-    
-    jsonData = cJSON_Print(jsonObject);
-    cJSON_Delete(jsonObject);
+    const char* jsonData;
+    size_t len = 0;
+    char buffer[SIZE_JSON];
+    cJSON_Writer writer;
+
+    cJSON_WriterInit(&writer, buffer, sizeof(buffer), 1);
+    cJSON_WriterBeginObject(&writer);
+    addString(&writer, CMD, subscribe->cmd);
+    cJSON_WriterKey(&writer, CMD_ID);
+    cJSON_WriterNumber(&writer, subscribe->cmdId);
+    addString(&writer, SERVICE_NAME, client->serviceID);
+    addString(&writer, DEVICE_NAME, client->deviceID);
+    addString(&writer, SENSOR_NODE_ID, subscribe->sensorNodeId);
+    cJSON_WriterKey(&writer, IS_TARGET_ALL);
+    cJSON_WriterBool(&writer, subscribe->isTargetAll != 0);
+    addStringArray(&writer, ATTRIBUTE, subscribe->attribute, subscribe->attribute_size);
+    addStringArray(&writer, TELEMETRY, subscribe->telemetry, subscribe->telemetry_size);
+    cJSON_WriterEndObject(&writer);
+    jsonData = cJSON_WriterFinish(&writer, &len);
 
 #ifdef SPT_DEBUG_ENABLE
     SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleSubscribe\ntopic : %s\n%s", topic,  jsonData);
 #else
     SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleSubscribe\ntopic : %s\n%s", topic,  jsonData);
 #endif
-    rc = MQTTAsyncPublishMessageWithTopic(topic, jsonData);
-    if(jsonData) free(jsonData);
+    MQTTCoalesceFlush(client);
+    rc = jsonData ? MQTTAsyncPublishBufferEx(client, topic, jsonData, len, MQTTGetQosEx(client, TOPIC_CLASS_UP)) : TP_SDK_FAILURE;
+    cJSON_WriterFree(&writer);
     return rc;
 }
 
+/**
+ * @brief compile the member names of a payload sent repeatedly into a skeleton
+ * @param[in] names : member names in payload order
+ * @param[in] types : value types
+ * @param[in] n : member count
+ * @return tpSchema* : schema, NULL if failed. free with tpSimpleFreeSchema.
+ */
+tpSchema* tpSimplePrepareSchema(char** names, DATA_TYPE* types, int n) {
+    return tpSimplePrepareSchemaEx(MQTTDefaultClient(), names, types, n);
+}
+
+/**
+ * @brief compile the member names of a payload sent repeatedly into a skeleton for the session.
+ *        the topics are rendered with the IDs of tpSimpleInitializeEx.
+ * @param[in] client : session handle
+ * @param[in] names : member names in payload order
+ * @param[in] types : value types
+ * @param[in] n : member count
+ * @return tpSchema* : schema, NULL if failed. free with tpSimpleFreeSchema.
+ */
+tpSchema* tpSimplePrepareSchemaEx(tpClient* client, char** names, DATA_TYPE* types, int n) {
+    if(!client || !client->serviceID || !client->deviceID || !names || !types || n <= 0) return NULL;
+    int i;
+    size_t len = 0, *slots;
+    const char* skeleton;
+    char* text;
+    tpSchema* schema = NULL;
+    cJSON_Writer writer;
+
+    for(i = 0; i < n; i++) {
+        if(!names[i] || types[i] < JSON_TYPE_STRING || types[i] > JSON_TYPE_BOOLEAN) return NULL;
+    }
+    slots = (size_t *)malloc(sizeof(size_t) * n);
+    if(!slots) return NULL;
+
+    // the layout of tpSimpleTelemetry, with the end of each key as the slot of its value
+    cJSON_WriterInit(&writer, NULL, 0, 1);
+    cJSON_WriterBeginObject(&writer);
+    for(i = 0; i < n; i++) {
+        cJSON_WriterKey(&writer, names[i]);
+        slots[i] = writer.offset;
+    }
+    cJSON_WriterEndObject(&writer);
+    skeleton = cJSON_WriterFinish(&writer, &len);
+
+    // one allocation : schema, segment pointers, types and the segments split by a terminator at each slot
+    if(skeleton) {
+        schema = (tpSchema *)calloc(1, sizeof(tpSchema) + sizeof(char *) * (n + 1) + sizeof(DATA_TYPE) * n + len + n + 1);
+    }
+    if(schema) {
+        schema->client = client;
+        schema->total = n;
+        schema->segments = (char **)(schema + 1);
+        schema->types = (DATA_TYPE *)(schema->segments + n + 1);
+        memcpy(schema->types, types, sizeof(DATA_TYPE) * n);
+        text = (char *)(schema->types + n);
+        for(i = 0; i <= n; i++) {
+            size_t start = i ? slots[i - 1] : 0;
+            size_t end = i < n ? slots[i] : len;
+            schema->segments[i] = text;
+            memcpy(text, skeleton + start, end - start);
+            text += end - start + 1;
+        }
+        snprintf(schema->telemetryTopic, SIZE_TOPIC, TOPIC_TELEMETRY, client->serviceID, client->deviceID);
+        snprintf(schema->attributeTopic, SIZE_TOPIC, TOPIC_ATTRIBUTE, client->serviceID, client->deviceID);
+        snprintf(schema->telemetryCsvTopic, SIZE_TOPIC, TOPIC_TELEMETRY_CSV, client->serviceID, client->deviceID);
+        snprintf(schema->attributeCsvTopic, SIZE_TOPIC, TOPIC_ATTRIBUTE_CSV, client->serviceID, client->deviceID);
+    }
+    cJSON_WriterFree(&writer);
+    free(slots);
+    return schema;
+}
+
+/**
+ * @brief free a schema of tpSimplePrepareSchema
+ * @param[in] schema : schema
+ */
+void tpSimpleFreeSchema(tpSchema* schema) {
+    if(!schema) return;
+    if(schema->widths) free(schema->widths);
+    free(schema);
+}
+
+/**
+ * @brief fill the values into the skeleton of the schema
+ * @param[in] schema : schema
+ * @param[in] values : value pointers in schema order, typed as Element value. NULL is written as null.
+ * @param[in] writer : initialized JSON writer
+ * @param[out] len : payload length
+ * @return const char* : payload, NULL if failed
+ */
+static const char* renderPrepared(tpSchema* schema, void** values, cJSON_Writer* writer, size_t* len) {
+    int i;
+    for(i = 0; i < schema->total; i++) {
+        cJSON_WriterRaw(writer, schema->segments[i]);
+        if(!values[i]) {
+            cJSON_WriterNull(writer);
+        } else if(schema->types[i] == JSON_TYPE_BOOLEAN) {
+            cJSON_WriterBool(writer, *(int *)values[i] != 0);
+        } else if(schema->types[i] == JSON_TYPE_LONGLONG) {
+            cJSON_WriterNumber(writer, *(long long *)values[i]);
+        } else if(schema->types[i] == JSON_TYPE_LONG) {
+            cJSON_WriterNumber(writer, *(long *)values[i]);
+        } else if(schema->types[i] == JSON_TYPE_DOUBLE) {
+            cJSON_WriterNumber(writer, *(double *)values[i]);
+        } else if(schema->types[i] == JSON_TYPE_RAW) {
+            cJSON_WriterRaw(writer, (char *)values[i]);
+        } else {
+            cJSON_WriterString(writer, (char *)values[i]);
+        }
+    }
+    cJSON_WriterRaw(writer, schema->segments[schema->total]);
+    return cJSON_WriterFinish(writer, len);
+}
+
+/**
+ * @brief device telemetry of a prepared schema
+ * @param[in] schema : schema
+ * @param[in] values : value pointers in schema order
+ * @return int : result code
+ */
+int tpSimpleTelemetryPrepared(tpSchema* schema, void** values) {
+    return tpSimpleTelemetryPreparedQos(schema, values, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief device telemetry of a prepared schema with QoS
+ * @param[in] schema : schema
+ * @param[in] values : value pointers in schema order
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleTelemetryPreparedQos(tpSchema* schema, void** values, int qos) {
+    if(!schema || !values) return TP_SDK_INVALID_PARAMETER;
+    qos = resolveQos(schema->client, TOPIC_CLASS_TELEMETRY, qos);
+    if(qos < 0) return TP_SDK_MQTT_BAD_QOS;
+    int rc;
+    const char* jsonData;
+    size_t len = 0;
+    char buffer[SIZE_JSON];
+    cJSON_Writer writer;
+
+    cJSON_WriterInit(&writer, buffer, sizeof(buffer), 1);
+    jsonData = renderPrepared(schema, values, &writer, &len);
+#ifdef SPT_DEBUG_ENABLE
+    SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleTelemetry\ntopic : %s\n%s", schema->telemetryTopic, jsonData);
+#else
+    SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleTelemetry\ntopic : %s\n%s", schema->telemetryTopic, jsonData);
+#endif
+    rc = jsonData ? MQTTCoalesceAdd(schema->client, schema->telemetryTopic, jsonData, len, qos) : TP_SDK_FAILURE;
+    cJSON_WriterFree(&writer);
+    return rc;
+}
+
+/**
+ * @brief device attribute of a prepared schema
+ * @param[in] schema : schema
+ * @param[in] values : value pointers in schema order
+ * @return int : result code
+ */
+int tpSimpleAttributePrepared(tpSchema* schema, void** values) {
+    return tpSimpleAttributePreparedQos(schema, values, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief device attribute of a prepared schema with QoS
+ * @param[in] schema : schema
+ * @param[in] values : value pointers in schema order
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleAttributePreparedQos(tpSchema* schema, void** values, int qos) {
+    if(!schema || !values) return TP_SDK_INVALID_PARAMETER;
+    qos = resolveQos(schema->client, TOPIC_CLASS_ATTRIBUTE, qos);
+    if(qos < 0) return TP_SDK_MQTT_BAD_QOS;
+    int rc;
+    const char* jsonData;
+    size_t len = 0;
+    char buffer[SIZE_JSON];
+    cJSON_Writer writer;
+
+    cJSON_WriterInit(&writer, buffer, sizeof(buffer), 1);
+    jsonData = renderPrepared(schema, values, &writer, &len);
+#ifdef SPT_DEBUG_ENABLE
+    SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleAttribute\ntopic : %s\n%s", schema->attributeTopic, jsonData);
+#else
+    SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleAttribute\ntopic : %s\n%s", schema->attributeTopic, jsonData);
+#endif
+    rc = jsonData ? MQTTDeflatePublish(schema->client, schema->attributeTopic, jsonData, len, qos) : TP_SDK_FAILURE;
+    cJSON_WriterFree(&writer);
+    return rc;
+}
+
+/**
+ * @brief write the values as a CSV row in schema order
+ * @param[in] schema : schema
+ * @param[in] values : value pointers in schema order. NULL leaves the column empty.
+ * @param[in] writer : initialized writer
+ * @param[out] len : row length
+ * @return const char* : row, NULL if failed
+ */
+static const char* renderPreparedCsv(tpSchema* schema, void** values, cJSON_Writer* writer, size_t* len) {
+    int i;
+    for(i = 0; i < schema->total; i++) {
+        if(i > 0) cJSON_WriterRaw(writer, ",");
+        addCsvValue(writer, schema->types[i], values[i]);
+    }
+    return cJSON_WriterFinish(writer, len);
+}
+
+/**
+ * @brief publish the values of a prepared schema as a CSV row
+ * @param[in] schema : schema
+ * @param[in] values : value pointers in schema order
+ * @param[in] topic : CSV topic of the schema
+ * @param[in] qos : resolved QoS
+ * @return int : result code
+ */
+static int publishPreparedCsv(tpSchema* schema, void** values, char* topic, int qos) {
+    int rc;
+    const char* csvData;
+    size_t len = 0;
+    char buffer[SIZE_JSON];
+    cJSON_Writer writer;
+
+    cJSON_WriterInit(&writer, buffer, sizeof(buffer), 0);
+    csvData = renderPreparedCsv(schema, values, &writer, &len);
+#ifdef SPT_DEBUG_ENABLE
+    SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimplePreparedCsv\ntopic : %s\n%s", topic, csvData);
+#else
+    SKTDebugPrint(LOG_LEVEL_INFO, "tpSimplePreparedCsv\ntopic : %s\n%s", topic, csvData);
+#endif
+    MQTTCoalesceFlush(schema->client);
+    rc = csvData ? MQTTAsyncPublishBufferEx(schema->client, topic, csvData, len, qos) : TP_SDK_FAILURE;
+    cJSON_WriterFree(&writer);
+    return rc;
+}
+
+/**
+ * @brief device telemetry of a prepared schema as a CSV row
+ * @param[in] schema : schema, the column order
+ * @param[in] values : value pointers in schema order. NULL leaves the column empty.
+ * @return int : result code
+ */
+int tpSimpleTelemetryPreparedCsv(tpSchema* schema, void** values) {
+    return tpSimpleTelemetryPreparedCsvQos(schema, values, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief device telemetry of a prepared schema as a CSV row with QoS
+ * @param[in] schema : schema, the column order
+ * @param[in] values : value pointers in schema order. NULL leaves the column empty.
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleTelemetryPreparedCsvQos(tpSchema* schema, void** values, int qos) {
+    if(!schema || !values) return TP_SDK_INVALID_PARAMETER;
+    qos = resolveQos(schema->client, TOPIC_CLASS_TELEMETRY, qos);
+    if(qos < 0) return TP_SDK_MQTT_BAD_QOS;
+    return publishPreparedCsv(schema, values, schema->telemetryCsvTopic, qos);
+}
+
+/**
+ * @brief device attribute of a prepared schema as a CSV row
+ * @param[in] schema : schema, the column order
+ * @param[in] values : value pointers in schema order. NULL leaves the column empty.
+ * @return int : result code
+ */
+int tpSimpleAttributePreparedCsv(tpSchema* schema, void** values) {
+    return tpSimpleAttributePreparedCsvQos(schema, values, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief device attribute of a prepared schema as a CSV row with QoS
+ * @param[in] schema : schema, the column order
+ * @param[in] values : value pointers in schema order. NULL leaves the column empty.
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleAttributePreparedCsvQos(tpSchema* schema, void** values, int qos) {
+    if(!schema || !values) return TP_SDK_INVALID_PARAMETER;
+    qos = resolveQos(schema->client, TOPIC_CLASS_ATTRIBUTE, qos);
+    if(qos < 0) return TP_SDK_MQTT_BAD_QOS;
+    return publishPreparedCsv(schema, values, schema->attributeCsvTopic, qos);
+}
+
+/**
+ * @brief declare the offset format record of the schema : the fields in schema order at fixed offsets.
+ *        LONG, LONGLONG : 1, 2, 4 or 8 byte signed(two's complement) integer, DOUBLE : 4(float) or 8 byte IEEE 754,
+ *        BOOLEAN : 1 byte 0 or 1, STRING, RAW : the width in bytes, padded with zero bytes.
+ * @param[in] schema : schema
+ * @param[in] widths : field widths in bytes, in schema order
+ * @param[in] order : byte order of the numbers
+ * @return int : result code
+ */
+int tpSimpleSetSchemaOffset(tpSchema* schema, int* widths, OFFSET_ORDER order) {
+    if(!schema || !widths) return TP_SDK_INVALID_PARAMETER;
+    if(order != OFFSET_BIG_ENDIAN && order != OFFSET_LITTLE_ENDIAN) return TP_SDK_INVALID_PARAMETER;
+    int i, width;
+    size_t recordSize = 0;
+    int* copy;
+
+    for(i = 0; i < schema->total; i++) {
+        width = widths[i];
+        switch(schema->types[i]) {
+            case JSON_TYPE_LONG:
+            case JSON_TYPE_LONGLONG:
+                if(width != 1 && width != 2 && width != 4 && width != 8) return TP_SDK_INVALID_PARAMETER;
+                break;
+            case JSON_TYPE_DOUBLE:
+                if(width != 4 && width != 8) return TP_SDK_INVALID_PARAMETER;
+                break;
+            case JSON_TYPE_BOOLEAN:
+                if(width != 1) return TP_SDK_INVALID_PARAMETER;
+                break;
+            default:
+                if(width < 1 || width > SIZE_JSON) return TP_SDK_INVALID_PARAMETER;
+                break;
+        }
+        recordSize += width;
+    }
+    copy = (int *)malloc(sizeof(int) * schema->total);
+    if(!copy) return TP_SDK_FAILURE;
+    memcpy(copy, widths, sizeof(int) * schema->total);
+    if(schema->widths) free(schema->widths);
+    schema->widths = copy;
+    schema->recordSize = recordSize;
+    schema->order = order;
+    return TP_SDK_SUCCESS;
+}
+
+/**
+ * @brief write an unsigned number of width bytes in the byte order
+ * @param[out] out : field
+ * @param[in] value : number
+ * @param[in] width : field width in bytes
+ * @param[in] order : byte order
+ */
+static void packUnsigned(unsigned char* out, unsigned long long value, int width, OFFSET_ORDER order) {
+    int i;
+    for(i = 0; i < width; i++) {
+        out[order == OFFSET_BIG_ENDIAN ? width - 1 - i : i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief pack the values into an offset format record
+ * @param[in] schema : schema declared with tpSimpleSetSchemaOffset
+ * @param[in] values : value pointers in schema order, typed as Element value. NULL leaves the field zero.
+ * @param[out] buf : record buffer
+ * @param[in] size : buffer size
+ * @param[out] len : record size
+ * @return int : result code. TP_SDK_INVALID_PARAMETER if a value does not fit its field.
+ */
+int tpSimpleEncodeOffset(tpSchema* schema, void** values, void* buf, size_t size, size_t* len) {
+    if(!schema || !values || !buf || !schema->widths) return TP_SDK_INVALID_PARAMETER;
+    if(size < schema->recordSize) return TP_SDK_INVALID_PARAMETER;
+    int i, width;
+    long long number;
+    size_t length;
+    unsigned char* out = (unsigned char *)buf;
+
+    memset(out, 0, schema->recordSize);
+    for(i = 0; i < schema->total; out += schema->widths[i], i++) {
+        width = schema->widths[i];
+        if(!values[i]) continue;
+        switch(schema->types[i]) {
+            case JSON_TYPE_DOUBLE:
+                if(width == 4) {
+                    float single = (float)*(double *)values[i];
+                    unsigned int bits;
+                    memcpy(&bits, &single, sizeof(bits));
+                    packUnsigned(out, bits, width, schema->order);
+                } else {
+                    unsigned long long bits;
+                    memcpy(&bits, values[i], sizeof(bits));
+                    packUnsigned(out, bits, width, schema->order);
+                }
+                break;
+            case JSON_TYPE_STRING:
+            case JSON_TYPE_RAW:
+                // a longer value is refused, not cut
+                length = strlen((char *)values[i]);
+                if(length > (size_t)width) return TP_SDK_INVALID_PARAMETER;
+                memcpy(out, values[i], length);
+                break;
+            default:
+                if(schema->types[i] == JSON_TYPE_BOOLEAN) {
+                    number = *(int *)values[i] != 0;
+                } else if(schema->types[i] == JSON_TYPE_LONGLONG) {
+                    number = *(long long *)values[i];
+                } else {
+                    number = *(long *)values[i];
+                }
+                // LONG and LONGLONG fields are signed, a value is read back the same only in the signed range
+                if(width < 8 && (number < -(1LL << (8 * width - 1)) || number >= (1LL << (8 * width - 1)))) {
+                    return TP_SDK_INVALID_PARAMETER;
+                }
+                packUnsigned(out, (unsigned long long)number, width, schema->order);
+                break;
+        }
+    }
+    if(len) *len = schema->recordSize;
+    return TP_SDK_SUCCESS;
+}
+
+/**
+ * @brief publish the values of a prepared schema as an offset format record
+ * @param[in] schema : schema declared with tpSimpleSetSchemaOffset
+ * @param[in] values : value pointers in schema order
+ * @param[in] topicClass : TOPIC_CLASS_TELEMETRY or TOPIC_CLASS_ATTRIBUTE
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT
+ * @return int : result code
+ */
+static int publishPreparedOffset(tpSchema* schema, void** values, TOPIC_CLASS topicClass, int qos) {
+    if(!schema || !values || !schema->widths) return TP_SDK_INVALID_PARAMETER;
+    int rc;
+    size_t len = 0;
+    unsigned char buffer[SIZE_JSON];
+    unsigned char* record = buffer;
+
+    if(schema->recordSize > sizeof(buffer)) {
+        record = (unsigned char *)malloc(schema->recordSize);
+        if(!record) return TP_SDK_FAILURE;
+    }
+    rc = tpSimpleEncodeOffset(schema, values, record, schema->recordSize, &len);
+    if(rc == TP_SDK_SUCCESS) {
+        if(topicClass == TOPIC_CLASS_TELEMETRY) {
+            rc = tpSimpleRawTelemetryBinaryQosEx(schema->client, record, len, FORMAT_OFFSET, qos);
+        } else {
+            rc = tpSimpleRawAttributeBinaryQosEx(schema->client, record, len, FORMAT_OFFSET, qos);
+        }
+    }
+    if(record != buffer) free(record);
+    return rc;
+}
+
+/**
+ * @brief device telemetry of a prepared schema as an offset format record
+ * @param[in] schema : schema declared with tpSimpleSetSchemaOffset
+ * @param[in] values : value pointers in schema order. NULL leaves the field zero.
+ * @return int : result code
+ */
+int tpSimpleTelemetryPreparedOffset(tpSchema* schema, void** values) {
+    return tpSimpleTelemetryPreparedOffsetQos(schema, values, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief device telemetry of a prepared schema as an offset format record with QoS
+ * @param[in] schema : schema declared with tpSimpleSetSchemaOffset
+ * @param[in] values : value pointers in schema order. NULL leaves the field zero.
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleTelemetryPreparedOffsetQos(tpSchema* schema, void** values, int qos) {
+    return publishPreparedOffset(schema, values, TOPIC_CLASS_TELEMETRY, qos);
+}
+
+/**
+ * @brief device attribute of a prepared schema as an offset format record
+ * @param[in] schema : schema declared with tpSimpleSetSchemaOffset
+ * @param[in] values : value pointers in schema order. NULL leaves the field zero.
+ * @return int : result code
+ */
+int tpSimpleAttributePreparedOffset(tpSchema* schema, void** values) {
+    return tpSimpleAttributePreparedOffsetQos(schema, values, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief device attribute of a prepared schema as an offset format record with QoS
+ * @param[in] schema : schema declared with tpSimpleSetSchemaOffset
+ * @param[in] values : value pointers in schema order. NULL leaves the field zero.
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleAttributePreparedOffsetQos(tpSchema* schema, void** values, int qos) {
+    return publishPreparedOffset(schema, values, TOPIC_CLASS_ATTRIBUTE, qos);
+}
+
 /**
  * @brief initialize Simple API
  * @param[in] serviceID : service id
@@ -273,9 +1224,21 @@ int tpSimpleSubscribe(DeviceSubscribe* subscribe) {
  * @return int : result code
  */
 int tpSimpleInitialize(char* serviceID, char* deviceID) {
-    if(!serviceID || !deviceID) return TP_SDK_FAILURE;
-    mServiceID = serviceID;
-    mDeviceID = deviceID;
+    return tpSimpleInitializeEx(MQTTDefaultClient(), serviceID, deviceID);
+}
+
+/**
+ * @brief initialize Simple API of the session
+ * @param[in] client : session handle
+ * @param[in] serviceID : service id
+ * @param[in] deviceID : device id
+ * @param[in] deviceID : gateway id
+ * @return int : result code
+ */
+int tpSimpleInitializeEx(tpClient* client, char* serviceID, char* deviceID) {
+    if(!client || !serviceID || !deviceID) return TP_SDK_FAILURE;
+    client->serviceID = serviceID;
+    client->deviceID = deviceID;
 #ifdef SPT_DEBUG_ENABLE
     SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleInitialize\nserviceID : %s, deviceID: %s", serviceID,  deviceID);
 #else
@@ -291,7 +1254,92 @@ int tpSimpleInitialize(char* serviceID, char* deviceID) {
  * @return int : result code
  */
 int tpSimpleRawTelemetry(char* telemetry, DATA_FORMAT format) {
+    return tpSimpleRawTelemetryEx(MQTTDefaultClient(), telemetry, format);
+}
+
+/**
+ * @brief send raw data to telemetry of the session
+ * @param[in] client : session handle
+ * @param[in] telemetry : content
+ * @param[in] format : data format
+ * @return int : result code
+ */
+int tpSimpleRawTelemetryEx(tpClient* client, char* telemetry, DATA_FORMAT format) {
+    return tpSimpleRawTelemetryQosEx(client, telemetry, format, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief send raw data to telemetry with QoS
+ * @param[in] telemetry : content
+ * @param[in] format : data format
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleRawTelemetryQos(char* telemetry, DATA_FORMAT format, int qos) {
+    return tpSimpleRawTelemetryQosEx(MQTTDefaultClient(), telemetry, format, qos);
+}
+
+/**
+ * @brief send raw data to telemetry with QoS of the session
+ * @param[in] client : session handle
+ * @param[in] telemetry : content
+ * @param[in] format : data format
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleRawTelemetryQosEx(tpClient* client, char* telemetry, DATA_FORMAT format, int qos) {
     if(!telemetry) return TP_SDK_INVALID_PARAMETER;
+    return tpSimpleRawTelemetryBinaryQosEx(client, telemetry, strlen(telemetry), format, qos);
+}
+
+/**
+ * @brief send raw binary data to telemetry
+ * @param[in] buf : content, may contain zero bytes
+ * @param[in] len : content length in bytes
+ * @param[in] format : data format
+ * @return int : result code
+ */
+int tpSimpleRawTelemetryBinary(const void* buf, size_t len, DATA_FORMAT format) {
+    return tpSimpleRawTelemetryBinaryQosEx(MQTTDefaultClient(), buf, len, format, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief send raw binary data to telemetry of the session
+ * @param[in] client : session handle
+ * @param[in] buf : content, may contain zero bytes
+ * @param[in] len : content length in bytes
+ * @param[in] format : data format
+ * @return int : result code
+ */
+int tpSimpleRawTelemetryBinaryEx(tpClient* client, const void* buf, size_t len, DATA_FORMAT format) {
+    return tpSimpleRawTelemetryBinaryQosEx(client, buf, len, format, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief send raw binary data to telemetry with QoS
+ * @param[in] buf : content, may contain zero bytes
+ * @param[in] len : content length in bytes
+ * @param[in] format : data format
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleRawTelemetryBinaryQos(const void* buf, size_t len, DATA_FORMAT format, int qos) {
+    return tpSimpleRawTelemetryBinaryQosEx(MQTTDefaultClient(), buf, len, format, qos);
+}
+
+/**
+ * @brief send raw binary data to telemetry with QoS of the session
+ * @param[in] client : session handle
+ * @param[in] buf : content, may contain zero bytes
+ * @param[in] len : content length in bytes
+ * @param[in] format : data format
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleRawTelemetryBinaryQosEx(tpClient* client, const void* buf, size_t len, DATA_FORMAT format, int qos) {
+    if(!client || (!buf && len > 0)) return TP_SDK_INVALID_PARAMETER;
+    qos = resolveQos(client, TOPIC_CLASS_TELEMETRY, qos);
+    if(qos < 0) return TP_SDK_MQTT_BAD_QOS;
     int rc = TP_SDK_FAILURE;
     char topic[SIZE_TOPIC] = "";
     char* topicBase;
@@ -309,13 +1357,28 @@ int tpSimpleRawTelemetry(char* telemetry, DATA_FORMAT format) {
         default:
             return TP_SDK_INVALID_PARAMETER;
     }
-    snprintf(topic, SIZE_TOPIC, topicBase, mServiceID, mDeviceID);
+    snprintf(topic, SIZE_TOPIC, topicBase, client->serviceID, client->deviceID);
+    if(format == FORMAT_OFFSET) {
 #ifdef SPT_DEBUG_ENABLE
-    SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleRawTelemetry\ntopic : %s\n%s", topic, telemetry);
+    SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleRawTelemetry\ntopic : %s\nlength : %d", topic, (int)len);
 #else
-    SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleRawTelemetry\ntopic : %s\n%s", topic, telemetry);
-#endif    
-    rc = MQTTAsyncPublishMessageWithTopic(topic, telemetry);
+    SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleRawTelemetry\ntopic : %s\nlength : %d", topic, (int)len);
+#endif
+    } else {
+#ifdef SPT_DEBUG_ENABLE
+    SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleRawTelemetry\ntopic : %s\n%.*s", topic, (int)len, (const char *)buf);
+#else
+    SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleRawTelemetry\ntopic : %s\n%.*s", topic, (int)len, (const char *)buf);
+#endif
+    }
+    // raw JSON is collected only when the application vouches that it is one object, others keep the order
+    if(format == FORMAT_JSON && __atomic_load_n(&client->coalesce.raw, __ATOMIC_ACQUIRE)
+            && len > 0 && ((const char *)buf)[0] == '{') {
+        rc = MQTTCoalesceAdd(client, topic, (const char *)buf, len, qos);
+    } else {
+        MQTTCoalesceFlush(client);
+        rc = MQTTAsyncPublishBufferEx(client, topic, buf, len, qos);
+    }
     return rc;
 }
 
@@ -325,8 +1388,93 @@ int tpSimpleRawTelemetry(char* telemetry, DATA_FORMAT format) {
  * @param[in] format : data format
  * @return int : result code
  */
- int tpSimpleRawAttribute(char* attribute, DATA_FORMAT format) {
+int tpSimpleRawAttribute(char* attribute, DATA_FORMAT format) {
+    return tpSimpleRawAttributeEx(MQTTDefaultClient(), attribute, format);
+}
+
+/**
+ * @brief send raw data to attribute of the session
+ * @param[in] client : session handle
+ * @param[in] attribute : attributes
+ * @param[in] format : data format
+ * @return int : result code
+ */
+int tpSimpleRawAttributeEx(tpClient* client, char* attribute, DATA_FORMAT format) {
+    return tpSimpleRawAttributeQosEx(client, attribute, format, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief send raw data to attribute with QoS
+ * @param[in] attribute : attributes
+ * @param[in] format : data format
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleRawAttributeQos(char* attribute, DATA_FORMAT format, int qos) {
+    return tpSimpleRawAttributeQosEx(MQTTDefaultClient(), attribute, format, qos);
+}
+
+/**
+ * @brief send raw data to attribute with QoS of the session
+ * @param[in] client : session handle
+ * @param[in] attribute : attributes
+ * @param[in] format : data format
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleRawAttributeQosEx(tpClient* client, char* attribute, DATA_FORMAT format, int qos) {
     if(!attribute) return TP_SDK_INVALID_PARAMETER;
+    return tpSimpleRawAttributeBinaryQosEx(client, attribute, strlen(attribute), format, qos);
+}
+
+/**
+ * @brief send raw binary data to attribute
+ * @param[in] buf : content, may contain zero bytes
+ * @param[in] len : content length in bytes
+ * @param[in] format : data format
+ * @return int : result code
+ */
+int tpSimpleRawAttributeBinary(const void* buf, size_t len, DATA_FORMAT format) {
+    return tpSimpleRawAttributeBinaryQosEx(MQTTDefaultClient(), buf, len, format, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief send raw binary data to attribute of the session
+ * @param[in] client : session handle
+ * @param[in] buf : content, may contain zero bytes
+ * @param[in] len : content length in bytes
+ * @param[in] format : data format
+ * @return int : result code
+ */
+int tpSimpleRawAttributeBinaryEx(tpClient* client, const void* buf, size_t len, DATA_FORMAT format) {
+    return tpSimpleRawAttributeBinaryQosEx(client, buf, len, format, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief send raw binary data to attribute with QoS
+ * @param[in] buf : content, may contain zero bytes
+ * @param[in] len : content length in bytes
+ * @param[in] format : data format
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleRawAttributeBinaryQos(const void* buf, size_t len, DATA_FORMAT format, int qos) {
+    return tpSimpleRawAttributeBinaryQosEx(MQTTDefaultClient(), buf, len, format, qos);
+}
+
+/**
+ * @brief send raw binary data to attribute with QoS of the session
+ * @param[in] client : session handle
+ * @param[in] buf : content, may contain zero bytes
+ * @param[in] len : content length in bytes
+ * @param[in] format : data format
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleRawAttributeBinaryQosEx(tpClient* client, const void* buf, size_t len, DATA_FORMAT format, int qos) {
+    if(!client || (!buf && len > 0)) return TP_SDK_INVALID_PARAMETER;
+    qos = resolveQos(client, TOPIC_CLASS_ATTRIBUTE, qos);
+    if(qos < 0) return TP_SDK_MQTT_BAD_QOS;
     int rc = TP_SDK_FAILURE;
     char topic[SIZE_TOPIC] = "";
     char* topicBase;
@@ -344,13 +1492,25 @@ int tpSimpleRawTelemetry(char* telemetry, DATA_FORMAT format) {
         default:
             return TP_SDK_INVALID_PARAMETER;
     }    
-    snprintf(topic, SIZE_TOPIC, topicBase, mServiceID, mDeviceID);    
+    snprintf(topic, SIZE_TOPIC, topicBase, client->serviceID, client->deviceID);    
+    if(format == FORMAT_OFFSET) {
+#ifdef SPT_DEBUG_ENABLE
+    SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleRawAttribute\ntopic : %s\nlength : %d", topic, (int)len);
+#else
+    SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleRawAttribute\ntopic : %s\nlength : %d", topic, (int)len);
+#endif
+    } else {
 #ifdef SPT_DEBUG_ENABLE
-    SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleRawAttribute\ntopic : %s\n%s", topic,  attribute);
+    SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleRawAttribute\ntopic : %s\n%.*s", topic, (int)len, (const char *)buf);
 #else
-    SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleRawAttribute\ntopic : %s\n%s", topic,  attribute);
+    SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleRawAttribute\ntopic : %s\n%.*s", topic, (int)len, (const char *)buf);
 #endif
-    rc = MQTTAsyncPublishMessageWithTopic(topic, attribute);
+    }
+    if(format == FORMAT_JSON) {
+        rc = MQTTDeflatePublish(client, topic, buf, len, qos);
+    } else {
+        rc = MQTTAsyncPublishBufferEx(client, topic, buf, len, qos);
+    }
     return rc;
 }
 
@@ -359,17 +1519,52 @@ int tpSimpleRawTelemetry(char* telemetry, DATA_FORMAT format) {
  * @param[in] result : control result 
  * @return int : result code
  */
- int tpSimpleRawResult(char* result) {
-    if(!result) return TP_SDK_INVALID_PARAMETER;
+int tpSimpleRawResult(char* result) {
+    return tpSimpleRawResultEx(MQTTDefaultClient(), result);
+}
+
+/**
+ * @brief send all raw data to result of the session
+ * @param[in] client : session handle
+ * @param[in] result : control result 
+ * @return int : result code
+ */
+int tpSimpleRawResultEx(tpClient* client, char* result) {
+    return tpSimpleRawResultQosEx(client, result, TP_QOS_DEFAULT);
+}
+
+/**
+ * @brief send all raw data to result with QoS
+ * @param[in] result : control result 
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleRawResultQos(char* result, int qos) {
+    return tpSimpleRawResultQosEx(MQTTDefaultClient(), result, qos);
+}
+
+/**
+ * @brief send all raw data to result with QoS of the session
+ * @param[in] client : session handle
+ * @param[in] result : control result 
+ * @param[in] qos : QoS(0, 1, 2) or TP_QOS_DEFAULT to use the policy of the topic class
+ * @return int : result code
+ */
+int tpSimpleRawResultQosEx(tpClient* client, char* result, int qos) {
+    if(!client || !result) return TP_SDK_INVALID_PARAMETER;
+    qos = resolveQos(client, TOPIC_CLASS_UP, qos);
+    if(qos < 0) return TP_SDK_MQTT_BAD_QOS;
     int rc = TP_SDK_FAILURE;
     char topic[SIZE_TOPIC] = "";
-    snprintf(topic, SIZE_TOPIC, TOPIC_UP, mServiceID, mDeviceID);
+    snprintf(topic, SIZE_TOPIC, TOPIC_UP, client->serviceID, client->deviceID);
 
 #ifdef SPT_DEBUG_ENABLE
     SKTtpDebugLog(LOG_LEVEL_INFO, "tpSimpleRawResult\ntopic : %s\n%s", topic,  result);
 #else
     SKTDebugPrint(LOG_LEVEL_INFO, "tpSimpleRawResult\ntopic : %s\n%s", topic,  result);
 #endif
-    rc = MQTTAsyncPublishMessageWithTopic(topic, result);
+    // the telemetry collected before the control is sent first
+    MQTTCoalesceFlush(client);
+    rc = MQTTAsyncPublishMessageQosEx(client, topic, result, qos);
     return rc;
 }
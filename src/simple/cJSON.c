@@ -1142,6 +1142,486 @@ CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buf, const i
     return print_value(item, &p);
 }
 
+/* Streaming writer */
+
+/* make room for "needed" more bytes and the terminator, moving a caller supplied buffer to the heap when it is outgrown */
+static unsigned char* writer_ensure(cJSON_Writer * const writer, size_t needed)
+{
+    unsigned char *newbuffer = NULL;
+    size_t newsize = 0;
+
+    if (writer->failed)
+    {
+        return NULL;
+    }
+
+    if (needed > (INT_MAX / 2) - writer->offset)
+    {
+        writer->failed = true;
+        return NULL;
+    }
+
+    needed += writer->offset + 1;
+    if ((writer->buffer != NULL) && (needed <= writer->length))
+    {
+        return writer->buffer + writer->offset;
+    }
+
+    newsize = needed * 2;
+    if (writer->owned && (global_hooks.reallocate != NULL))
+    {
+        newbuffer = (unsigned char*)global_hooks.reallocate(writer->buffer, newsize);
+    }
+    else
+    {
+        newbuffer = (unsigned char*)global_hooks.allocate(newsize);
+        if ((newbuffer != NULL) && (writer->buffer != NULL))
+        {
+            memcpy(newbuffer, writer->buffer, writer->offset);
+        }
+        if ((newbuffer != NULL) && writer->owned)
+        {
+            global_hooks.deallocate(writer->buffer);
+        }
+    }
+    if (newbuffer == NULL)
+    {
+        writer->failed = true;
+        return NULL;
+    }
+
+    writer->buffer = newbuffer;
+    writer->length = newsize;
+    writer->owned = true;
+
+    return newbuffer + writer->offset;
+}
+
+/* append length bytes of text */
+static void writer_append(cJSON_Writer * const writer, const char *text, size_t length)
+{
+    unsigned char *output_pointer = writer_ensure(writer, length);
+    if (output_pointer == NULL)
+    {
+        return;
+    }
+    memcpy(output_pointer, text, length);
+    writer->offset += length;
+    writer->buffer[writer->offset] = '\0';
+}
+
+/* append count tabs */
+static void writer_indent(cJSON_Writer * const writer, size_t count)
+{
+    unsigned char *output_pointer = writer_ensure(writer, count);
+    if (output_pointer == NULL)
+    {
+        return;
+    }
+    memset(output_pointer, '\t', count);
+    writer->offset += count;
+    writer->buffer[writer->offset] = '\0';
+}
+
+/* a printbuffer on the free part of the writer buffer, for the print_* functions */
+static printbuffer writer_view(const cJSON_Writer * const writer)
+{
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+
+    p.buffer = writer->buffer;
+    p.length = writer->length;
+    p.offset = writer->offset;
+    p.depth = writer->depth;
+    p.noalloc = true;
+    p.format = writer->format;
+    p.hooks = global_hooks;
+
+    return p;
+}
+
+/* write what separates the next value from the previous one in an array. object members are separated by the key. */
+static void writer_value(cJSON_Writer * const writer)
+{
+    unsigned long bit = 0;
+
+    if (writer->depth == 0)
+    {
+        return;
+    }
+    bit = 1UL << (writer->depth - 1);
+    if (!(writer->arrays & bit))
+    {
+        return;
+    }
+    if (writer->members & bit)
+    {
+        writer_append(writer, writer->format ? ", " : ",", writer->format ? 2 : 1);
+    }
+    writer->members |= bit;
+}
+
+/* open an object or array */
+static void writer_begin(cJSON_Writer * const writer, cJSON_bool array)
+{
+    unsigned long bit = 0;
+
+    writer_value(writer);
+    if (writer->depth >= CJSON_WRITER_NESTING_LIMIT)
+    {
+        writer->failed = true;
+        return;
+    }
+    bit = 1UL << writer->depth;
+    writer->depth++;
+    writer->members &= ~bit;
+    if (array)
+    {
+        writer->arrays |= bit;
+        writer_append(writer, "[", 1);
+    }
+    else
+    {
+        writer->arrays &= ~bit;
+        writer_append(writer, writer->format ? "{\n" : "{", writer->format ? 2 : 1);
+    }
+}
+
+/* close the innermost container if it is an array(or object) */
+static void writer_end(cJSON_Writer * const writer, cJSON_bool array)
+{
+    unsigned long bit = 0;
+
+    if (writer->depth == 0)
+    {
+        writer->failed = true;
+        return;
+    }
+    bit = 1UL << (writer->depth - 1);
+    if (!(writer->arrays & bit) != !array)
+    {
+        writer->failed = true;
+        return;
+    }
+    writer->depth--;
+    if (array)
+    {
+        writer_append(writer, "]", 1);
+        return;
+    }
+    if (writer->format)
+    {
+        if (writer->members & bit)
+        {
+            writer_append(writer, "\n", 1);
+        }
+        writer_indent(writer, writer->depth);
+    }
+    writer_append(writer, "}", 1);
+}
+
+CJSON_PUBLIC(void) cJSON_WriterInit(cJSON_Writer *writer, char *buffer, size_t length, cJSON_bool format)
+{
+    if (writer == NULL)
+    {
+        return;
+    }
+    memset(writer, 0, sizeof(cJSON_Writer));
+    if ((buffer != NULL) && (length > 0))
+    {
+        writer->buffer = (unsigned char*)buffer;
+        writer->length = length;
+        writer->buffer[0] = '\0';
+    }
+    writer->format = format;
+}
+
+CJSON_PUBLIC(void) cJSON_WriterReset(cJSON_Writer *writer)
+{
+    if (writer == NULL)
+    {
+        return;
+    }
+    writer->offset = 0;
+    writer->depth = 0;
+    writer->arrays = 0;
+    writer->members = 0;
+    writer->failed = false;
+    if (writer->buffer != NULL)
+    {
+        writer->buffer[0] = '\0';
+    }
+}
+
+CJSON_PUBLIC(void) cJSON_WriterBeginObject(cJSON_Writer *writer)
+{
+    if (writer != NULL)
+    {
+        writer_begin(writer, false);
+    }
+}
+
+CJSON_PUBLIC(void) cJSON_WriterEndObject(cJSON_Writer *writer)
+{
+    if (writer != NULL)
+    {
+        writer_end(writer, false);
+    }
+}
+
+CJSON_PUBLIC(void) cJSON_WriterBeginArray(cJSON_Writer *writer)
+{
+    if (writer != NULL)
+    {
+        writer_begin(writer, true);
+    }
+}
+
+CJSON_PUBLIC(void) cJSON_WriterEndArray(cJSON_Writer *writer)
+{
+    if (writer != NULL)
+    {
+        writer_end(writer, true);
+    }
+}
+
+CJSON_PUBLIC(void) cJSON_WriterKey(cJSON_Writer *writer, const char *key)
+{
+    unsigned long bit = 0;
+
+    if ((writer == NULL) || writer->failed)
+    {
+        return;
+    }
+    if ((writer->depth == 0) || (writer->arrays & (1UL << (writer->depth - 1))))
+    {
+        /* keys only appear in objects */
+        writer->failed = true;
+        return;
+    }
+    bit = 1UL << (writer->depth - 1);
+    if (writer->members & bit)
+    {
+        writer_append(writer, writer->format ? ",\n" : ",", writer->format ? 2 : 1);
+    }
+    writer->members |= bit;
+    if (writer->format)
+    {
+        writer_indent(writer, writer->depth);
+    }
+    cJSON_WriterString(writer, key);
+    writer_append(writer, writer->format ? ":\t" : ":", writer->format ? 2 : 1);
+}
+
+/* write the decimal digits of a magnitude with its sign */
+static void writer_digits(cJSON_Writer * const writer, unsigned long long magnitude, cJSON_bool negative)
+{
+    unsigned char digits[20];
+    unsigned char *output_pointer = NULL;
+    size_t count = 0;
+
+    do
+    {
+        digits[count++] = (unsigned char)('0' + (magnitude % 10));
+        magnitude /= 10;
+    }
+    while (magnitude > 0);
+
+    output_pointer = writer_ensure(writer, count + 1);
+    if (output_pointer == NULL)
+    {
+        return;
+    }
+    if (negative)
+    {
+        *output_pointer++ = '-';
+        writer->offset++;
+    }
+    writer->offset += count;
+    while (count > 0)
+    {
+        *output_pointer++ = digits[--count];
+    }
+    *output_pointer = '\0';
+}
+
+/* write an integral number as digits, the text of print_number without sprintf. returns false for other numbers. */
+static cJSON_bool writer_integer(cJSON_Writer * const writer, double number)
+{
+    /* %1.15g prints integers below 1e15 without exponent, and -0 with its sign */
+    if (!((number > -1e15) && (number < 1e15)) || (number != (double)(long long)number) || ((number == 0) && signbit(number)))
+    {
+        return false;
+    }
+
+    writer_digits(writer, (unsigned long long)((number < 0) ? -number : number), number < 0);
+
+    return true;
+}
+
+CJSON_PUBLIC(void) cJSON_WriterNumber(cJSON_Writer *writer, double number)
+{
+    cJSON item;
+    printbuffer p;
+
+    if (writer == NULL)
+    {
+        return;
+    }
+    writer_value(writer);
+    if (writer_integer(writer, number))
+    {
+        return;
+    }
+    /* print_number needs at most 26 bytes */
+    if (writer_ensure(writer, 26) == NULL)
+    {
+        return;
+    }
+    memset(&item, 0, sizeof(item));
+    item.valuedouble = number;
+    p = writer_view(writer);
+    if (!print_number(&item, &p))
+    {
+        writer->failed = true;
+        return;
+    }
+    writer->offset = p.offset;
+}
+
+CJSON_PUBLIC(void) cJSON_WriterInteger(cJSON_Writer *writer, long long number)
+{
+    if (writer == NULL)
+    {
+        return;
+    }
+    writer_value(writer);
+    /* the magnitude of LLONG_MIN only fits unsigned */
+    writer_digits(writer, (number < 0) ? (0ULL - (unsigned long long)number) : (unsigned long long)number, number < 0);
+}
+
+CJSON_PUBLIC(void) cJSON_WriterString(cJSON_Writer *writer, const char *string)
+{
+    printbuffer p;
+    size_t length = 0;
+
+    if (writer == NULL)
+    {
+        return;
+    }
+    if ((writer->depth == 0) || (writer->arrays & (1UL << (writer->depth - 1))))
+    {
+        writer_value(writer);
+    }
+    if (writer_ensure(writer, sizeof("\"\"")) == NULL)
+    {
+        return;
+    }
+    p = writer_view(writer);
+    if (!print_string_ptr((const unsigned char*)string, &p))
+    {
+        /* retry with room for every character escaped as \uXXXX */
+        length = (string != NULL) ? strlen(string) : 0;
+        if ((length > (INT_MAX / 12)) || (writer_ensure(writer, (length * 6) + sizeof("\"\"")) == NULL))
+        {
+            writer->failed = true;
+            return;
+        }
+        p = writer_view(writer);
+        if (!print_string_ptr((const unsigned char*)string, &p))
+        {
+            writer->failed = true;
+            return;
+        }
+    }
+    update_offset(&p);
+    writer->offset = p.offset;
+}
+
+CJSON_PUBLIC(void) cJSON_WriterRaw(cJSON_Writer *writer, const char *raw)
+{
+    if ((writer == NULL) || (raw == NULL))
+    {
+        if (writer != NULL)
+        {
+            writer->failed = true;
+        }
+        return;
+    }
+    writer_value(writer);
+    writer_append(writer, raw, strlen(raw));
+}
+
+CJSON_PUBLIC(void) cJSON_WriterRawLength(cJSON_Writer *writer, const char *raw, size_t length)
+{
+    if ((writer == NULL) || ((raw == NULL) && (length > 0)))
+    {
+        if (writer != NULL)
+        {
+            writer->failed = true;
+        }
+        return;
+    }
+    writer_value(writer);
+    writer_append(writer, raw, length);
+}
+
+CJSON_PUBLIC(void) cJSON_WriterBool(cJSON_Writer *writer, cJSON_bool boolean)
+{
+    if (writer == NULL)
+    {
+        return;
+    }
+    writer_value(writer);
+    if (boolean)
+    {
+        writer_append(writer, "true", 4);
+    }
+    else
+    {
+        writer_append(writer, "false", 5);
+    }
+}
+
+CJSON_PUBLIC(void) cJSON_WriterNull(cJSON_Writer *writer)
+{
+    if (writer == NULL)
+    {
+        return;
+    }
+    writer_value(writer);
+    writer_append(writer, "null", 4);
+}
+
+CJSON_PUBLIC(const char *) cJSON_WriterFinish(cJSON_Writer *writer, size_t *length)
+{
+    if ((writer == NULL) || writer->failed || (writer->depth != 0) || (writer->buffer == NULL))
+    {
+        return NULL;
+    }
+    if (length != NULL)
+    {
+        *length = writer->offset;
+    }
+
+    return (const char*)writer->buffer;
+}
+
+CJSON_PUBLIC(void) cJSON_WriterFree(cJSON_Writer *writer)
+{
+    if (writer == NULL)
+    {
+        return;
+    }
+    if (writer->owned && (writer->buffer != NULL))
+    {
+        global_hooks.deallocate(writer->buffer);
+    }
+    writer->buffer = NULL;
+    writer->length = 0;
+    writer->owned = false;
+    cJSON_WriterReset(writer);
+}
+
 /* Parser core - when encountering text, process appropriately. */
 static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
 {